@@ -0,0 +1,79 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file bench_platform.c
+ * @brief Minimal implementation of the platform and logging API for the benchmark
+ *
+ * In an LF program these functions are provided by reactor-c. The benchmark links the
+ * plugin directly, so it provides pthread-based equivalents here.
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "platform.h"
+#include "logging.h"
+#include "bench_platform.h"
+
+static _Thread_local int thread_id = -1;
+
+void bench_set_thread_id(int id) { thread_id = id; }
+
+// IMPLEMENTATION OF PLATFORM API ********************************************
+
+lf_platform_mutex_ptr_t lf_platform_mutex_new() {
+  pthread_mutex_t* mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+  if (!mutex) {
+    return NULL;
+  }
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+  return mutex;
+}
+
+void lf_platform_mutex_free(lf_platform_mutex_ptr_t mutex) {
+  pthread_mutex_destroy((pthread_mutex_t*)mutex);
+  free(mutex);
+}
+
+int lf_platform_mutex_lock(lf_platform_mutex_ptr_t mutex) { return pthread_mutex_lock((pthread_mutex_t*)mutex); }
+
+int lf_platform_mutex_unlock(lf_platform_mutex_ptr_t mutex) { return pthread_mutex_unlock((pthread_mutex_t*)mutex); }
+
+int lf_thread_id() { return thread_id; }
+
+// IMPLEMENTATION OF LOGGING API *********************************************
+
+static void vprint(const char* prefix, const char* format, va_list args) {
+  fputs(prefix, stderr);
+  vfprintf(stderr, format, args);
+  fputc('\n', stderr);
+}
+
+#define BENCH_PRINT_FUNCTION(name, prefix)                                                                             \
+  void name(const char* format, ...) {                                                                                 \
+    va_list args;                                                                                                      \
+    va_start(args, format);                                                                                            \
+    vprint(prefix, format, args);                                                                                      \
+    va_end(args);                                                                                                      \
+  }
+
+BENCH_PRINT_FUNCTION(lf_print, "")
+BENCH_PRINT_FUNCTION(lf_print_log, "LOG: ")
+BENCH_PRINT_FUNCTION(lf_print_debug, "DEBUG: ")
+BENCH_PRINT_FUNCTION(lf_print_error, "ERROR: ")
+BENCH_PRINT_FUNCTION(lf_print_warning, "WARNING: ")
+
+void lf_print_error_and_exit(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  vprint("FATAL ERROR: ", format, args);
+  va_end(args);
+  exit(EXIT_FAILURE);
+}
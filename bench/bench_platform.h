@@ -0,0 +1,14 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef BENCH_PLATFORM_H
+#define BENCH_PLATFORM_H
+
+/**
+ * @brief Set the value returned by lf_thread_id() on the calling thread.
+ *
+ * Threads that never call this behave like threads created by the user (ID -1).
+ */
+void bench_set_thread_id(int id);
+
+#endif // BENCH_PLATFORM_H
@@ -0,0 +1,361 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file trace_bench.c
+ * @brief Tracepoint and export benchmark for the trace plugin
+ *
+ * Drives the plugin through the same API an LF program uses, from any number of
+ * worker threads, with a synthetic but representative event mix: every reaction
+ * execution is a reaction_starts/reaction_ends pair, interleaved with the scheduler
+ * events that LF_TRACE_VERBOSE=0 filters out.
+ *
+ * Modes:
+ * - tracepoint: the OpenTelemetry exporter is disabled, so this measures dispatch
+ *   and the local sinks. By default the only sink is a shared-memory ring, which keeps
+ *   memory use constant and disk I/O out of the measurement.
+ * - export: reaction spans are created and handed to the exporter. Without a
+ *   collector at TRACE_PLUGIN_ENDPOINT, the batches are dropped after export fails,
+ *   which does not affect the measured tracepoint cost. LF_TRACE_EXPORTER=otlp-http
+ *   measures the built-in encoder instead of the SDK.
+ *
+ * Each run prints a `RESULT <mode> <threads> <ns/event>` line. Given the output of
+ * an earlier run with --baseline, the relative gain over it is reported as well;
+ * build.sh --pgo uses this to report the effect of profile-guided optimization.
+ *
+ * With --scaling, the workload runs with 1, 2, 4, ... up to --threads workers and each
+ * thread count is reported, with its throughput relative to a single worker. Per-worker
+ * state that shares cache lines shows up as an efficiency well below 100% as soon as the
+ * workers run on different cores, and more so across sockets; pin the benchmark (e.g.
+ * with numactl) to compare one socket against two.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+#include "trace_types.h"
+#include "bench_platform.h"
+
+#define BENCH_MAX_THREADS 256
+
+// PRIVATE DATA STRUCTURES ***************************************************
+
+typedef struct bench_options {
+  const char* mode;     ///< "tracepoint" or "export"
+  int threads;          ///< Number of worker threads
+  long long reactions;  ///< Reaction executions per thread
+  int reactors;         ///< Number of registered reactors
+  int repetitions;      ///< Runs of the workload; the fastest is reported
+  const char* baseline; ///< Output of an earlier run to compare against
+  int scaling;          ///< Run with 1, 2, 4, ... up to threads workers
+} bench_options_t;
+
+typedef struct bench_worker {
+  pthread_t thread;
+  int id;
+  long long reactions;
+} bench_worker_t;
+
+static bench_options_t options = {
+    .mode = "tracepoint", .threads = 1, .reactions = 0, .reactors = 64, .repetitions = 5, .baseline = NULL,
+    .scaling = 0};
+static char* reactor_names;
+static char* reactor_objects;
+static pthread_barrier_t start_barrier;
+
+// PRIVATE HELPERS ***********************************************************
+
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void usage(const char* program) {
+  fprintf(stderr,
+          "Usage: %s [--mode tracepoint|export] [--threads N] [--reactions N] [--reactors N]\n"
+          "          [--repetitions N] [--baseline FILE] [--scaling]\n"
+          "\n"
+          "  --reactions N   reaction executions per thread (default: 2000000, 200000 for export)\n"
+          "  --baseline FILE output of an earlier run; the gain over its RESULT line is printed\n"
+          "  --scaling       run with 1, 2, 4, ... up to --threads threads and report the scaling\n",
+          program);
+}
+
+static int parse_options(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+    if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+      usage(argv[0]);
+      exit(0);
+    }
+    if (strcmp(arg, "--scaling") == 0) {
+      options.scaling = 1;
+      continue;
+    }
+    if (!value) {
+      usage(argv[0]);
+      return -1;
+    }
+    if (strcmp(arg, "--mode") == 0) {
+      options.mode = value;
+    } else if (strcmp(arg, "--threads") == 0) {
+      options.threads = atoi(value);
+    } else if (strcmp(arg, "--reactions") == 0) {
+      options.reactions = atoll(value);
+    } else if (strcmp(arg, "--reactors") == 0) {
+      options.reactors = atoi(value);
+    } else if (strcmp(arg, "--repetitions") == 0) {
+      options.repetitions = atoi(value);
+    } else if (strcmp(arg, "--baseline") == 0) {
+      options.baseline = value;
+    } else {
+      usage(argv[0]);
+      return -1;
+    }
+    i++;
+  }
+  if (strcmp(options.mode, "tracepoint") != 0 && strcmp(options.mode, "export") != 0) {
+    fprintf(stderr, "Unknown mode: %s\n", options.mode);
+    return -1;
+  }
+#ifdef LF_TRACE_NO_OTEL
+  const char* exporter = getenv("LF_TRACE_EXPORTER");
+  if (strcmp(options.mode, "export") == 0 && !(exporter && strcmp(exporter, "otlp-http") == 0)) {
+    fprintf(stderr, "The export mode requires a plugin built with the OpenTelemetry exporter, "
+                    "or the built-in one (LF_TRACE_EXPORTER=otlp-http).\n");
+    return -1;
+  }
+#endif
+  if (options.threads < 1 || options.threads > BENCH_MAX_THREADS || options.reactors < 1 ||
+      options.repetitions < 1) {
+    usage(argv[0]);
+    return -1;
+  }
+  if (options.reactions <= 0) {
+    options.reactions = strcmp(options.mode, "export") == 0 ? 200000 : 2000000;
+  }
+  return 0;
+}
+
+/**
+ * @brief Configure the plugin for the selected mode.
+ *
+ * Settings already present in the environment take precedence, so that other sink
+ * combinations can be measured too.
+ */
+static void configure_environment(char* shm_name, size_t size) {
+  if (strcmp(options.mode, "export") == 0) {
+    setenv("LF_TRACE_OTEL", "1", 0);
+    setenv("LF_TRACE_FILE", "0", 0);
+    return;
+  }
+  setenv("LF_TRACE_OTEL", "0", 0);
+  if (!getenv("LF_TRACE_FILE") && !getenv("LF_TRACE_SHM")) {
+    snprintf(shm_name, size, "/lf-trace-bench-%d", (int)getpid());
+    setenv("LF_TRACE_SHM", shm_name, 1);
+  }
+}
+
+static void register_objects(void) {
+  reactor_names = (char*)calloc((size_t)options.reactors, 32);
+  reactor_objects = (char*)calloc((size_t)options.reactors, 64);
+  if (!reactor_names || !reactor_objects) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  for (int i = 0; i < options.reactors; i++) {
+    char* name = reactor_names + (size_t)i * 32;
+    snprintf(name, 32, "Main.r%d", i);
+    object_description_t description = {
+        .pointer = reactor_objects + (size_t)i * 64, .trigger = NULL, .type = trace_reactor, .description = name};
+    lf_tracing_register_trace_event(description);
+  }
+}
+
+/**
+ * @brief Emit the events of one reaction execution.
+ *
+ * Mirrors what reactor-c emits around a reaction: the scheduler events for the
+ * triggering event, then the reaction itself.
+ */
+static inline void run_reaction(int worker, long long n, int64_t logical_time, int64_t physical_time) {
+  int reactor = (int)(n % options.reactors);
+  void* pointer = reactor_objects + (size_t)reactor * 64;
+  trace_record_nodeps_t tr = {.event_type = worker_wait_starts,
+                              .pointer = NULL,
+                              .src_id = worker,
+                              .dst_id = -1,
+                              .logical_time = logical_time,
+                              .microstep = 0,
+                              .physical_time = physical_time,
+                              .trigger = NULL,
+                              .extra_delay = 0};
+  if ((n & 7) == 0) {
+    lf_tracing_tracepoint(worker, &tr);
+    tr.event_type = worker_wait_ends;
+    lf_tracing_tracepoint(worker, &tr);
+    tr.event_type = scheduler_advancing_time_starts;
+    lf_tracing_tracepoint(worker, &tr);
+    tr.event_type = scheduler_advancing_time_ends;
+    lf_tracing_tracepoint(worker, &tr);
+  }
+  tr.event_type = reaction_starts;
+  tr.pointer = pointer;
+  tr.dst_id = (int)(n & 3);
+  lf_tracing_tracepoint(worker, &tr);
+  tr.event_type = reaction_ends;
+  tr.physical_time += 100;
+  lf_tracing_tracepoint(worker, &tr);
+}
+
+static void* worker_main(void* arg) {
+  bench_worker_t* worker = (bench_worker_t*)arg;
+  bench_set_thread_id(worker->id);
+  pthread_barrier_wait(&start_barrier);
+  // Physical times are synthesized so that reading the clock is not part of the measurement.
+  int64_t start = now_ns();
+  for (long long n = 0; n < worker->reactions; n++) {
+    run_reaction(worker->id, n, (n / options.reactors) * 1000000LL, start + n * 1000);
+  }
+  return NULL;
+}
+
+/** @brief Run the workload once with the given number of workers and return the elapsed time in nanoseconds. */
+static int64_t run_once(int threads) {
+  bench_worker_t workers[BENCH_MAX_THREADS];
+  pthread_barrier_init(&start_barrier, NULL, (unsigned)threads + 1);
+  for (int i = 0; i < threads; i++) {
+    workers[i].id = i;
+    workers[i].reactions = options.reactions;
+    if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) {
+      fprintf(stderr, "Failed to create thread: %s\n", strerror(errno));
+      exit(1);
+    }
+  }
+  pthread_barrier_wait(&start_barrier);
+  int64_t start = now_ns();
+  for (int i = 0; i < threads; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  int64_t elapsed = now_ns() - start;
+  pthread_barrier_destroy(&start_barrier);
+  return elapsed;
+}
+
+/** @brief Events per reaction execution as emitted by run_reaction(). */
+static double events_per_reaction(void) { return 2.0 + 4.0 / 8.0; }
+
+/** @brief Run the workload repeatedly and return the fastest elapsed time in nanoseconds. */
+static int64_t run_best(int threads) {
+  // The first run warms up caches, allocators and the exporter; it is not reported.
+  int64_t best = -1;
+  for (int r = 0; r <= options.repetitions; r++) {
+    int64_t elapsed = run_once(threads);
+    if (r > 0 && (best < 0 || elapsed < best)) {
+      best = elapsed;
+    }
+  }
+  return best;
+}
+
+/**
+ * @brief Find the result for the current mode and a thread count in the output of an earlier run.
+ *
+ * @return ns/event of the baseline, or a negative value if there is none.
+ */
+static double read_baseline(const char* path, int threads) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "WARNING: Cannot open baseline %s: %s\n", path, strerror(errno));
+    return -1.0;
+  }
+  char line[256];
+  double result = -1.0;
+  while (fgets(line, sizeof(line), file)) {
+    char mode[32];
+    int baseline_threads;
+    double ns_per_event;
+    if (sscanf(line, "RESULT %31s %d %lf", mode, &baseline_threads, &ns_per_event) == 3 &&
+        strcmp(mode, options.mode) == 0 && baseline_threads == threads) {
+      result = ns_per_event;
+    }
+  }
+  fclose(file);
+  return result;
+}
+
+// MAIN **********************************************************************
+
+int main(int argc, char** argv) {
+  if (parse_options(argc, argv) != 0) {
+    return 2;
+  }
+  char shm_name[64] = "";
+  configure_environment(shm_name, sizeof(shm_name));
+
+  lf_tracing_global_init("lf-trace-bench", NULL, 0, options.threads);
+  register_objects();
+  lf_tracing_set_start_time(now_ns());
+
+  // Without --scaling, only the requested thread count is measured.
+  int counts[BENCH_MAX_THREADS];
+  int num_counts = 0;
+  for (int threads = options.scaling ? 1 : options.threads; threads < options.threads; threads *= 2) {
+    counts[num_counts++] = threads;
+  }
+  counts[num_counts++] = options.threads;
+  int64_t best[BENCH_MAX_THREADS];
+  for (int i = 0; i < num_counts; i++) {
+    best[i] = run_best(counts[i]);
+  }
+
+  int64_t shutdown_start = now_ns();
+  lf_tracing_global_shutdown();
+  int64_t shutdown_ns = now_ns() - shutdown_start;
+
+  double single_rate = 0.0;
+  for (int i = 0; i < num_counts; i++) {
+    double events = events_per_reaction() * (double)options.reactions * counts[i];
+    double ns_per_event = (double)best[i] / events;
+    double rate = events / ((double)best[i] / 1e3);
+    printf("mode=%s threads=%d reactions/thread=%lld events=%.0f\n", options.mode, counts[i], options.reactions,
+           events);
+    printf("  best of %d: %.3f s, %.1f ns/event, %.2f Mevents/s\n", options.repetitions, (double)best[i] / 1e9,
+           ns_per_event, rate);
+    if (options.scaling) {
+      if (counts[i] == 1) {
+        single_rate = rate;
+      }
+      printf("  scaling: %.2fx one thread, %.0f%% efficiency\n", rate / single_rate,
+             rate / (single_rate * counts[i]) * 100.0);
+    }
+    printf("RESULT %s %d %.3f\n", options.mode, counts[i], ns_per_event);
+
+    if (options.baseline) {
+      double baseline = read_baseline(options.baseline, counts[i]);
+      if (baseline > 0) {
+        printf("  baseline: %.1f ns/event, gain: %+.1f%%\n", baseline, (baseline - ns_per_event) / baseline * 100.0);
+      } else {
+        printf("  baseline: no %s result for %d threads in %s\n", options.mode, counts[i], options.baseline);
+      }
+    }
+  }
+  printf("shutdown %.1f ms\n", (double)shutdown_ns / 1e6);
+
+  if (shm_name[0] != '\0') {
+    shm_unlink(shm_name);
+  }
+  free(reactor_names);
+  free(reactor_objects);
+  return 0;
+}
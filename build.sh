@@ -12,6 +12,9 @@ PREFIX=""  # Build-time CMAKE_INSTALL_PREFIX (set via --prefix). If empty, use C
 LOG_LEVEL="${LOG_LEVEL:-4}"
 DO_CLEAN=0
 DO_INSTALL=0
+DO_PGO=0
+NO_OTEL=0
+EXTRA_CMAKE_ARGS=()
 
 while [[ $# -gt 0 ]]; do
   case "$1" in
@@ -35,11 +38,28 @@ while [[ $# -gt 0 ]]; do
       DO_CLEAN=1
       shift 1
       ;;
+    --shared-exporter)
+      EXTRA_CMAKE_ARGS+=(-DLF_TRACE_SHARED_EXPORTER=ON)
+      shift 1
+      ;;
+    --merged-archive)
+      EXTRA_CMAKE_ARGS+=(-DLF_TRACE_MERGED_ARCHIVE=ON)
+      shift 1
+      ;;
+    --no-otel)
+      EXTRA_CMAKE_ARGS+=(-DINCLUDE_OTEL=OFF)
+      NO_OTEL=1
+      shift 1
+      ;;
+    --pgo)
+      DO_PGO=1
+      shift 1
+      ;;
     -h|--help)
       cat <<'EOF'
 Usage:
   # Build (configure + build). Does NOT install:
-  ./build.sh [--log-level <n>] [--prefix <prefix> | --prefix=<prefix>] [--clean]
+  ./build.sh [--log-level <n>] [--prefix <prefix> | --prefix=<prefix>] [--shared-exporter | --merged-archive] [--no-otel] [--pgo] [--clean]
 
   # Install-only (no configure/build). Requires a prior build:
   ./build.sh --install
@@ -49,6 +69,15 @@ Usage:
 
 Options:
   --prefix <prefix>: set CMAKE_INSTALL_PREFIX at configure/build time.
+  --shared-exporter: build the OpenTelemetry exporter as a shared library (lib/liblf-trace-otel)
+    that the plugin opens at runtime, so LF programs link only the small static plugin.
+  --merged-archive: LTO-optimize the plugin together with all of its dependencies and install them
+    as a single lib/liblf-trace-impl.a that exports only the lf_tracing_* API (Linux only).
+  --no-otel: build without the OpenTelemetry exporter (no gRPC/protobuf); the plugin records to
+    an LF trace file and/or a shared-memory ring only.
+  --pgo: build with profile-guided optimization. Builds an instrumented plugin, trains it with the
+    tracepoint and export benchmarks (lf-trace-bench), then rebuilds it with the profile and reports
+    the gain over a non-PGO build. Results are kept in build/pgo/.
   --install: install-only to the configured CMAKE_INSTALL_PREFIX (no rebuild; like `make install`).
   --clean: clears cached third-party dependencies in build/_deps/.
 
@@ -114,9 +143,52 @@ if [[ -n "${PREFIX}" ]]; then
   cmake_args+=(-DCMAKE_INSTALL_PREFIX="${PREFIX}")
 fi
 
+cmake_args+=("${EXTRA_CMAKE_ARGS[@]+"${EXTRA_CMAKE_ARGS[@]}"}")
+
+if [[ "${DO_PGO}" -eq 1 ]]; then
+  pgo_dir="${BUILD_DIR}/pgo"
+  bench_modes=(tracepoint)
+  if [[ "${NO_OTEL}" -eq 0 ]]; then
+    bench_modes+=(export)
+  fi
+  run_bench() {
+    local output="$1"
+    shift
+    : > "${output}"
+    for mode in "${bench_modes[@]}"; do
+      "${BUILD_DIR}/lf-trace-bench" --mode "${mode}" "$@" | tee -a "${output}"
+    done
+  }
+  # Profiles only pay off on optimized code, so all three builds are release builds.
+  cmake_args+=(-DCMAKE_BUILD_TYPE=Release)
+  pgo_build() {
+    cmake "${cmake_args[@]}" -DBUILD_TRACE_BENCH=ON -DLF_TRACE_PGO="$1"
+    cmake --build "${BUILD_DIR}" -j8 --target lf-trace-bench
+  }
+  rm -rf "${pgo_dir}"
+  mkdir -p "${pgo_dir}"
+
+  echo "PGO 1/3: baseline build..."
+  pgo_build OFF
+  run_bench "${pgo_dir}/baseline.txt"
+
+  echo "PGO 2/3: instrumented build and training run..."
+  pgo_build GENERATE
+  run_bench "${pgo_dir}/training.txt"
+  if compgen -G "${pgo_dir}/profile/*.profraw" > /dev/null; then
+    # Clang writes raw profiles that have to be merged first.
+    llvm-profdata merge -output="${pgo_dir}/profile/default.profdata" "${pgo_dir}/profile/"*.profraw
+  fi
+
+  echo "PGO 3/3: optimized build..."
+  pgo_build USE
+  run_bench "${pgo_dir}/optimized.txt" --baseline "${pgo_dir}/baseline.txt"
+  cmake_args+=(-DBUILD_TRACE_BENCH=ON -DLF_TRACE_PGO=USE)
+fi
+
 cmake "${cmake_args[@]}"
 
-cmake --build "${BUILD_DIR}" -j8 --target lf-trace-impl
+cmake --build "${BUILD_DIR}" -j8 --target lf-trace-package
 echo "Build complete!"
 
 resolved_prefix="$(sed -n 's/^CMAKE_INSTALL_PREFIX:PATH=//p' "${BUILD_DIR}/CMakeCache.txt" | tail -n 1)"
@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef CRITICAL_PATH_H
+#define CRITICAL_PATH_H
+
+#include <stdint.h>
+
+#include "trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Reaction executions buffered per worker between two passes of the analysis thread. */
+#define CRITICAL_PATH_RING_RECORDS 16384
+
+/** Milliseconds between two passes of the analysis thread. */
+#define CRITICAL_PATH_POLL_MS 10
+
+/** Steps kept of a critical path; longer paths keep the steps closest to the end of the tag. */
+#define CRITICAL_PATH_MAX_STEPS 32
+
+/** @brief A reaction execution, as recorded by a worker. */
+typedef struct critical_path_execution {
+  int32_t reaction;     ///< Dense reaction ID
+  int32_t worker;       ///< Worker that executed it (-1 for threads not managed by LF)
+  int64_t logical_time; ///< Tag of the execution
+  int64_t microstep;
+  int64_t start_time;   ///< Physical times of the reaction_starts and reaction_ends
+  int64_t end_time;
+} critical_path_execution_t;
+
+/**
+ * @brief The critical path of a tag, as handed to a critical_path_handler_t.
+ *
+ * The executions of a tag are ordered by inferring, for each one, the execution it waited
+ * for: the one of the same tag that ended last before it started. LF starts a reaction as
+ * soon as the reactions it depends on have ended, so this is its last dependency unless a
+ * worker was not available. The critical path is the chain of such predecessors that ends
+ * with the last execution of the tag; it bounds the tag's latency.
+ */
+typedef struct critical_path {
+  int64_t logical_time;   ///< The tag
+  int64_t microstep;
+  int64_t end_time;       ///< Physical time at which the last execution of the tag ended
+  int64_t latency;        ///< end_time minus the logical time
+  int64_t busy_time;      ///< Time spent executing the reactions of the path
+  int64_t slack;          ///< Least time by which an execution off the path ended before end_time, or -1 if none
+  int executions;         ///< Number of executions at the tag
+  int length;             ///< Number of executions on the path
+  int num_steps;          ///< Entries in `steps` (at most CRITICAL_PATH_MAX_STEPS)
+  critical_path_execution_t steps[CRITICAL_PATH_MAX_STEPS]; ///< The last num_steps executions of the path, in order
+} critical_path_t;
+
+/** @brief Called on the analysis thread with each reported path; the path is only valid during the call. */
+typedef void (*critical_path_handler_t)(const critical_path_t* path);
+
+/**
+ * @brief Allocate the per-worker rings and start the analysis thread.
+ *
+ * A tag is analyzed once an execution of a later tag has been recorded, or at close.
+ *
+ * @param num_buffers Number of LF-managed threads (one more ring is added for other threads)
+ * @param interval 0 to report every tag, else the nanoseconds of physical time over which
+ *        only the tag with the largest latency is reported
+ * @param handler Called with every reported path
+ * @return 0 on success, -1 on failure
+ */
+int critical_path_open(int num_buffers, int64_t interval, critical_path_handler_t handler);
+
+/**
+ * @brief Record a reaction execution.
+ *
+ * Each ring has a single writer: buffer -1 must be serialized by the caller. When the
+ * analysis thread falls behind and the ring is full, the execution is dropped.
+ *
+ * @param buffer The buffer index (the LF thread ID, or -1)
+ * @param reaction The dense reaction ID
+ * @param end The reaction_ends record
+ * @param start_time Physical time of the matching reaction_starts
+ */
+void critical_path_record(int buffer, int reaction, const trace_record_nodeps_t* end, int64_t start_time);
+
+/** @brief Analyze the tags still pending, stop the analysis thread and free the rings. */
+void critical_path_close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRITICAL_PATH_H
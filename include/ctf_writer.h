@@ -0,0 +1,101 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef CTF_WRITER_H
+#define CTF_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Magic number at the start of every CTF packet. */
+#define CTF_MAGIC 0xc1fc1fc1u
+
+/** Size of the packets of a stream, header included. */
+#define CTF_PACKET_SIZE (256 * 1024)
+
+/**
+ * @brief Packet header and context, as declared in the metadata.
+ *
+ * Every field is byte-aligned, so that the structures below are the exact layout.
+ * `cpu_id` holds the worker (-1 for threads not managed by LF), which is what Trace
+ * Compass shows as the CPU of an event.
+ */
+typedef struct __attribute__((packed)) ctf_packet_header {
+  uint32_t magic;           ///< CTF_MAGIC
+  uint8_t uuid[16];         ///< UUID of the trace, as in the metadata
+  uint32_t stream_id;       ///< Always 0: a single stream class
+  uint64_t timestamp_begin; ///< Timestamp of the first event
+  uint64_t timestamp_end;   ///< Timestamp of the last event
+  uint64_t content_size;    ///< Size of the packet in bits, header included
+  uint64_t packet_size;     ///< Same as content_size: packets are not padded
+  int32_t cpu_id;           ///< Worker of the stream
+} ctf_packet_header_t;
+
+/**
+ * @brief An event of the `lf_trace` stream: the header, then the fields of a trace record.
+ *
+ * `id` is the trace_event_t, and the event is named after trace_event_names[].
+ * `timestamp` is the record's physical time, raised to that of the previous event of the
+ * stream if the clock went backwards.
+ */
+typedef struct __attribute__((packed)) ctf_event {
+  uint64_t timestamp;
+  uint32_t id;
+  int32_t src_id;
+  int32_t dst_id;
+  uint64_t pointer;
+  int64_t logical_time;
+  int64_t microstep;
+  uint64_t trigger;
+  int64_t extra_delay;
+} ctf_event_t;
+
+/**
+ * @brief Create a CTF 1.8 trace directory.
+ *
+ * The directory holds:
+ * - `metadata`, the TSDL description of the trace, written here;
+ * - a stream file per worker (`worker_<n>`, `other_threads` for threads not managed by
+ *   LF), created on the worker's first event and written in packets of CTF_PACKET_SIZE;
+ * - `objects`, with an `lf_object` event per registered trace object, written on close
+ *   so that tools can name the pointers of the other events.
+ *
+ * @param directory The directory, created if it does not exist
+ * @param num_buffers Number of LF-managed threads
+ * @param process_name Recorded in the environment of the trace, or NULL
+ * @return 0 on success, -1 on failure
+ */
+int ctf_writer_open(const char* directory, int num_buffers, const char* process_name);
+
+/** @brief Set the timestamp of the `lf_object` events. */
+void ctf_writer_set_start_time(int64_t start_time);
+
+/**
+ * @brief Append a record to the stream of the given buffer.
+ *
+ * Each stream has a single writer: buffer -1 must be serialized by the caller.
+ *
+ * @param buffer The buffer index (the LF thread ID, or -1)
+ * @param tr The record
+ */
+void ctf_writer_record(int buffer, const trace_record_nodeps_t* tr);
+
+/**
+ * @brief Write the last packet of every stream and the object table, and close the files.
+ *
+ * @param descriptions The registered trace objects
+ * @param num_descriptions The number of entries in `descriptions`
+ */
+void ctf_writer_close(const object_description_t* descriptions, size_t num_descriptions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CTF_WRITER_H
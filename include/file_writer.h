@@ -0,0 +1,79 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef FILE_WRITER_H
+#define FILE_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size of the chunks a file is written in. A multiple of any O_DIRECT alignment. */
+#define FILE_WRITER_CHUNK_SIZE ((size_t)1 << 20)
+
+/** Number of chunks: one being filled, the others in flight or free. */
+#define FILE_WRITER_CHUNKS 8
+
+/** @brief How chunks reach the file (LF_TRACE_FILE_IO). */
+typedef enum file_writer_mode {
+  FILE_WRITER_AUTO = 0,  ///< io_uring if the kernel allows it, else a writer thread (default, "auto")
+  FILE_WRITER_IO_URING,  ///< io_uring only; opening fails without it ("io_uring")
+  FILE_WRITER_THREAD,    ///< A thread calling pwrite(2) ("thread")
+} file_writer_mode_t;
+
+/** @brief File opened for asynchronous sequential writing. */
+typedef struct file_writer file_writer_t;
+
+/**
+ * @brief Parse the value of LF_TRACE_FILE_IO.
+ *
+ * @param value "auto", "io_uring", "thread", or NULL for the default
+ * @param mode Receives the mode
+ * @return 0 on success, -1 if the value is not recognized
+ */
+int file_writer_parse_mode(const char* value, file_writer_mode_t* mode);
+
+/**
+ * @brief Create a file to be written asynchronously.
+ *
+ * Appended bytes are gathered into page-aligned chunks of FILE_WRITER_CHUNK_SIZE. A full
+ * chunk is submitted as one write at its offset and returns to the pool only when the
+ * write has completed, so appending never waits for the disk unless every chunk is in
+ * flight. With io_uring, the chunks are registered with the kernel once, and completions
+ * are reaped by the appending thread; otherwise a writer thread calls pwrite(2).
+ *
+ * @param path The file to create or truncate
+ * @param mode How to write
+ * @param direct Open with O_DIRECT, bypassing the page cache; ignored where the file system refuses it
+ * @return The writer, or NULL on failure (errno is set)
+ */
+file_writer_t* file_writer_open(const char* path, file_writer_mode_t mode, int direct);
+
+/**
+ * @brief Append bytes. Not thread-safe: callers serialize appends.
+ *
+ * @return 0 on success, -1 if a write failed (the writer then drops further data)
+ */
+int file_writer_append(file_writer_t* writer, const void* data, size_t size);
+
+/** @brief Offset in the file of the next byte appended. */
+uint64_t file_writer_offset(const file_writer_t* writer);
+
+/** @brief The mechanism in use, e.g. "io_uring", for messages. */
+const char* file_writer_backend_name(const file_writer_t* writer);
+
+/**
+ * @brief Write the last partial chunk, wait for every write and close the file.
+ *
+ * @return 0 if all the data was written, -1 otherwise
+ */
+int file_writer_close(file_writer_t* writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FILE_WRITER_H
@@ -0,0 +1,76 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Records of all workers around a trigger, as handed to a flight_recorder_handler_t.
+ *
+ * The arrays are indexed from -1 like the worker buffers: `records[-1]` holds the records
+ * of threads not managed by LF. The records of each buffer are in the order they were
+ * written and lie in [trigger_time - before, trigger_time + after] in physical time.
+ */
+typedef struct flight_recorder_snapshot {
+  int num_buffers;                             ///< Number of LF-managed buffers
+  const trace_record_nodeps_t* const* records; ///< Records of each buffer
+  const size_t* counts;                        ///< Number of records of each buffer
+  size_t lost;                                 ///< Records overwritten while the rings were being copied
+  int truncated;                               ///< Whether a ring wrapped within the pre-trigger window
+  int64_t trigger_time;                        ///< Physical time of the trigger
+  const char* reason;                          ///< What triggered the capture
+  unsigned sequence;                           ///< Number of the capture, starting at 0
+} flight_recorder_snapshot_t;
+
+/** @brief Called on the recorder thread with each capture; the snapshot is only valid during the call. */
+typedef void (*flight_recorder_handler_t)(const flight_recorder_snapshot_t* snapshot);
+
+/**
+ * @brief Allocate the per-worker rings and start the recorder thread.
+ *
+ * @param num_buffers Number of LF-managed threads (one more ring is added for other threads)
+ * @param ring_capacity Records per ring, rounded up to a power of two
+ * @param before Nanoseconds of physical time captured before a trigger
+ * @param after Nanoseconds of physical time captured after a trigger
+ * @param signal_number Signal that triggers a capture, or 0 for none
+ * @param handler Called with every capture
+ * @return 0 on success, -1 on failure
+ */
+int flight_recorder_open(int num_buffers, uint64_t ring_capacity, int64_t before, int64_t after, int signal_number,
+                         flight_recorder_handler_t handler);
+
+/**
+ * @brief Append a record to the ring of the given buffer, overwriting the oldest record when full.
+ *
+ * Each ring has a single writer: buffer -1 must be serialized by the caller.
+ */
+void flight_recorder_record(int buffer, const trace_record_nodeps_t* tr);
+
+/**
+ * @brief Request a capture around the given physical time.
+ *
+ * Returns immediately; the capture is taken on the recorder thread once the post-trigger
+ * window has passed. Triggers arriving while a capture is pending are ignored.
+ *
+ * @param physical_time Physical time of the trigger, or 0 for the current time
+ * @param reason Static string describing the trigger
+ */
+void flight_recorder_trigger(int64_t physical_time, const char* reason);
+
+/** @brief Stop the recorder thread (taking a pending capture first) and free the rings. */
+void flight_recorder_close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLIGHT_RECORDER_H
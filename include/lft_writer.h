@@ -0,0 +1,106 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef LFT_WRITER_H
+#define LFT_WRITER_H
+
+#include <stdint.h>
+
+#include "trace_impl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Magic number at the start of the block index written next to the trace file (`<trace file>.idx`). */
+#define LFT_INDEX_MAGIC 0x4946544cu
+
+/** Version of the block index format. */
+#define LFT_INDEX_VERSION 1
+
+/**
+ * @brief Entry of the block index, one per block of the trace file.
+ *
+ * The index lets readers locate blocks and skip those outside a time window
+ * without touching the trace file itself. It follows a header of two
+ * `uint32_t` values, LFT_INDEX_MAGIC and LFT_INDEX_VERSION.
+ */
+typedef struct lft_index_entry {
+  uint64_t offset;           ///< File offset of the block (its record count)
+  int32_t count;             ///< Number of records in the block
+  int32_t buffer;            ///< Worker buffer the block was flushed from (-1 for non-LF threads)
+  int64_t min_logical_time;  ///< Smallest logical time in the block
+  int64_t max_logical_time;  ///< Largest logical time in the block
+  int64_t min_physical_time; ///< Smallest physical time in the block
+  int64_t max_physical_time; ///< Largest physical time in the block
+} lft_index_entry_t;
+
+/**
+ * @brief Open the trace file and allocate per-worker record buffers.
+ *
+ * Writes the standard Lingua Franca binary trace format (`.lft`) consumed by
+ * `trace_to_csv`, `trace_to_chrome` and friends:
+ * - a header with the start time and the object description table, written
+ *   lazily on the first flush so that objects registered in startup reactions
+ *   are included;
+ * - a sequence of blocks, each an `int` record count followed by that many
+ *   raw `trace_record_nodeps_t` records from a single worker buffer.
+ *
+ * A block index (see lft_index_entry_t) is written to `<filename>.idx`.
+ *
+ * @param trace The trace state whose buffers and file fields are initialized
+ * @param filename The path of the trace file to create
+ * @param max_num_local_threads Upper bound on the number of LF-managed threads
+ * @return 0 on success, -1 on failure (the writer is then left disabled)
+ */
+int lft_writer_open(trace_t* trace, const char* filename, int max_num_local_threads);
+
+/**
+ * @brief Append a record to the buffer of the given worker.
+ *
+ * When the buffer is full, it is flushed to the file as a single block.
+ * Buffer -1 is shared by threads not managed by LF; callers must serialize
+ * access to it.
+ *
+ * @param trace The trace state
+ * @param buffer The buffer index (the LF thread ID, or -1)
+ * @param tr The record to append
+ */
+void lft_writer_record(trace_t* trace, int buffer, const trace_record_nodeps_t* tr);
+
+/**
+ * @brief Flush all buffers, close the trace file and free the buffers.
+ *
+ * @param trace The trace state
+ */
+void lft_writer_close(trace_t* trace);
+
+/**
+ * @brief Write a complete trace file from records captured elsewhere.
+ *
+ * Independent of the file opened with lft_writer_open(); used for flight recorder
+ * captures. The object description table of `trace` is written as the header, and the
+ * records of each buffer as consecutive blocks. No block index is written.
+ *
+ * @param trace The trace state holding the object descriptions
+ * @param filename The path of the trace file to create
+ * @param num_buffers Number of LF-managed buffers
+ * @param records Records of each buffer, indexed from -1
+ * @param counts Number of records of each buffer, indexed from -1
+ * @return 0 on success, -1 on failure
+ */
+int lft_writer_write_snapshot(const trace_t* trace, const char* filename, int num_buffers,
+                              const trace_record_nodeps_t* const* records, const size_t* counts);
+
+/**
+ * @brief Set the start time written into the trace header.
+ *
+ * @param start_time The logical start time of the program
+ */
+void lft_writer_set_start_time(int64_t start_time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LFT_WRITER_H
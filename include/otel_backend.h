@@ -6,6 +6,8 @@
 
 #include <stdint.h>
 
+#include "trace.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -19,8 +21,72 @@ typedef struct otel_backend {
   char* hostname;             ///< Hostname
   int64_t pid;                ///< Process ID
   int initialized;            ///< Initialization flag (1 if initialized, 0 otherwise)
+  void* tracer;               ///< Tracer used to create spans (valid once initialized)
 } otel_backend_t;
 
+/**
+ * @brief The trigger (timer or action) that caused a span, and who scheduled it
+ *
+ * A schedule_called span and the reaction spans it caused carry the same
+ * `xronos.trigger_fqn`; the reaction spans also carry the tag of the schedule
+ * (`xronos.trigger.timestamp` and `xronos.trigger.microstep`), which equals the
+ * `xronos.timestamp` and `xronos.microstep` of the schedule_called span.
+ */
+typedef struct otel_trigger_info {
+  const char* trigger_fqn;  ///< Description of the trigger
+  const char* source_fqn;   ///< FQN of the scheduling reaction, or NULL if scheduled outside a reaction
+  int64_t timestamp;        ///< Logical time of the schedule_called
+  int64_t microstep;        ///< Microstep of the schedule_called
+  int64_t latency;          ///< Physical time from the schedule to the reaction, or -1 for the schedule itself
+} otel_trigger_info_t;
+
+/**
+ * @brief The critical path of a tag, as computed by the critical path analysis
+ *
+ * See critical_path_t for how the path is inferred.
+ */
+typedef struct otel_critical_path {
+  int64_t timestamp;          ///< Logical time of the tag
+  int64_t microstep;          ///< Microstep of the tag
+  int64_t end_time;           ///< Physical time at which the last reaction of the tag ended
+  const char* path;           ///< FQNs of the reactions on the path, in order, separated by " -> "
+  const char* bottleneck_fqn; ///< FQN of the reaction of the path that executed longest
+  int length;                 ///< Number of reactions on the path
+  int reactions;              ///< Number of reactions executed at the tag
+  int64_t latency;            ///< end_time minus the logical time
+  int64_t busy_time;          ///< Time spent executing the reactions of the path
+  int64_t slack;              ///< Least time by which a reaction off the path ended before end_time, or -1
+} otel_critical_path_t;
+
+/**
+ * @brief The executions of a reaction over an interval, as summarized by the outlier detector
+ *
+ * The moving averages cover the last executions of the reaction, whatever the interval.
+ */
+typedef struct otel_reaction_summary {
+  int64_t start_time;      ///< Physical time at which the first execution of the interval started
+  int64_t end_time;        ///< Physical time at which the last execution of the interval ended
+  int64_t executions;      ///< Executions in the interval, outliers included
+  int64_t outliers;        ///< Executions exported as spans because they were outliers
+  int64_t total_duration;  ///< Sum of the execution times
+  int64_t max_duration;    ///< Longest execution time
+  int64_t duration_mean;   ///< Moving average of the execution time
+  int64_t duration_stddev; ///< Moving standard deviation of the execution time
+  int64_t lag_mean;        ///< Moving average of the lag (start minus logical time)
+  int64_t lag_stddev;      ///< Moving standard deviation of the lag
+} otel_reaction_summary_t;
+
+/**
+ * @brief Batch span processor settings of an exporter
+ *
+ * Zero leaves the setting to the OTEL_BSP_* environment variable of the same name, or to its default.
+ */
+typedef struct otel_batch_settings {
+  int64_t schedule_delay_ms;     ///< OTEL_BSP_SCHEDULE_DELAY
+  int64_t max_queue_size;        ///< OTEL_BSP_MAX_QUEUE_SIZE
+  int64_t max_export_batch_size; ///< OTEL_BSP_MAX_EXPORT_BATCH_SIZE
+} otel_batch_settings_t;
+
 /**
  * @brief Create and initialize an OpenTelemetry backend
  * 
@@ -40,7 +106,7 @@ otel_backend_t* otel_backend_create(const char* endpoint,
 /**
  * @brief Initialize the OpenTelemetry backend
  * 
- * Configures the exporter and initializes the tracer provider.
+ * Configures the exporter, initializes the tracer provider and gets the tracer.
  * 
  * Note: The opentelemetry-c API has limitations:
  * - Resource attributes are limited to service_name, service_version, 
@@ -60,12 +126,214 @@ int otel_backend_initialize(otel_backend_t* backend);
  * 
  * Note: The opentelemetry-c API doesn't provide a direct way to set a NoopTracerProvider.
  * The cleanup here frees the backend resources. The tracer provider will remain active
- * until the process exits or otelc_init_tracer_provider() is called again.
+ * until the process exits or otelc_init_tracer_provider() is called again, so spans
+ * still queued must be exported with otel_backend_flush() first.
  * 
  * @param backend The backend to destroy
  */
 void otel_backend_destroy(otel_backend_t* backend);
 
+/**
+ * @brief Start a span for a reaction invocation
+ *
+ * Sets the reaction's low-cardinality attributes (element type, FQN, name,
+ * container FQN), the worker and the high-cardinality attributes of the trace record.
+ *
+ * @param backend The initialized backend
+ * @param worker The worker that executes the reaction (-1 for threads not managed by LF)
+ * @param reaction The dense ID the plugin assigned to the reaction, or -1 if it has none. IDs
+ *        never change, so a backend may keep per-reaction state under them.
+ * @param span_name The span name
+ * @param reaction_fqn The reaction FQN ("<reactor_fqn>.<reaction_number>"), or NULL if unknown
+ * @param reaction_number The reaction number
+ * @param reactor_fqn The FQN of the containing reactor, or NULL if unknown
+ * @param tr The reaction_starts trace record
+ * @param trigger The trigger that caused the reaction, or NULL if unknown
+ * @return The span, to be passed to otel_backend_end_span(), or NULL on failure
+ */
+void* otel_backend_start_reaction_span(otel_backend_t* backend,
+                                       int worker,
+                                       int reaction,
+                                       const char* span_name,
+                                       const char* reaction_fqn,
+                                       int reaction_number,
+                                       const char* reactor_fqn,
+                                       const trace_record_nodeps_t* tr,
+                                       const otel_trigger_info_t* trigger);
+
+/**
+ * @brief End a span started with otel_backend_start_reaction_span()
+ *
+ * @param backend The initialized backend
+ * @param span The span to end
+ */
+void otel_backend_end_span(otel_backend_t* backend, void* span);
+
+/**
+ * @brief End a reaction span whose reaction did not end before shutdown
+ *
+ * Marks the span with `xronos.incomplete` before ending it.
+ *
+ * @param backend The initialized backend
+ * @param span The span to end
+ */
+void otel_backend_end_incomplete_span(otel_backend_t* backend, void* span);
+
+/**
+ * @brief Export the spans queued in the batch span processor
+ *
+ * opentelemetry-c has no flush; this calls ForceFlush on the SDK tracer provider.
+ *
+ * @param backend The initialized backend
+ * @param timeout Nanoseconds to wait for the export
+ * @return 0 if everything was exported, -1 on timeout or failure
+ */
+int otel_backend_flush(otel_backend_t* backend, int64_t timeout);
+
+/**
+ * @brief Export a generic (non-reaction) trace event as an instantaneous span
+ *
+ * @param backend The initialized backend
+ * @param worker The worker that emitted the event (-1 for threads not managed by LF)
+ * @param event_name The span name (the event type name)
+ * @param tr The trace record
+ * @param trigger The trigger a schedule_called event schedules, or NULL
+ */
+void otel_backend_emit_event_span(otel_backend_t* backend, int worker, const char* event_name,
+                                  const trace_record_nodeps_t* tr, const otel_trigger_info_t* trigger);
+
+/**
+ * @brief Export a reaction execution captured earlier (by the flight recorder) as a span
+ *
+ * The opentelemetry-c API timestamps spans when they are started and ended, so the
+ * recorded start (`xronos.physical_time`) and execution time (`xronos.duration`, if the
+ * reaction ended within the capture) are attached as attributes.
+ *
+ * @param backend The initialized backend
+ * @param worker The worker that executed the reaction (-1 for threads not managed by LF)
+ * @param reaction The dense ID of the reaction, or -1 (see otel_backend_start_reaction_span())
+ * @param span_name The span name
+ * @param reaction_fqn The reaction FQN, or NULL if unknown
+ * @param reaction_number The reaction number
+ * @param reactor_fqn The FQN of the containing reactor, or NULL if unknown
+ * @param tr The recorded reaction_starts trace record
+ * @param end_physical_time Physical time of the matching reaction_ends, or -1 if not captured
+ */
+void otel_backend_emit_recorded_span(otel_backend_t* backend,
+                                     int worker,
+                                     int reaction,
+                                     const char* span_name,
+                                     const char* reaction_fqn,
+                                     int reaction_number,
+                                     const char* reactor_fqn,
+                                     const trace_record_nodeps_t* tr,
+                                     int64_t end_physical_time);
+
+/**
+ * @brief Start the timeline span of a worker
+ *
+ * A worker span covers an interval of the worker's activity and is named "worker <n>".
+ * The reaction spans of the worker carry the same `xronos.worker` attribute. opentelemetry-c
+ * offers no way to choose the parent of a span, so they are related by that attribute
+ * rather than by parenthood.
+ *
+ * @param backend The initialized backend
+ * @param worker The worker (-1 for threads not managed by LF)
+ * @return The span, to be passed to otel_backend_end_worker_span(), or NULL on failure
+ */
+void* otel_backend_start_worker_span(otel_backend_t* backend, int worker);
+
+/**
+ * @brief End a worker span with the totals of its interval
+ *
+ * @param backend The initialized backend
+ * @param span The span returned by otel_backend_start_worker_span()
+ * @param reactions Number of reactions the worker executed in the interval
+ * @param busy_time Nanoseconds the worker spent executing reactions in the interval
+ */
+void otel_backend_end_worker_span(otel_backend_t* backend, void* span, int64_t reactions, int64_t busy_time);
+
+/**
+ * @brief Export the critical path of a tag as a span named "critical path"
+ *
+ * The span carries the tag (`xronos.timestamp`, `xronos.microstep`) and the path
+ * (`xronos.critical_path`, `.length`, `.latency`, `.busy_time`, `.wait_time`, `.slack`,
+ * `.bottleneck`), where the wait time is the part of the latency not spent executing the
+ * path. The SDK times the span at export, so it also carries the end of the tag as
+ * `xronos.physical_time`.
+ *
+ * @param backend The initialized backend
+ * @param path The path
+ */
+void otel_backend_emit_critical_path_span(otel_backend_t* backend, const otel_critical_path_t* path);
+
+/**
+ * @brief Export the summary of a reaction's executions as a span named "reaction summary"
+ *
+ * The span has the reaction's low-cardinality attributes and carries the summary as
+ * `xronos.summary.executions`, `.outliers`, `.duration.total`, `.duration.max`,
+ * `.duration.mean`, `.duration.stddev`, `.lag.mean` and `.lag.stddev`.
+ *
+ * @param backend The initialized backend
+ * @param reaction The dense ID of the reaction (see otel_backend_start_reaction_span())
+ * @param reaction_fqn The reaction FQN, or NULL if unknown
+ * @param reaction_number The reaction number
+ * @param reactor_fqn The FQN of the containing reactor, or NULL if unknown
+ * @param summary The summary
+ */
+void otel_backend_emit_reaction_summary_span(otel_backend_t* backend, int reaction, const char* reaction_fqn,
+                                             int reaction_number, const char* reactor_fqn,
+                                             const otel_reaction_summary_t* summary);
+
+/**
+ * @brief Table of backend entry points
+ *
+ * The trace plugin calls the backend only through this table, so that the backend and
+ * its OpenTelemetry/gRPC dependencies can live in a separate shared library that is
+ * opened on first use (LF_TRACE_SHARED_EXPORTER build).
+ */
+typedef struct otel_backend_ops {
+  otel_backend_t* (*create)(const char* endpoint, const char* application_name, const char* hostname, int64_t pid);
+  int (*initialize)(otel_backend_t* backend);
+  /**
+   * Set the batch settings of a created backend before it is initialized. NULL if the backend
+   * reads them from the environment at startup only, as the SDK does for its global provider.
+   */
+  void (*set_batch_settings)(otel_backend_t* backend, const otel_batch_settings_t* batch);
+  void (*destroy)(otel_backend_t* backend);
+  void* (*start_reaction_span)(otel_backend_t* backend, int worker, int reaction, const char* span_name,
+                               const char* reaction_fqn, int reaction_number, const char* reactor_fqn,
+                               const trace_record_nodeps_t* tr, const otel_trigger_info_t* trigger);
+  void (*end_span)(otel_backend_t* backend, void* span);
+  void (*emit_event_span)(otel_backend_t* backend, int worker, const char* event_name, const trace_record_nodeps_t* tr,
+                          const otel_trigger_info_t* trigger);
+  void (*emit_recorded_span)(otel_backend_t* backend, int worker, int reaction, const char* span_name,
+                             const char* reaction_fqn, int reaction_number, const char* reactor_fqn,
+                             const trace_record_nodeps_t* tr, int64_t end_physical_time);
+  void* (*start_worker_span)(otel_backend_t* backend, int worker);
+  void (*end_worker_span)(otel_backend_t* backend, void* span, int64_t reactions, int64_t busy_time);
+  void (*end_incomplete_span)(otel_backend_t* backend, void* span);
+  int (*flush)(otel_backend_t* backend, int64_t timeout);
+  void (*emit_critical_path_span)(otel_backend_t* backend, const otel_critical_path_t* path);
+  void (*emit_reaction_summary_span)(otel_backend_t* backend, int reaction, const char* reaction_fqn,
+                                     int reaction_number, const char* reactor_fqn,
+                                     const otel_reaction_summary_t* summary);
+} otel_backend_ops_t;
+
+/** Name of the symbol holding the otel_backend_ops_t table in the exporter library. */
+#define OTEL_BACKEND_OPS_SYMBOL "lf_trace_otel_backend_ops"
+
+/**
+ * @brief Get the backend entry points
+ *
+ * In the default build this returns the statically linked backend. In the
+ * LF_TRACE_SHARED_EXPORTER build, the first call opens the exporter library
+ * (LF_TRACE_OTEL_LIBRARY, or the installed library) and resolves the table.
+ *
+ * @return The entry points, or NULL if the exporter library cannot be loaded
+ */
+const otel_backend_ops_t* otel_backend_load(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,28 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef OTEL_SDK_GLUE_H
+#define OTEL_SDK_GLUE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Force-flush the global OpenTelemetry SDK tracer provider
+ *
+ * opentelemetry-c installs an SDK tracer provider as the global provider but does not
+ * expose ForceFlush; this calls it through the C++ API.
+ *
+ * @param timeout Nanoseconds to wait for the span processors to export their queues
+ * @return 0 if the queues were exported, -1 on timeout or if the global provider is not an SDK provider
+ */
+int otel_sdk_force_flush(int64_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OTEL_SDK_GLUE_H
@@ -0,0 +1,128 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef OTLP_ENCODER_H
+#define OTLP_ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Growable byte buffer for protobuf output.
+ *
+ * It may start on storage provided by the caller (e.g. on the stack) and moves to the
+ * heap when that is too small. An allocation failure is sticky: further output is
+ * dropped and `failed` is set, so that callers check once at the end.
+ */
+typedef struct otlp_buffer {
+  uint8_t* data;
+  size_t size;
+  size_t capacity;
+  int owned;  ///< data was allocated by the buffer
+  int failed; ///< An allocation failed; the contents are incomplete
+} otlp_buffer_t;
+
+/**
+ * @brief Encoded resource and instrumentation scope, shared by every request of an exporter.
+ */
+typedef struct otlp_request_prefix {
+  otlp_buffer_t resource; ///< ResourceSpans.resource field
+  otlp_buffer_t scope;    ///< ScopeSpans.scope field
+} otlp_request_prefix_t;
+
+/** Room for the request header written by otlp_encode_request_header(). */
+#define OTLP_REQUEST_HEADER_MAX 64
+
+/** Bytes of a reaction span that do not depend on the execution (see otlp_encode_span_constant()). */
+typedef otlp_buffer_t otlp_span_constant_t;
+
+/**
+ * @brief Initialize a buffer.
+ *
+ * @param storage Initial storage, or NULL to start empty on the heap
+ * @param capacity Size of the initial storage
+ */
+void otlp_buffer_init(otlp_buffer_t* buffer, uint8_t* storage, size_t capacity);
+
+/** @brief Free the heap storage of a buffer, if any, and empty it. */
+void otlp_buffer_free(otlp_buffer_t* buffer);
+
+/** @brief Append raw bytes. */
+void otlp_buffer_append(otlp_buffer_t* buffer, const void* data, size_t size);
+
+/**
+ * @brief Encode the fields of a span that are the same for every execution of a reaction.
+ *
+ * Writes the name, the kind (INTERNAL) and the low-cardinality attributes, which mirror
+ * those set by the opentelemetry-c backend: `xronos.element_type`, then, if `fqn` is
+ * given, `xronos.fqn`, `xronos.name` and `xronos.container_fqn` (if given), and
+ * `xronos.schema.low_cardinality_attributes` listing them.
+ *
+ * @param out The buffer to append to
+ * @param name The span name
+ * @param element_type Value of xronos.element_type
+ * @param fqn Value of xronos.fqn, or NULL
+ * @param element_name Value of xronos.name (used only with fqn)
+ * @param container_fqn Value of xronos.container_fqn, or NULL
+ */
+void otlp_encode_span_constant(otlp_buffer_t* out, const char* name, const char* element_type, const char* fqn,
+                               const char* element_name, const char* container_fqn);
+
+/** @brief Encode the trace and span IDs of a span. */
+void otlp_encode_span_ids(otlp_buffer_t* out, const uint8_t trace_id[16], const uint8_t span_id[8]);
+
+/** @brief Encode the start time of a span (nanoseconds since the epoch). */
+void otlp_encode_start_time(otlp_buffer_t* out, uint64_t time);
+
+/** @brief Encode the end time of a span (nanoseconds since the epoch). */
+void otlp_encode_end_time(otlp_buffer_t* out, uint64_t time);
+
+/** @brief Encode an integer span attribute. */
+void otlp_encode_int_attribute(otlp_buffer_t* out, const char* key, int64_t value);
+
+/** @brief Encode a string span attribute. */
+void otlp_encode_string_attribute(otlp_buffer_t* out, const char* key, const char* value, size_t length);
+
+/**
+ * @brief Append a span, as an element of ScopeSpans.spans, made of its constant and varying parts.
+ *
+ * Protobuf fields may come in any order, so the parts are copied as they are.
+ */
+void otlp_encode_span(otlp_buffer_t* out, const otlp_span_constant_t* constant, const otlp_buffer_t* varying);
+
+/**
+ * @brief Encode the resource (service.name, service.instance.id) and the instrumentation scope.
+ *
+ * @return 0 on success, -1 if out of memory
+ */
+int otlp_request_prefix_init(otlp_request_prefix_t* prefix, const char* service_name, const char* instance_id,
+                             const char* scope_name);
+
+/** @brief Free a request prefix. */
+void otlp_request_prefix_free(otlp_request_prefix_t* prefix);
+
+/**
+ * @brief Encode the start of an ExportTraceServiceRequest holding spans already encoded.
+ *
+ * The request is the bytes written here, followed by the prefix's scope field, followed by
+ * the spans; the caller sends the parts with one gather write, so the spans are not copied.
+ * Layout: request.resource_spans { resource, scope_spans { scope, spans... } }.
+ *
+ * @param out At least OTLP_REQUEST_HEADER_MAX bytes
+ * @param spans_size Total size of the spans appended with otlp_encode_span()
+ * @param header_size Receives the number of bytes written to out; the resource follows them
+ * @param scope_header_size Receives the number of bytes, at out + header_size, to send after the resource
+ * @return The total size of the request
+ */
+size_t otlp_encode_request_header(const otlp_request_prefix_t* prefix, size_t spans_size, uint8_t* out,
+                                  size_t* header_size, size_t* scope_header_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OTLP_ENCODER_H
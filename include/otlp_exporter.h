@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef OTLP_EXPORTER_H
+#define OTLP_EXPORTER_H
+
+#include "otel_backend.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default endpoint of the built-in exporter (the OTLP/HTTP port of a collector). */
+#define OTLP_EXPORTER_ENDPOINT_DEFAULT "http://localhost:4318"
+
+/**
+ * @brief Entry points of the built-in OTLP/HTTP exporter (LF_TRACE_EXPORTER=otlp-http)
+ *
+ * The exporter encodes spans itself (see otlp_encoder.h) and posts them as
+ * `application/x-protobuf` to `<endpoint>/v1/traces` from a background thread. It needs
+ * neither the OpenTelemetry SDK nor gRPC, so it is available in every build. Only
+ * `http://` endpoints are supported.
+ */
+extern const otel_backend_ops_t otlp_exporter_ops;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OTLP_EXPORTER_H
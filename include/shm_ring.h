@@ -0,0 +1,106 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdint.h>
+
+#include "trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Magic number at the start of the shared-memory segment ("LFSR"). */
+#define SHM_RING_MAGIC 0x5253464cu
+
+/** Version of the shared-memory layout. */
+#define SHM_RING_VERSION 1
+
+/** Capacity of the string pool holding the object descriptions. */
+#define SHM_RING_STRING_POOL_SIZE (64 * 1024)
+
+/**
+ * @brief Header at the start of the shared-memory segment.
+ *
+ * The segment is laid out as follows, with every part aligned to 64 bytes:
+ * - this header;
+ * - `max_descriptions` shm_ring_description_t entries, of which `num_descriptions` are valid;
+ * - the string pool (SHM_RING_STRING_POOL_SIZE bytes) holding their null-terminated descriptions;
+ * - `num_rings` rings, one per worker buffer starting with the one for threads not managed by LF.
+ *   Each ring is a shm_ring_t followed by `ring_capacity` trace_record_nodeps_t slots.
+ *
+ * Readers attach read-only and copy records [head - ring_capacity, head) of each ring,
+ * re-reading `head` afterwards to discard slots that were overwritten meanwhile.
+ */
+typedef struct shm_ring_header {
+  uint32_t magic;               ///< SHM_RING_MAGIC
+  uint32_t version;             ///< SHM_RING_VERSION
+  uint32_t record_size;         ///< sizeof(trace_record_nodeps_t) of the writer
+  uint32_t num_rings;           ///< Number of rings (worker buffers + 1)
+  uint64_t ring_capacity;       ///< Slots per ring (a power of two)
+  uint64_t ring_stride;         ///< Bytes from one ring to the next
+  uint64_t descriptions_offset; ///< Offset of the description table
+  uint64_t strings_offset;      ///< Offset of the string pool
+  uint64_t rings_offset;        ///< Offset of the first ring
+  int64_t start_time;           ///< Start time set by lf_tracing_set_start_time()
+  uint32_t max_descriptions;    ///< Capacity of the description table
+  volatile uint32_t num_descriptions; ///< Number of valid descriptions (published after the entry)
+} shm_ring_header_t;
+
+/** @brief Object description as stored in the segment. */
+typedef struct shm_ring_description {
+  uint64_t pointer;       ///< Pointer-sized ID of the object
+  uint64_t trigger;       ///< Trigger pointer or secondary ID
+  int32_t type;           ///< _lf_trace_object_t
+  uint32_t string_offset; ///< Offset of the description in the string pool
+} shm_ring_description_t;
+
+/** @brief Per-ring control block. */
+typedef struct shm_ring {
+  volatile uint64_t head; ///< Number of records ever written to this ring (published after the record)
+  char padding[64 - sizeof(uint64_t)];
+} shm_ring_t;
+
+/**
+ * @brief Create the shared-memory segment and map it.
+ *
+ * An existing segment of the same name is replaced. The segment is left in place at
+ * shutdown so that it can be inspected after the program exits.
+ *
+ * @param name POSIX shared-memory object name (e.g. "/lf-trace")
+ * @param num_buffers Number of LF-managed threads (one more ring is added for other threads)
+ * @param ring_capacity Records per ring, rounded up to a power of two
+ * @return 0 on success, -1 on failure
+ */
+int shm_ring_open(const char* name, int num_buffers, uint64_t ring_capacity);
+
+/**
+ * @brief Publish an object description to readers.
+ *
+ * Must be serialized with other calls to this function.
+ */
+void shm_ring_register(const object_description_t* description);
+
+/** @brief Record the start time in the segment header. */
+void shm_ring_set_start_time(int64_t start_time);
+
+/**
+ * @brief Append a record to the ring of the given buffer, overwriting the oldest record when full.
+ *
+ * Each ring has a single writer: buffer -1 must be serialized by the caller.
+ *
+ * @param buffer The buffer index (the LF thread ID, or -1)
+ * @param tr The record
+ */
+void shm_ring_record(int buffer, const trace_record_nodeps_t* tr);
+
+/** @brief Unmap the segment. */
+void shm_ring_close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SHM_RING_H
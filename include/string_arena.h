@@ -0,0 +1,56 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef STRING_ARENA_H
+#define STRING_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Bytes per arena chunk; longer strings get a chunk of their own. */
+#define STRING_ARENA_CHUNK_SIZE (16 * 1024)
+
+/**
+ * @brief Header stored immediately before the characters of every interned string.
+ *
+ * Interned strings are null-terminated and 8-byte aligned, so they can be used as plain C
+ * strings while their length and hash are read from the header in constant time.
+ */
+typedef struct string_arena_header {
+  uint32_t length; ///< Number of characters, excluding the terminating null
+  uint32_t hash;   ///< FNV-1a hash of the characters
+} string_arena_header_t;
+
+/**
+ * @brief Intern a string in the plugin-owned, append-only arena.
+ *
+ * Equal strings are interned once and yield the same pointer, which stays valid until
+ * string_arena_free(). Callers must serialize calls (the plugin holds the trace mutex).
+ *
+ * @param text The string to copy
+ * @return The interned string, or NULL if text is NULL or out of memory
+ */
+const char* string_arena_intern(const char* text);
+
+/** @brief Length of an interned string, without scanning it. */
+static inline size_t string_arena_length(const char* interned) {
+  return ((const string_arena_header_t*)interned - 1)->length;
+}
+
+/** @brief Hash of an interned string, as computed when it was interned. */
+static inline uint32_t string_arena_hash(const char* interned) {
+  return ((const string_arena_header_t*)interned - 1)->hash;
+}
+
+/** @brief Free every interned string. */
+void string_arena_free(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STRING_ARENA_H
@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef TRACE_ALLOC_H
+#define TRACE_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Smallest allocation backed by huge pages; smaller ones would waste most of a huge page. */
+#define TRACE_ALLOC_HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+/** @brief Huge-page policy of trace_alloc() (LF_TRACE_HUGE_PAGES). */
+typedef enum trace_alloc_huge_pages {
+  TRACE_ALLOC_HUGE_PAGES_OFF = 0, ///< Regular pages only ("0")
+  TRACE_ALLOC_HUGE_PAGES_THP,     ///< Ask for transparent huge pages with madvise ("thp")
+  TRACE_ALLOC_HUGE_PAGES_AUTO,    ///< Reserved huge pages (MAP_HUGETLB) if available, else as THP (default)
+} trace_alloc_huge_pages_t;
+
+/** @brief What the allocations so far got, in bytes, for the `memory` control command. Never decremented. */
+typedef struct trace_alloc_stats {
+  uint64_t hugetlb_bytes;    ///< Backed by reserved huge pages (MAP_HUGETLB)
+  uint64_t thp_bytes;        ///< Advised to use transparent huge pages (MADV_HUGEPAGE)
+  uint64_t small_page_bytes; ///< Regular pages
+  uint64_t node_bytes;       ///< Bound to the NUMA node of the allocating thread
+  uint64_t allocations;      ///< Number of allocations
+} trace_alloc_stats_t;
+
+/**
+ * @brief Set the huge-page policy from the value of LF_TRACE_HUGE_PAGES.
+ *
+ * @param value "0", "thp", "1" or NULL (the default, TRACE_ALLOC_HUGE_PAGES_AUTO)
+ * @return 0 on success, -1 if the value is not recognized (the default is kept)
+ */
+int trace_alloc_configure(const char* value);
+
+/**
+ * @brief Allocate zeroed, page-aligned memory for a large trace buffer.
+ *
+ * Buffers of at least TRACE_ALLOC_HUGE_PAGE_SIZE are backed by huge pages as the policy
+ * allows, falling back to regular pages. The memory prefers the NUMA node the calling
+ * thread runs on, so the owner of a buffer should allocate it; when that node is full,
+ * the kernel falls back to other nodes rather than failing.
+ *
+ * @param size Bytes to allocate
+ * @param mapped Receives the size of the mapping, to be passed to trace_alloc_free()
+ * @return The memory, or NULL if out of memory
+ */
+void* trace_alloc(size_t size, size_t* mapped);
+
+/** @brief Free memory returned by trace_alloc(). */
+void trace_alloc_free(void* memory, size_t mapped);
+
+/**
+ * @brief Ask for transparent huge pages on an existing mapping, e.g. a shared-memory segment.
+ *
+ * The bytes are counted as THP if the kernel accepts the hint, else as regular pages.
+ */
+void trace_alloc_advise(void* memory, size_t size);
+
+/** @brief Copy the allocation counters. */
+void trace_alloc_get_stats(trace_alloc_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_ALLOC_H
@@ -0,0 +1,145 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef TRACE_CONFIG_H
+#define TRACE_CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "trace_impl.h"
+#include "otel_backend.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Event mask with only reaction_starts and reaction_ends (the default unless LF_TRACE_VERBOSE=1). */
+#define TRACE_CONFIG_REACTION_EVENTS ((UINT64_C(1) << reaction_starts) | (UINT64_C(1) << reaction_ends))
+
+/** Event mask with every event type. */
+#define TRACE_CONFIG_ALL_EVENTS (~UINT64_C(0))
+
+/** Size of the error message buffer passed to trace_config_apply_command(). */
+#define TRACE_CONFIG_ERROR_SIZE 128
+
+/** Flags returned by trace_config_apply_command() for changes that need more than a copy. */
+#define TRACE_CONFIG_CHANGED_FILTERS 0x1 ///< The keep bits must be recomputed
+#define TRACE_CONFIG_CHANGED_BATCH 0x2   ///< The exporter must be recreated
+
+/**
+ * @brief Tracing settings that can be changed while the program runs.
+ *
+ * A configuration is immutable once published, except for the keep bits of objects
+ * registered later, which only ever go from unset to set. Tracepoints load the current
+ * configuration with a single atomic load; updates publish a modified copy. Replaced
+ * configurations stay valid until shutdown, so a tracepoint never has to synchronize
+ * with an update.
+ *
+ * Scope: the logical time window and the reactor filters apply to every sink, while the
+ * event mask and the sampling period only affect which spans are exported.
+ */
+typedef struct trace_config {
+  uint64_t event_mask;          ///< Event types exported as spans (bit i is event type i)
+  uint32_t sample_period;       ///< Export one in this many reaction executions of each worker (1 = all)
+  int windowed;                 ///< Whether events are limited to a logical time window
+  int64_t window_start;         ///< Start of the window, relative to the start time
+  int64_t window_end;           ///< End of the window (exclusive), INT64_MAX if unbounded
+  int64_t window_period;        ///< The window repeats with this period (0 = once)
+  char* include;                ///< Comma-separated reactor FQN globs to trace (NULL = all)
+  char* exclude;                ///< Comma-separated reactor FQN globs not to trace (NULL = none)
+  uint64_t keep[TRACE_OBJECT_TABLE_SIZE / 64]; ///< Keep bit per object description index
+  otel_batch_settings_t batch;  ///< Exporter batch settings
+  otel_backend_t* backend;      ///< Exporter the spans are sent to (NULL if export is disabled)
+  struct trace_config* retired; ///< Configuration this one replaced, freed at shutdown
+} trace_config_t;
+
+/**
+ * @brief Create the initial configuration from the environment.
+ *
+ * Reads LF_TRACE_VERBOSE, LF_TRACE_EVENTS, LF_TRACE_SAMPLE, LF_TRACE_INCLUDE,
+ * LF_TRACE_EXCLUDE and LF_TRACE_WINDOW. Invalid values are reported and ignored.
+ *
+ * @return A new configuration, or NULL if out of memory
+ */
+trace_config_t* trace_config_from_env(void);
+
+/** @brief Return a private copy of the configuration with no retired chain. */
+trace_config_t* trace_config_copy(const trace_config_t* config);
+
+/** @brief Free a configuration and every configuration it retired (not the backends). */
+void trace_config_free(trace_config_t* config);
+
+/**
+ * @brief Apply a control command to an unpublished configuration.
+ *
+ * Commands (one per line on the control socket):
+ * - `events all|reactions|<name>,...`: the event types exported as spans, by name as in
+ *   trace_event_names (case-insensitive, `_` matches a space) or as a 0x-prefixed mask
+ * - `verbose 0|1`: shorthand for `events reactions` and `events all`
+ * - `sample <N>`: export one in N reaction executions
+ * - `include <globs>` / `exclude <globs>`: comma-separated reactor FQN globs, `-` clears
+ * - `window <from>-[<to>] [every <period>]`: logical time window relative to the start
+ *   time, e.g. `30s-35s` or `0s-1s every 60s`; `-` clears
+ * - `batch [delay=<ms>] [queue=<n>] [size=<n>]`: batch span processor settings, applied by
+ *   creating a new exporter (only for exporters with set_batch_settings)
+ *
+ * @param config The configuration to modify
+ * @param command The command, without the trailing newline
+ * @param error Receives a message if the command is invalid
+ * @return A combination of TRACE_CONFIG_CHANGED_* flags, or -1 on error
+ */
+int trace_config_apply_command(trace_config_t* config, const char* command, char error[TRACE_CONFIG_ERROR_SIZE]);
+
+/**
+ * @brief Whether a reactor passes the include and exclude filters of a configuration.
+ *
+ * @param config The configuration
+ * @param fqn The fully qualified name of the reactor
+ */
+int trace_config_reactor_matches(const trace_config_t* config, const char* fqn);
+
+/**
+ * @brief Set the keep bit of an object description according to the filters.
+ *
+ * Only reactor descriptions are subject to the filters; every other object is kept.
+ */
+void trace_config_update_keep(trace_config_t* config, size_t index, const object_description_t* description);
+
+/** @brief Whether events of the object description at the given index are kept. */
+static inline int trace_config_keeps(const trace_config_t* config, size_t index) {
+  return index >= TRACE_OBJECT_TABLE_SIZE ||
+         ((__atomic_load_n(&config->keep[index / 64], __ATOMIC_RELAXED) >> (index % 64)) & 1);
+}
+
+/**
+ * @brief Whether a tag is inside the logical time window of a configuration.
+ *
+ * @param config A configuration with `windowed` set
+ * @param elapsed Logical time of the tag relative to the start time
+ */
+static inline int trace_config_in_window(const trace_config_t* config, int64_t elapsed) {
+  if (elapsed < config->window_start) {
+    return 0;
+  }
+  if (config->window_period > 0) {
+    elapsed = config->window_start + (elapsed - config->window_start) % config->window_period;
+  }
+  return elapsed < config->window_end;
+}
+
+/** @brief Write a one-line description of the configuration into the buffer. */
+void trace_config_format(const trace_config_t* config, char* buffer, size_t size);
+
+/**
+ * @brief Parse a duration such as "1.5s", "250ms", "10us" or "100ns" (the default unit).
+ *
+ * @return 0 on success, -1 if the text is not a non-negative duration
+ */
+int trace_config_parse_duration(const char* text, int64_t* nanoseconds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_CONFIG_H
@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef TRACE_CONTROL_H
+#define TRACE_CONTROL_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size of the reply buffer passed to a trace_control_handler_t. */
+#define TRACE_CONTROL_REPLY_SIZE 512
+
+/**
+ * @brief Handle one command received on the control socket.
+ *
+ * @param command The command line, without the trailing newline
+ * @param reply Receives the reply line, without the trailing newline
+ */
+typedef void (*trace_control_handler_t)(const char* command, char reply[TRACE_CONTROL_REPLY_SIZE]);
+
+/**
+ * @brief Start the control thread listening on a Unix domain socket.
+ *
+ * Clients connect, write newline-terminated commands and read one reply line per
+ * command, for example `echo "verbose 1" | socat - UNIX-CONNECT:/tmp/lf-trace.sock`.
+ * Commands are handled one at a time on the control thread.
+ *
+ * @param path File system path of the socket; an existing socket there is replaced
+ * @param handler Called for every command
+ * @return 0 on success, -1 on failure
+ */
+int trace_control_start(const char* path, trace_control_handler_t handler);
+
+/** @brief Stop the control thread and remove the socket. Does nothing if it was not started. */
+void trace_control_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_CONTROL_H
@@ -1,4 +1,11 @@
+#ifndef TRACE_IMPL_H
+#define TRACE_IMPL_H
+
+#include <stdio.h>
+#include <stddef.h>
+
 #include "trace.h"
+#include "file_writer.h"
 
 // FIXME: Target property should specify the capacity of the trace buffer.
 #define TRACE_BUFFER_CAPACITY 2048
@@ -11,6 +18,19 @@
 
 // TYPE DEFINITIONS **********************************************************
 
+/**
+ * @brief Trace buffer of one worker, on a cache line of its own.
+ *
+ * Workers append to their buffers at every event; padding keeps one worker's size
+ * updates from invalidating the line that holds another's.
+ */
+typedef struct trace_buffer_t {
+  /** TRACE_BUFFER_CAPACITY records, allocated by the first thread that writes to the buffer. */
+  trace_record_nodeps_t* records;
+  size_t size;
+  char padding[64 - sizeof(trace_record_nodeps_t*) - sizeof(size_t)];
+} trace_buffer_t;
+
 /**
  * @brief This struct holds all the state associated with tracing in a single environment.
  * Each environment which has tracing enabled will have such a struct on its environment struct.
@@ -21,9 +41,9 @@ typedef struct trace_t {
    * Array of buffers into which traces are written.
    * When a buffer becomes full, the contents is flushed to the file,
    * which will create a significant pause in the calling thread.
+   * The buffer at index -1 is shared by threads not managed by LF.
    */
-  trace_record_nodeps_t** _lf_trace_buffer;
-  size_t* _lf_trace_buffer_size;
+  trace_buffer_t* _lf_trace_buffers;
 
   /** The number of trace buffers allocated when tracing starts. */
   size_t _lf_number_of_trace_buffers;
@@ -32,7 +52,7 @@ typedef struct trace_t {
   int _lf_trace_stop;
 
   /** The file into which traces are written. */
-  FILE* _lf_trace_file;
+  file_writer_t* _lf_trace_file;
 
   /** The file name where the traces are written*/
   char filename[TRACE_MAX_FILENAME_LENGTH];
@@ -47,3 +67,5 @@ typedef struct trace_t {
   // /** Pointer back to the environment which we are tracing within*/
   // environment_t* env;
 } trace_t;
+
+#endif // TRACE_IMPL_H
@@ -0,0 +1,100 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file trace_probes.h
+ * @brief USDT (SystemTap SDT) probes of the trace plugin
+ *
+ * The plugin entry points carry static probes of provider `lf_trace` that bpftrace, perf
+ * and bcc attach to without the plugin's help:
+ *
+ * - `lf_trace:tracepoint(event_type, pointer, reaction, logical_time, microstep, physical_time, worker)`
+ *   for every event passed to lf_tracing_tracepoint(), whether or not any sink is enabled;
+ *   `reaction` is the record's `dst_id`, the reaction number for reaction events.
+ * - `lf_trace:register(pointer, trigger, type, description)` for every object passed to
+ *   lf_tracing_register_trace_event(), so that a tool can name the pointers it sees.
+ *
+ * A probe is a single NOP in the code and a note in the `.note.stapsdt` section of the
+ * binary. When nothing is attached, it costs nothing but keeping its arguments in
+ * registers or memory.
+ *
+ * `<sys/sdt.h>` (systemtap-sdt-dev) is used if it is installed. Otherwise, on x86-64 and
+ * AArch64 ELF targets, the notes are emitted by the minimal equivalent below. Elsewhere,
+ * or without LF_TRACE_USDT, the probes compile to nothing.
+ */
+
+#ifndef TRACE_PROBES_H
+#define TRACE_PROBES_H
+
+#include <stdint.h>
+
+#if defined(LF_TRACE_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define LF_TRACE_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(lf_trace, name, a1, a2, a3, a4)
+#define LF_TRACE_PROBE7(name, a1, a2, a3, a4, a5, a6, a7) DTRACE_PROBE7(lf_trace, name, a1, a2, a3, a4, a5, a6, a7)
+#elif defined(__ELF__) && (defined(__x86_64__) || defined(__aarch64__))
+#define LF_TRACE_PROBES_BUILTIN 1
+#endif
+#endif
+
+#ifdef LF_TRACE_PROBES_BUILTIN
+
+// The note layout is that of <sys/sdt.h> version 3: the address of the NOP, the address of
+// `_.stapsdt.base` (for prelink adjustments), the semaphore address (none), then the provider,
+// the probe name and the argument descriptions. Every argument is passed as a signed 64-bit
+// value, described as `-8@<operand>`.
+#define LF_TRACE_PROBE_NOTE(name, args)                                                                                \
+  "990: nop\n"                                                                                                         \
+  ".pushsection .note.stapsdt,\"\",\"note\"\n"                                                                         \
+  ".balign 4\n"                                                                                                        \
+  ".4byte 992f-991f, 994f-993f, 3\n"                                                                                   \
+  "991: .asciz \"stapsdt\"\n"                                                                                          \
+  "992: .balign 4\n"                                                                                                   \
+  "993: .8byte 990b\n"                                                                                                 \
+  ".8byte _.stapsdt.base\n"                                                                                            \
+  ".8byte 0\n"                                                                                                         \
+  ".asciz \"lf_trace\"\n"                                                                                              \
+  ".asciz \"" #name "\"\n"                                                                                             \
+  ".asciz \"" args "\"\n"                                                                                              \
+  "994: .balign 4\n"                                                                                                   \
+  ".popsection\n"                                                                                                      \
+  ".ifndef _.stapsdt.base\n"                                                                                           \
+  ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"                                              \
+  ".weak _.stapsdt.base\n"                                                                                             \
+  ".hidden _.stapsdt.base\n"                                                                                           \
+  "_.stapsdt.base: .space 1\n"                                                                                         \
+  ".size _.stapsdt.base, 1\n"                                                                                          \
+  ".popsection\n"                                                                                                      \
+  ".endif\n"
+
+#define LF_TRACE_PROBE_ARG(x) "nor"((int64_t)(x))
+
+#define LF_TRACE_PROBE4(name, a1, a2, a3, a4)                                                                          \
+  __asm__ __volatile__(LF_TRACE_PROBE_NOTE(name, "-8@%0 -8@%1 -8@%2 -8@%3")::LF_TRACE_PROBE_ARG(a1),                  \
+                       LF_TRACE_PROBE_ARG(a2), LF_TRACE_PROBE_ARG(a3), LF_TRACE_PROBE_ARG(a4))
+#define LF_TRACE_PROBE7(name, a1, a2, a3, a4, a5, a6, a7)                                                              \
+  __asm__ __volatile__(LF_TRACE_PROBE_NOTE(name, "-8@%0 -8@%1 -8@%2 -8@%3 -8@%4 -8@%5 -8@%6")::LF_TRACE_PROBE_ARG(a1), \
+                       LF_TRACE_PROBE_ARG(a2), LF_TRACE_PROBE_ARG(a3), LF_TRACE_PROBE_ARG(a4), LF_TRACE_PROBE_ARG(a5), \
+                       LF_TRACE_PROBE_ARG(a6), LF_TRACE_PROBE_ARG(a7))
+
+#endif // LF_TRACE_PROBES_BUILTIN
+
+#ifndef LF_TRACE_PROBE4
+// The arguments are not evaluated, but still count as used, as they do with probes.
+#define LF_TRACE_PROBE4(name, a1, a2, a3, a4) ((void)sizeof(a1), (void)sizeof(a2), (void)sizeof(a3), (void)sizeof(a4))
+#define LF_TRACE_PROBE7(name, a1, a2, a3, a4, a5, a6, a7)                                                              \
+  (LF_TRACE_PROBE4(name, a1, a2, a3, a4), (void)sizeof(a5), (void)sizeof(a6), (void)sizeof(a7))
+#endif
+
+/** @brief Probe `lf_trace:tracepoint` for a record passed to lf_tracing_tracepoint(). */
+#define LF_TRACE_PROBE_TRACEPOINT(worker, tr)                                                                          \
+  LF_TRACE_PROBE7(tracepoint, (tr)->event_type, (uintptr_t)(tr)->pointer, (tr)->dst_id, (tr)->logical_time,            \
+                  (tr)->microstep, (tr)->physical_time, worker)
+
+/** @brief Probe `lf_trace:register` for an object passed to lf_tracing_register_trace_event(). */
+#define LF_TRACE_PROBE_REGISTER(description)                                                                           \
+  LF_TRACE_PROBE4(register, (uintptr_t)(description).pointer, (uintptr_t)(description).trigger, (description).type,    \
+                  (uintptr_t)(description).description)
+
+#endif // TRACE_PROBES_H
@@ -50,6 +50,42 @@ message(STATUS "  lib:     ${LF_TRACE_LIB_DIR}")
 
 target_include_directories(${LF_MAIN_TARGET} PRIVATE "${LF_TRACE_INC_DIR}")
 
+# Merged-archive install (built with -DLF_TRACE_MERGED_ARCHIVE=ON): liblf-trace-impl.a already
+# contains every dependency, LTO-optimized, and exports only the plugin API.
+set(LF_TRACE_MERGED_LINK_FILE "${LF_TRACE_LIB_DIR}/cmake/lf-trace-xronos/lf-trace-xronosMergedLink.cmake")
+if(EXISTS "${LF_TRACE_MERGED_LINK_FILE}")
+  include("${LF_TRACE_MERGED_LINK_FILE}")
+  find_package(Threads REQUIRED)
+  target_link_libraries(${LF_MAIN_TARGET} PRIVATE
+    "${LF_TRACE_LIB_DIR}/liblf-trace-impl.a"
+    Threads::Threads
+    ${LF_TRACE_XRONOS_MERGED_LINK_LIBRARIES}
+  )
+  message(STATUS "lf-trace-xronos plugin configured for target: ${LF_MAIN_TARGET} (merged archive)")
+  return()
+endif()
+
+# Shared-exporter install (built with -DLF_TRACE_SHARED_EXPORTER=ON): the OpenTelemetry exporter
+# and all of its dependencies are in a shared library that the plugin opens at runtime, so only
+# the small static plugin is linked here.
+# The same applies to an install built with -DINCLUDE_OTEL=OFF, which has no dependency archives.
+set(LF_TRACE_OTEL_MODULE "${LF_TRACE_LIB_DIR}/${CMAKE_SHARED_MODULE_PREFIX}lf-trace-otel${CMAKE_SHARED_MODULE_SUFFIX}")
+file(GLOB LF_TRACE_DEPENDENCY_ARCHIVES "${LF_TRACE_LIB_DIR}/*.a")
+list(REMOVE_ITEM LF_TRACE_DEPENDENCY_ARCHIVES "${LF_TRACE_LIB_DIR}/liblf-trace-impl.a")
+if(EXISTS "${LF_TRACE_OTEL_MODULE}" OR NOT LF_TRACE_DEPENDENCY_ARCHIVES)
+  target_link_libraries(${LF_MAIN_TARGET} PRIVATE "${LF_TRACE_LIB_DIR}/liblf-trace-impl.a" ${CMAKE_DL_LIBS})
+  if(UNIX)
+    find_package(Threads REQUIRED)
+    # The outlier detector reports standard deviations (sqrt).
+    target_link_libraries(${LF_MAIN_TARGET} PRIVATE Threads::Threads m)
+  endif()
+  if(UNIX AND NOT APPLE)
+    target_link_libraries(${LF_MAIN_TARGET} PRIVATE rt)
+  endif()
+  message(STATUS "lf-trace-xronos plugin configured for target: ${LF_MAIN_TARGET} (standalone plugin archive)")
+  return()
+endif()
+
 # Collect all archives from the install directory and link them.
 # This avoids having to list every transitive dependency here.
 file(GLOB LF_TRACE_ARCHIVES "${LF_TRACE_LIB_DIR}/*.a")
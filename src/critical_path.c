@@ -0,0 +1,387 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file critical_path.c
+ * @brief Online critical-path analysis of the reaction executions of each tag
+ *
+ * Workers append every reaction execution to a ring of their own, which costs them a
+ * copy and a release store. An analysis thread drains the rings every
+ * CRITICAL_PATH_POLL_MS, groups the executions by tag, and analyzes a tag once it is
+ * complete (see critical_path_t for how the path is inferred). Only the results reach the
+ * exporter, so the critical paths are available even when no reaction spans are exported.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "critical_path.h"
+
+#define RING_MASK ((uint64_t)CRITICAL_PATH_RING_RECORDS - 1)
+
+// PRIVATE DATA STRUCTURES ***************************************************
+
+/** @brief Ring of one worker. The head, written per execution, is on a cache line of its own. */
+typedef struct path_ring {
+  uint64_t head __attribute__((aligned(64))); ///< Executions ever written (published after the execution)
+  uint64_t tail __attribute__((aligned(64))); ///< Executions consumed by the analysis thread
+  critical_path_execution_t* slots;           ///< CRITICAL_PATH_RING_RECORDS entries, or NULL until the first one
+  int failed;                                 ///< The slots could not be allocated; executions are dropped
+} path_ring_t;
+
+static path_ring_t* rings; // num_rings entries; rings[0] is buffer -1
+static int num_rings;
+static int64_t report_interval;
+static critical_path_handler_t path_handler;
+static uint64_t dropped = 0;
+
+static pthread_t analysis_thread;
+static int analysis_running = 0;
+static int stopping = 0;
+static pthread_mutex_t wake_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond;
+
+// State of the analysis thread.
+static critical_path_execution_t* pending; // Executions of tags not yet analyzed
+static size_t pending_count;
+static size_t pending_capacity;
+static const critical_path_execution_t** by_end; // Scratch: the executions of a tag, by end time
+static char* on_path;                            // Scratch: whether by_end[i] is on the path
+static size_t scratch_capacity;
+static int has_bound;       // Whether an execution was seen; tags before bound_* are complete
+static int64_t bound_time;
+static int64_t bound_microstep;
+static critical_path_t worst; // Path with the largest latency of the current interval
+static int has_worst;
+static int64_t worst_interval;
+
+// PRIVATE HELPERS ***********************************************************
+
+static inline int tag_before(int64_t time, int64_t microstep, int64_t other_time, int64_t other_microstep) {
+  return time < other_time || (time == other_time && microstep < other_microstep);
+}
+
+static int compare_tag_and_start(const void* a, const void* b) {
+  const critical_path_execution_t* x = (const critical_path_execution_t*)a;
+  const critical_path_execution_t* y = (const critical_path_execution_t*)b;
+  if (x->logical_time != y->logical_time) {
+    return x->logical_time < y->logical_time ? -1 : 1;
+  }
+  if (x->microstep != y->microstep) {
+    return x->microstep < y->microstep ? -1 : 1;
+  }
+  return (x->start_time > y->start_time) - (x->start_time < y->start_time);
+}
+
+static int compare_end(const void* a, const void* b) {
+  const critical_path_execution_t* x = *(const critical_path_execution_t* const*)a;
+  const critical_path_execution_t* y = *(const critical_path_execution_t* const*)b;
+  if (x->end_time != y->end_time) {
+    return x->end_time < y->end_time ? -1 : 1;
+  }
+  return (x->start_time > y->start_time) - (x->start_time < y->start_time);
+}
+
+/** @brief Hand a path to the handler, or keep it if it is the worst of its interval so far. */
+static void report(const critical_path_t* path) {
+  if (report_interval <= 0) {
+    path_handler(path);
+    return;
+  }
+  int64_t interval = path->end_time / report_interval;
+  if (has_worst && interval != worst_interval) {
+    path_handler(&worst);
+    has_worst = 0;
+  }
+  if (!has_worst || path->latency > worst.latency) {
+    worst = *path;
+    worst_interval = interval;
+    has_worst = 1;
+  }
+}
+
+/** @brief Find and report the critical path of the `count` executions of one tag. */
+static void analyze_tag(const critical_path_execution_t* executions, size_t count) {
+  if (count > scratch_capacity) {
+    const critical_path_execution_t** grown_by_end =
+        (const critical_path_execution_t**)realloc(by_end, count * sizeof(*by_end));
+    if (grown_by_end) {
+      by_end = grown_by_end;
+    }
+    char* grown_on_path = (char*)realloc(on_path, count);
+    if (grown_on_path) {
+      on_path = grown_on_path;
+    }
+    if (!grown_by_end || !grown_on_path) {
+      return;
+    }
+    scratch_capacity = count;
+  }
+  for (size_t i = 0; i < count; i++) {
+    by_end[i] = &executions[i];
+    on_path[i] = 0;
+  }
+  qsort(by_end, count, sizeof(*by_end), compare_end);
+
+  critical_path_t path;
+  path.logical_time = executions[0].logical_time;
+  path.microstep = executions[0].microstep;
+  path.end_time = by_end[count - 1]->end_time;
+  path.latency = path.end_time - path.logical_time;
+  path.busy_time = 0;
+  path.slack = -1;
+  path.executions = (int)count;
+  path.length = 0;
+  path.num_steps = 0;
+
+  // Walk back from the last execution to the one that ended last before it started. Each
+  // predecessor comes earlier in end order, so the walk ends.
+  critical_path_execution_t reversed[CRITICAL_PATH_MAX_STEPS];
+  for (size_t position = count - 1;;) {
+    const critical_path_execution_t* step = by_end[position];
+    on_path[position] = 1;
+    if (path.num_steps < CRITICAL_PATH_MAX_STEPS) {
+      reversed[path.num_steps++] = *step;
+    }
+    path.length++;
+    path.busy_time += step->end_time - step->start_time;
+    size_t low = 0;
+    size_t high = position; // First position in [low, position) that ends after the step starts
+    while (low < high) {
+      size_t middle = low + (high - low) / 2;
+      if (by_end[middle]->end_time <= step->start_time) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    if (low == 0) {
+      break;
+    }
+    position = low - 1;
+  }
+  for (int i = 0; i < path.num_steps; i++) {
+    path.steps[i] = reversed[path.num_steps - 1 - i];
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (!on_path[i] && (path.slack < 0 || path.end_time - by_end[i]->end_time < path.slack)) {
+      path.slack = path.end_time - by_end[i]->end_time;
+    }
+  }
+  report(&path);
+}
+
+/**
+ * @brief Collect the executions recorded since the last pass and analyze the complete tags.
+ *
+ * @param final Analyze every tag, as no more executions will be recorded
+ */
+static void analyze(int final) {
+  // The latest tag any worker has recorded first. LF advances tags in order, so every execution of
+  // an earlier tag ended before that one started, and the pass below is bound to collect it.
+  for (int i = 0; i < num_rings; i++) {
+    path_ring_t* ring = &rings[i];
+    const critical_path_execution_t* slots = __atomic_load_n(&ring->slots, __ATOMIC_ACQUIRE);
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (slots && head > ring->tail) {
+      const critical_path_execution_t* latest = &slots[(head - 1) & RING_MASK];
+      if (!has_bound || tag_before(bound_time, bound_microstep, latest->logical_time, latest->microstep)) {
+        bound_time = latest->logical_time;
+        bound_microstep = latest->microstep;
+        has_bound = 1;
+      }
+    }
+  }
+  for (int i = 0; i < num_rings; i++) {
+    path_ring_t* ring = &rings[i];
+    const critical_path_execution_t* slots = __atomic_load_n(&ring->slots, __ATOMIC_ACQUIRE);
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (!slots || head == ring->tail) {
+      continue;
+    }
+    size_t needed = pending_count + (size_t)(head - ring->tail);
+    if (needed > pending_capacity) {
+      size_t capacity = pending_capacity ? pending_capacity : CRITICAL_PATH_RING_RECORDS;
+      while (capacity < needed) {
+        capacity *= 2;
+      }
+      critical_path_execution_t* grown =
+          (critical_path_execution_t*)realloc(pending, capacity * sizeof(critical_path_execution_t));
+      if (!grown) {
+        // Leave the executions in the ring; the worker drops new ones until memory is available.
+        continue;
+      }
+      pending = grown;
+      pending_capacity = capacity;
+    }
+    for (uint64_t sequence = ring->tail; sequence < head; sequence++) {
+      pending[pending_count++] = slots[sequence & RING_MASK];
+    }
+    __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+  }
+  if (pending_count == 0) {
+    return;
+  }
+
+  qsort(pending, pending_count, sizeof(critical_path_execution_t), compare_tag_and_start);
+  size_t first = 0;
+  while (first < pending_count) {
+    const critical_path_execution_t* tag = &pending[first];
+    if (!final && !tag_before(tag->logical_time, tag->microstep, bound_time, bound_microstep)) {
+      break;
+    }
+    size_t last = first + 1;
+    while (last < pending_count && pending[last].logical_time == tag->logical_time &&
+           pending[last].microstep == tag->microstep) {
+      last++;
+    }
+    analyze_tag(tag, last - first);
+    first = last;
+  }
+  memmove(pending, pending + first, (pending_count - first) * sizeof(critical_path_execution_t));
+  pending_count -= first;
+}
+
+static void* analysis_main(void* arg) {
+  (void)arg;
+  for (;;) {
+    pthread_mutex_lock(&wake_mutex);
+    if (!stopping) {
+      struct timespec deadline;
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      deadline.tv_nsec += CRITICAL_PATH_POLL_MS * 1000000L;
+      if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&wake_cond, &wake_mutex, &deadline);
+    }
+    int stop = stopping;
+    pthread_mutex_unlock(&wake_mutex);
+    analyze(stop);
+    if (stop) {
+      break;
+    }
+  }
+  if (has_worst) {
+    path_handler(&worst);
+    has_worst = 0;
+  }
+  return NULL;
+}
+
+/** @brief Allocate the slots of a ring, on the thread that writes to it. */
+static critical_path_execution_t* allocate_slots(path_ring_t* ring) {
+  if (ring->failed) {
+    return NULL;
+  }
+  critical_path_execution_t* slots =
+      (critical_path_execution_t*)malloc(CRITICAL_PATH_RING_RECORDS * sizeof(critical_path_execution_t));
+  if (!slots) {
+    ring->failed = 1;
+    fprintf(stderr, "WARNING: Critical path: out of memory for the executions of a worker.\n");
+    return NULL;
+  }
+  // Published for the analysis thread.
+  __atomic_store_n(&ring->slots, slots, __ATOMIC_RELEASE);
+  return slots;
+}
+
+// IMPLEMENTATION OF CRITICAL PATH API ***************************************
+
+int critical_path_open(int num_buffers, int64_t interval, critical_path_handler_t handler) {
+  if (rings || num_buffers < 0 || interval < 0 || !handler) {
+    return -1;
+  }
+  num_rings = num_buffers + 1;
+  report_interval = interval;
+  path_handler = handler;
+  void* memory = NULL;
+  if (posix_memalign(&memory, 64, (size_t)num_rings * sizeof(path_ring_t)) != 0) {
+    fprintf(stderr, "WARNING: Critical path: out of memory.\n");
+    return -1;
+  }
+  rings = (path_ring_t*)memory;
+  memset(rings, 0, (size_t)num_rings * sizeof(path_ring_t));
+
+  pthread_condattr_t attributes;
+  pthread_condattr_init(&attributes);
+  pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+  pthread_cond_init(&wake_cond, &attributes);
+  pthread_condattr_destroy(&attributes);
+  stopping = 0;
+  if (pthread_create(&analysis_thread, NULL, analysis_main, NULL) != 0) {
+    fprintf(stderr, "WARNING: Critical path: failed to start the analysis thread.\n");
+    pthread_cond_destroy(&wake_cond);
+    free(rings);
+    rings = NULL;
+    return -1;
+  }
+  analysis_running = 1;
+  return 0;
+}
+
+void critical_path_record(int buffer, int reaction, const trace_record_nodeps_t* end, int64_t start_time) {
+  if (!rings || buffer + 1 >= num_rings) {
+    return;
+  }
+  path_ring_t* ring = &rings[buffer + 1];
+  critical_path_execution_t* slots = ring->slots;
+  if (!slots && !(slots = allocate_slots(ring))) {
+    return;
+  }
+  uint64_t head = ring->head;
+  uint64_t used = head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  if (used >= CRITICAL_PATH_RING_RECORDS) {
+    __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  if (used == CRITICAL_PATH_RING_RECORDS / 2) {
+    // Drain before the next poll; once per half ring, so the signal costs little per execution.
+    pthread_cond_signal(&wake_cond);
+  }
+  slots[head & RING_MASK] = (critical_path_execution_t){.reaction = reaction,
+                                                        .worker = buffer,
+                                                        .logical_time = end->logical_time,
+                                                        .microstep = end->microstep,
+                                                        .start_time = start_time,
+                                                        .end_time = end->physical_time};
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void critical_path_close(void) {
+  if (analysis_running) {
+    pthread_mutex_lock(&wake_mutex);
+    stopping = 1;
+    pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&wake_mutex);
+    pthread_join(analysis_thread, NULL);
+    pthread_cond_destroy(&wake_cond);
+    analysis_running = 0;
+  }
+  if (dropped > 0) {
+    fprintf(stderr, "WARNING: Critical path: %llu reaction executions were dropped; the paths of their tags "
+                    "may be wrong.\n", (unsigned long long)dropped);
+  }
+  if (rings) {
+    for (int i = 0; i < num_rings; i++) {
+      free(rings[i].slots);
+    }
+    free(rings);
+    rings = NULL;
+  }
+  free(pending);
+  pending = NULL;
+  pending_count = pending_capacity = 0;
+  free(by_end);
+  free(on_path);
+  by_end = NULL;
+  on_path = NULL;
+  scratch_capacity = 0;
+  has_bound = 0;
+  dropped = 0;
+}
@@ -0,0 +1,379 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file ctf_writer.c
+ * @brief Common Trace Format (CTF 1.8) sink for Trace Compass and babeltrace
+ *
+ * Every worker writes a stream file of its own, so recording needs no lock: an event is
+ * a fixed-size copy of the record into the worker's current packet (see ctf_event_t).
+ * A full packet gets its header filled in and is written with a single write(2) by the
+ * worker, and the packet buffer is reused. The packet buffer is allocated by the worker
+ * on its first event, to be local to it.
+ *
+ * The TSDL metadata is generated once, at open, from trace_event_names[]: one event
+ * class per trace_event_t, all with the fields of trace_record_nodeps_t.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ctf_writer.h"
+#include "trace_impl.h"
+#include "trace_types.h"
+
+/** Event class ID of the `lf_object` events, after those of the trace_event_t values. */
+#define CTF_OBJECT_EVENT_ID NUM_EVENT_TYPES
+
+// PRIVATE DATA STRUCTURES ***************************************************
+
+/** @brief A stream file and its packet being filled. On cache lines of its own, as it is written per event. */
+typedef struct ctf_stream {
+  int fd;
+  int failed;
+  uint8_t* packet;     ///< CTF_PACKET_SIZE bytes, starting with a ctf_packet_header_t
+  size_t size;         ///< Bytes used in the packet
+  uint64_t first_time; ///< Timestamp of the first event of the packet
+  uint64_t last_time;  ///< Timestamp of the last event of the stream
+} __attribute__((aligned(64))) ctf_stream_t;
+
+static char trace_directory[TRACE_MAX_FILENAME_LENGTH];
+static uint8_t trace_uuid[16];
+static ctf_stream_t* streams; ///< num_streams entries, the first for buffer -1
+static int num_streams;
+static int64_t objects_time;
+
+// PRIVATE HELPERS ***********************************************************
+
+static void generate_uuid(uint8_t uuid[16]) {
+  int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+  ssize_t got = fd >= 0 ? read(fd, uuid, 16) : -1;
+  if (fd >= 0) {
+    close(fd);
+  }
+  if (got != 16) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t seed = ((uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec) ^ ((uint64_t)getpid() << 32);
+    for (int i = 0; i < 16; i++) {
+      seed = seed * 6364136223846793005u + 1442695040888963407u;
+      uuid[i] = (uint8_t)(seed >> 56);
+    }
+  }
+  // Version 4, variant 1.
+  uuid[6] = (uint8_t)((uuid[6] & 0x0f) | 0x40);
+  uuid[8] = (uint8_t)((uuid[8] & 0x3f) | 0x80);
+}
+
+/** @brief Write a TSDL string literal, escaping quotes and backslashes. */
+static void write_tsdl_string(FILE* file, const char* text) {
+  fputc('"', file);
+  for (const char* c = text; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      fputc('\\', file);
+    }
+    fputc(*c, file);
+  }
+  fputc('"', file);
+}
+
+/** @brief Write the TSDL metadata describing the layouts in ctf_writer.h. */
+static int write_metadata(const char* process_name) {
+  char path[TRACE_MAX_FILENAME_LENGTH + 16];
+  snprintf(path, sizeof(path), "%s/metadata", trace_directory);
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    return -1;
+  }
+  char uuid[37];
+  snprintf(uuid, sizeof(uuid), "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x", trace_uuid[0],
+           trace_uuid[1], trace_uuid[2], trace_uuid[3], trace_uuid[4], trace_uuid[5], trace_uuid[6], trace_uuid[7],
+           trace_uuid[8], trace_uuid[9], trace_uuid[10], trace_uuid[11], trace_uuid[12], trace_uuid[13],
+           trace_uuid[14], trace_uuid[15]);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  const char* byte_order = "be";
+#else
+  const char* byte_order = "le";
+#endif
+
+  fprintf(file,
+          "/* CTF 1.8 */\n\n"
+          "typealias integer { size = 8; align = 8; signed = false; } := uint8_t;\n"
+          "typealias integer { size = 32; align = 8; signed = false; } := uint32_t;\n"
+          "typealias integer { size = 64; align = 8; signed = false; } := uint64_t;\n"
+          "typealias integer { size = 32; align = 8; signed = true; } := int32_t;\n"
+          "typealias integer { size = 64; align = 8; signed = true; } := int64_t;\n"
+          "typealias integer { size = 64; align = 8; signed = false; base = hex; } := pointer_t;\n\n"
+          "trace {\n"
+          "\tmajor = 1;\n"
+          "\tminor = 8;\n"
+          "\tuuid = \"%s\";\n"
+          "\tbyte_order = %s;\n"
+          "\tpacket.header := struct {\n"
+          "\t\tuint32_t magic;\n"
+          "\t\tuint8_t uuid[16];\n"
+          "\t\tuint32_t stream_id;\n"
+          "\t};\n"
+          "};\n\n"
+          "env {\n"
+          "\tdomain = \"lf\";\n"
+          "\ttracer_name = \"lf-trace-xronos\";\n"
+          "\tprocess_name = ",
+          uuid, byte_order);
+  write_tsdl_string(file, process_name ? process_name : "");
+  fprintf(file,
+          ";\n"
+          "};\n\n"
+          "clock {\n"
+          "\tname = lf_physical;\n"
+          "\tuuid = \"%s\";\n"
+          "\tdescription = \"Physical time of the trace records\";\n"
+          "\tfreq = 1000000000;\n"
+          "\toffset = 0;\n"
+          "\tabsolute = true;\n"
+          "};\n\n"
+          "typealias integer { size = 64; align = 8; signed = false; map = clock.lf_physical.value; } := "
+          "uint64_clock_t;\n\n"
+          "stream {\n"
+          "\tid = 0;\n"
+          "\tpacket.context := struct {\n"
+          "\t\tuint64_clock_t timestamp_begin;\n"
+          "\t\tuint64_clock_t timestamp_end;\n"
+          "\t\tuint64_t content_size;\n"
+          "\t\tuint64_t packet_size;\n"
+          "\t\tint32_t cpu_id;\n"
+          "\t};\n"
+          "\tevent.header := struct {\n"
+          "\t\tuint64_clock_t timestamp;\n"
+          "\t\tuint32_t id;\n"
+          "\t};\n"
+          "};\n",
+          uuid);
+  for (int id = 0; id < NUM_EVENT_TYPES; id++) {
+    fprintf(file, "\nevent {\n\tname = ");
+    write_tsdl_string(file, trace_event_names[id]);
+    fprintf(file,
+            ";\n"
+            "\tid = %d;\n"
+            "\tstream_id = 0;\n"
+            "\tfields := struct {\n"
+            "\t\tint32_t src_id;\n"
+            "\t\tint32_t dst_id;\n"
+            "\t\tpointer_t pointer;\n"
+            "\t\tint64_t logical_time;\n"
+            "\t\tint64_t microstep;\n"
+            "\t\tpointer_t trigger;\n"
+            "\t\tint64_t extra_delay;\n"
+            "\t};\n"
+            "};\n",
+            id);
+  }
+  fprintf(file,
+          "\nevent {\n"
+          "\tname = \"lf_object\";\n"
+          "\tid = %d;\n"
+          "\tstream_id = 0;\n"
+          "\tfields := struct {\n"
+          "\t\tpointer_t pointer;\n"
+          "\t\tpointer_t trigger;\n"
+          "\t\tint32_t type;\n"
+          "\t\tstring description;\n"
+          "\t};\n"
+          "};\n",
+          CTF_OBJECT_EVENT_ID);
+  return fclose(file) == 0 ? 0 : -1;
+}
+
+/** @brief Create the file of a stream and its packet buffer. */
+static int open_stream(ctf_stream_t* stream, const char* name) {
+  char path[TRACE_MAX_FILENAME_LENGTH + 32];
+  snprintf(path, sizeof(path), "%s/%s", trace_directory, name);
+  stream->packet = (uint8_t*)malloc(CTF_PACKET_SIZE);
+  stream->fd = stream->packet ? open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+  if (stream->fd < 0) {
+    fprintf(stderr, "WARNING: Failed to create CTF stream %s: %s\n", path, strerror(errno));
+    free(stream->packet);
+    stream->packet = NULL;
+    stream->failed = 1;
+    return -1;
+  }
+  stream->size = sizeof(ctf_packet_header_t);
+  return 0;
+}
+
+/** @brief Complete the header of the current packet, write it and start the next one. */
+static void write_packet(ctf_stream_t* stream, int cpu_id) {
+  if (stream->size == sizeof(ctf_packet_header_t)) {
+    return;
+  }
+  ctf_packet_header_t* header = (ctf_packet_header_t*)stream->packet;
+  header->magic = CTF_MAGIC;
+  memcpy(header->uuid, trace_uuid, sizeof(trace_uuid));
+  header->stream_id = 0;
+  header->timestamp_begin = stream->first_time;
+  header->timestamp_end = stream->last_time;
+  header->content_size = (uint64_t)stream->size * 8;
+  header->packet_size = header->content_size;
+  header->cpu_id = cpu_id;
+  const uint8_t* data = stream->packet;
+  size_t remaining = stream->size;
+  while (remaining > 0) {
+    ssize_t written = write(stream->fd, data, remaining);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      fprintf(stderr, "WARNING: Access to CTF stream failed: %s\n", strerror(errno));
+      stream->failed = 1;
+      break;
+    }
+    data += written;
+    remaining -= (size_t)written;
+  }
+  stream->size = sizeof(ctf_packet_header_t);
+}
+
+static void close_stream(ctf_stream_t* stream, int cpu_id) {
+  if (stream->packet) {
+    if (!stream->failed) {
+      write_packet(stream, cpu_id);
+    }
+    close(stream->fd);
+    free(stream->packet);
+    stream->packet = NULL;
+  }
+}
+
+/** @brief Write the `lf_object` events of the object table to the `objects` stream. */
+static void write_objects(const object_description_t* descriptions, size_t num_descriptions) {
+  ctf_stream_t objects;
+  memset(&objects, 0, sizeof(objects));
+  if (open_stream(&objects, "objects") != 0) {
+    return;
+  }
+  uint64_t time = objects_time > 0 ? (uint64_t)objects_time : 0;
+  objects.first_time = objects.last_time = time;
+  for (size_t i = 0; i < num_descriptions && !objects.failed; i++) {
+    const object_description_t* desc = &descriptions[i];
+    const char* text = desc->description ? desc->description : "";
+    size_t length = strlen(text) + 1;
+    // Header, pointer, trigger and type, then the description.
+    size_t size = sizeof(uint64_t) + sizeof(uint32_t) + 2 * sizeof(uint64_t) + sizeof(int32_t) + length;
+    if (size > CTF_PACKET_SIZE - sizeof(ctf_packet_header_t)) {
+      continue;
+    }
+    if (objects.size + size > CTF_PACKET_SIZE) {
+      write_packet(&objects, -1);
+    }
+    uint8_t* out = objects.packet + objects.size;
+    uint32_t id = CTF_OBJECT_EVENT_ID;
+    uint64_t pointer = (uint64_t)(uintptr_t)desc->pointer;
+    uint64_t trigger = (uint64_t)(uintptr_t)desc->trigger;
+    int32_t type = (int32_t)desc->type;
+    memcpy(out, &time, sizeof(time));
+    out += sizeof(time);
+    memcpy(out, &id, sizeof(id));
+    out += sizeof(id);
+    memcpy(out, &pointer, sizeof(pointer));
+    out += sizeof(pointer);
+    memcpy(out, &trigger, sizeof(trigger));
+    out += sizeof(trigger);
+    memcpy(out, &type, sizeof(type));
+    out += sizeof(type);
+    memcpy(out, text, length);
+    objects.size += size;
+  }
+  close_stream(&objects, -1);
+}
+
+// IMPLEMENTATION OF CTF WRITER API ******************************************
+
+int ctf_writer_open(const char* directory, int num_buffers, const char* process_name) {
+  if (!directory || num_buffers < 0) {
+    return -1;
+  }
+  if (strlen(directory) >= TRACE_MAX_FILENAME_LENGTH) {
+    fprintf(stderr, "WARNING: CTF trace directory name is too long: %s\n", directory);
+    return -1;
+  }
+  snprintf(trace_directory, sizeof(trace_directory), "%s", directory);
+  if (mkdir(trace_directory, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "WARNING: Failed to create CTF trace directory %s: %s\n", trace_directory, strerror(errno));
+    return -1;
+  }
+  generate_uuid(trace_uuid);
+  if (write_metadata(process_name) != 0) {
+    fprintf(stderr, "WARNING: Failed to write CTF metadata in %s: %s\n", trace_directory, strerror(errno));
+    return -1;
+  }
+  void* memory = NULL;
+  size_t size = (size_t)(num_buffers + 1) * sizeof(ctf_stream_t);
+  if (posix_memalign(&memory, 64, size) != 0) {
+    return -1;
+  }
+  memset(memory, 0, size);
+  streams = (ctf_stream_t*)memory;
+  num_streams = num_buffers + 1;
+  return 0;
+}
+
+void ctf_writer_set_start_time(int64_t start_time) { objects_time = start_time; }
+
+void ctf_writer_record(int buffer, const trace_record_nodeps_t* tr) {
+  if (!streams || buffer + 1 >= num_streams || (unsigned)tr->event_type >= NUM_EVENT_TYPES) {
+    return;
+  }
+  ctf_stream_t* stream = &streams[buffer + 1];
+  if (!stream->packet) {
+    char name[32];
+    if (buffer < 0) {
+      snprintf(name, sizeof(name), "other_threads");
+    } else {
+      snprintf(name, sizeof(name), "worker_%d", buffer);
+    }
+    if (stream->failed || open_stream(stream, name) != 0) {
+      return;
+    }
+  } else if (stream->size + sizeof(ctf_event_t) > CTF_PACKET_SIZE) {
+    write_packet(stream, buffer);
+  }
+  // Timestamps may not decrease within a stream.
+  uint64_t time = tr->physical_time > 0 ? (uint64_t)tr->physical_time : 0;
+  if (time < stream->last_time) {
+    time = stream->last_time;
+  }
+  if (stream->size == sizeof(ctf_packet_header_t)) {
+    stream->first_time = time;
+  }
+  stream->last_time = time;
+  ctf_event_t* event = (ctf_event_t*)(stream->packet + stream->size);
+  event->timestamp = time;
+  event->id = (uint32_t)tr->event_type;
+  event->src_id = tr->src_id;
+  event->dst_id = tr->dst_id;
+  event->pointer = (uint64_t)(uintptr_t)tr->pointer;
+  event->logical_time = tr->logical_time;
+  event->microstep = tr->microstep;
+  event->trigger = (uint64_t)(uintptr_t)tr->trigger;
+  event->extra_delay = tr->extra_delay;
+  stream->size += sizeof(ctf_event_t);
+}
+
+void ctf_writer_close(const object_description_t* descriptions, size_t num_descriptions) {
+  if (!streams) {
+    return;
+  }
+  for (int i = 0; i < num_streams; i++) {
+    close_stream(&streams[i], i - 1);
+  }
+  write_objects(descriptions, num_descriptions);
+  free(streams);
+  streams = NULL;
+  num_streams = 0;
+}
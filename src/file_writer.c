@@ -0,0 +1,569 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file file_writer.c
+ * @brief Asynchronous chunked file writer for the trace file sink
+ *
+ * Writers of the trace file used to block in write(2) whenever the stdio buffer filled
+ * up, and with it the worker that happened to flush. Here the bytes are gathered into a
+ * small pool of aligned chunks, and a full chunk is handed to the kernel as one write at
+ * a known offset while the next chunk fills. A chunk is reused only after its write has
+ * completed, so the data is never copied again on its way to the file, and with O_DIRECT
+ * it is transferred straight from the chunk.
+ *
+ * With io_uring the chunks are registered once as fixed buffers and written with
+ * IORING_OP_WRITE_FIXED; submission and completion both happen on the appending thread,
+ * which already holds the file mutex, so the ring needs no locking and no extra thread.
+ * liburing is not needed: the three system calls are made directly. Where io_uring is
+ * missing or forbidden (old kernels, seccomp profiles of container runtimes), a writer
+ * thread drains the full chunks with pwrite(2) instead.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "file_writer.h"
+#include "trace_alloc.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define FILE_WRITER_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+/** Alignment of O_DIRECT writes; the last chunk is padded to it and the file truncated afterwards. */
+#define FILE_WRITER_DIRECT_ALIGNMENT 4096
+
+// PRIVATE DATA STRUCTURES ***************************************************
+
+typedef enum chunk_state {
+  CHUNK_FREE = 0,
+  CHUNK_FILLING,
+  CHUNK_IN_FLIGHT,
+} chunk_state_t;
+
+#ifdef FILE_WRITER_HAVE_IO_URING
+/** @brief The rings shared with the kernel (see io_uring_setup(2)). */
+typedef struct uring {
+  int fd;
+  void* sq_ring;
+  size_t sq_ring_size;
+  void* cq_ring;
+  size_t cq_ring_size;
+  struct io_uring_sqe* sqes;
+  size_t sqes_size;
+  unsigned* sq_tail;
+  unsigned* sq_mask;
+  unsigned* sq_array;
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned* cq_mask;
+  struct io_uring_cqe* cqes;
+  int registered; ///< Chunks are registered as fixed buffers
+} uring_t;
+#endif
+
+struct file_writer {
+  int fd;
+  int direct;
+  int failed;
+  file_writer_mode_t mode; ///< FILE_WRITER_IO_URING or FILE_WRITER_THREAD once open
+  uint8_t* memory;         ///< FILE_WRITER_CHUNKS chunks
+  size_t mapped;
+  int current;             ///< Chunk being filled, or -1
+  size_t fill;             ///< Bytes in the current chunk
+  uint64_t offset;         ///< File offset of the current chunk
+  int in_flight;
+  chunk_state_t states[FILE_WRITER_CHUNKS];
+  struct iovec chunks[FILE_WRITER_CHUNKS]; ///< Base and length of each chunk's write
+  uint64_t offsets[FILE_WRITER_CHUNKS];
+
+#ifdef FILE_WRITER_HAVE_IO_URING
+  uring_t ring;
+#endif
+
+  // Writer thread
+  pthread_t thread;
+  int thread_running;
+  pthread_mutex_t mutex;
+  pthread_cond_t submitted;
+  pthread_cond_t completed;
+  int queue[FILE_WRITER_CHUNKS];
+  int queue_head;
+  int queue_count;
+  int stopping;
+};
+
+// PRIVATE HELPERS ***********************************************************
+
+static uint8_t* chunk_memory(file_writer_t* writer, int chunk) {
+  return writer->memory + (size_t)chunk * FILE_WRITER_CHUNK_SIZE;
+}
+
+/** @brief Write all of a buffer at an offset, retrying short writes. */
+static int pwrite_all(int fd, const uint8_t* data, size_t size, uint64_t offset) {
+  while (size > 0) {
+    ssize_t written = pwrite(fd, data, size, (off_t)offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (written == 0) {
+      return -1;
+    }
+    data += written;
+    size -= (size_t)written;
+    offset += (uint64_t)written;
+  }
+  return 0;
+}
+
+/**
+ * @brief Account for a finished write of `result` bytes (or -errno) and free the chunk.
+ */
+static void complete_chunk(file_writer_t* writer, int chunk, long result) {
+  const struct iovec* io = &writer->chunks[chunk];
+  if (result < 0) {
+    writer->failed = 1;
+  } else if ((size_t)result < io->iov_len) {
+    // Short writes are rare on regular files (e.g. a full disk); finish synchronously to find out.
+    const uint8_t* rest = (const uint8_t*)io->iov_base + result;
+    if (pwrite_all(writer->fd, rest, io->iov_len - (size_t)result, writer->offsets[chunk] + (uint64_t)result) != 0) {
+      writer->failed = 1;
+    }
+  }
+  writer->states[chunk] = CHUNK_FREE;
+  writer->in_flight--;
+}
+
+#ifdef FILE_WRITER_HAVE_IO_URING
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static void uring_close(uring_t* ring) {
+  if (ring->sqes) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_ring && ring->cq_ring != ring->sq_ring) {
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  }
+  if (ring->sq_ring) {
+    munmap(ring->sq_ring, ring->sq_ring_size);
+  }
+  if (ring->fd >= 0) {
+    close(ring->fd);
+  }
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+}
+
+/**
+ * @brief Set up a ring with room for every chunk and register the chunks.
+ *
+ * @return 0 on success, -1 if io_uring is not available
+ */
+static int uring_open(file_writer_t* writer) {
+  uring_t* ring = &writer->ring;
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = (int)syscall(__NR_io_uring_setup, FILE_WRITER_CHUNKS, &params);
+  if (ring->fd < 0) {
+    ring->fd = -1;
+    return -1;
+  }
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  int single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap && ring->cq_ring_size > ring->sq_ring_size) {
+    ring->sq_ring_size = ring->cq_ring_size;
+  }
+  ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                       IORING_OFF_SQ_RING);
+  if (ring->sq_ring == MAP_FAILED) {
+    ring->sq_ring = NULL;
+    uring_close(ring);
+    return -1;
+  }
+  ring->cq_ring = single_mmap ? ring->sq_ring
+                              : mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                     ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                    IORING_OFF_SQES);
+  if (ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+    ring->cq_ring = ring->cq_ring == MAP_FAILED ? NULL : ring->cq_ring;
+    ring->sqes = ring->sqes == MAP_FAILED ? NULL : ring->sqes;
+    uring_close(ring);
+    return -1;
+  }
+  uint8_t* sq = (uint8_t*)ring->sq_ring;
+  uint8_t* cq = (uint8_t*)ring->cq_ring;
+  ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+  ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+  ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+  ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+  ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+  // Fixed buffers spare the kernel from pinning the pages of every write. Registration can
+  // fail under a low RLIMIT_MEMLOCK; plain vectored writes are used then.
+  struct iovec buffers[FILE_WRITER_CHUNKS];
+  for (int i = 0; i < FILE_WRITER_CHUNKS; i++) {
+    buffers[i].iov_base = chunk_memory(writer, i);
+    buffers[i].iov_len = FILE_WRITER_CHUNK_SIZE;
+  }
+  ring->registered =
+      syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, buffers, FILE_WRITER_CHUNKS) == 0;
+  return 0;
+}
+
+/**
+ * @brief Reap the completions available, waiting for one if `wait` is set.
+ */
+static void uring_reap(file_writer_t* writer, int wait) {
+  uring_t* ring = &writer->ring;
+  for (;;) {
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    if (head != tail) {
+      while (head != tail) {
+        struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+        int chunk = (int)cqe->user_data;
+        long result = cqe->res;
+        head++;
+        if (chunk >= 0 && chunk < FILE_WRITER_CHUNKS && writer->states[chunk] == CHUNK_IN_FLIGHT) {
+          complete_chunk(writer, chunk, result);
+        }
+      }
+      __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+      return;
+    }
+    if (!wait || writer->in_flight == 0) {
+      return;
+    }
+    if (uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+      return;
+    }
+  }
+}
+
+/** @brief Submit the write of an in-flight chunk, or write it synchronously if io_uring refuses it. */
+static void uring_submit(file_writer_t* writer, int chunk) {
+  uring_t* ring = &writer->ring;
+  unsigned tail = *ring->sq_tail;
+  unsigned index = tail & *ring->sq_mask;
+  struct io_uring_sqe* sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->fd = writer->fd;
+  sqe->off = writer->offsets[chunk];
+  sqe->user_data = (uint64_t)chunk;
+  if (ring->registered) {
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->addr = (uint64_t)(uintptr_t)writer->chunks[chunk].iov_base;
+    sqe->len = (uint32_t)writer->chunks[chunk].iov_len;
+    sqe->buf_index = (uint16_t)chunk;
+  } else {
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->addr = (uint64_t)(uintptr_t)&writer->chunks[chunk];
+    sqe->len = 1;
+  }
+  ring->sq_array[index] = index;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  for (;;) {
+    int submitted = uring_enter(ring->fd, 1, 0, 0);
+    if (submitted > 0) {
+      return;
+    }
+    if (submitted < 0 && errno == EINTR) {
+      continue;
+    }
+    // EAGAIN (no memory for the request) and EBUSY (completions not reaped yet) clear as earlier
+    // writes complete; with none in flight, or when none completes, write synchronously.
+    int before = writer->in_flight;
+    if (submitted < 0 && (errno == EAGAIN || errno == EBUSY) && before > 1) {
+      uring_reap(writer, 1);
+      if (writer->in_flight < before) {
+        continue;
+      }
+    }
+    break;
+  }
+  // A failed io_uring_enter consumed no entry, so withdraw it before the kernel can see it.
+  __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+  complete_chunk(writer, chunk, pwrite_all(writer->fd, writer->chunks[chunk].iov_base, writer->chunks[chunk].iov_len,
+                                           writer->offsets[chunk]) == 0
+                                    ? (long)writer->chunks[chunk].iov_len
+                                    : -1);
+}
+
+#endif // FILE_WRITER_HAVE_IO_URING
+
+static void* writer_thread(void* arg) {
+  file_writer_t* writer = (file_writer_t*)arg;
+  pthread_mutex_lock(&writer->mutex);
+  for (;;) {
+    while (writer->queue_count == 0 && !writer->stopping) {
+      pthread_cond_wait(&writer->submitted, &writer->mutex);
+    }
+    if (writer->queue_count == 0) {
+      break;
+    }
+    int chunk = writer->queue[writer->queue_head];
+    writer->queue_head = (writer->queue_head + 1) % FILE_WRITER_CHUNKS;
+    writer->queue_count--;
+    pthread_mutex_unlock(&writer->mutex);
+    const struct iovec* io = &writer->chunks[chunk];
+    int result = pwrite_all(writer->fd, io->iov_base, io->iov_len, writer->offsets[chunk]);
+    pthread_mutex_lock(&writer->mutex);
+    complete_chunk(writer, chunk, result == 0 ? (long)io->iov_len : -1);
+    pthread_cond_broadcast(&writer->completed);
+  }
+  pthread_mutex_unlock(&writer->mutex);
+  return NULL;
+}
+
+/** @brief Hand a filled chunk of `length` bytes to the kernel or the writer thread. */
+static void submit_chunk(file_writer_t* writer, int chunk, size_t length) {
+  writer->chunks[chunk].iov_base = chunk_memory(writer, chunk);
+  writer->chunks[chunk].iov_len = length;
+  writer->offsets[chunk] = writer->offset;
+#ifdef FILE_WRITER_HAVE_IO_URING
+  if (writer->mode == FILE_WRITER_IO_URING) {
+    writer->states[chunk] = CHUNK_IN_FLIGHT;
+    writer->in_flight++;
+    uring_submit(writer, chunk);
+    return;
+  }
+#endif
+  pthread_mutex_lock(&writer->mutex);
+  writer->states[chunk] = CHUNK_IN_FLIGHT;
+  writer->in_flight++;
+  writer->queue[(writer->queue_head + writer->queue_count) % FILE_WRITER_CHUNKS] = chunk;
+  writer->queue_count++;
+  pthread_cond_signal(&writer->submitted);
+  pthread_mutex_unlock(&writer->mutex);
+}
+
+static int find_free_chunk(const file_writer_t* writer) {
+  for (int i = 0; i < FILE_WRITER_CHUNKS; i++) {
+    if (writer->states[i] == CHUNK_FREE) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/** @brief Take a free chunk to fill, waiting for a write to complete if there is none. */
+static int acquire_chunk(file_writer_t* writer) {
+#ifdef FILE_WRITER_HAVE_IO_URING
+  if (writer->mode == FILE_WRITER_IO_URING) {
+    uring_reap(writer, 0);
+    int chunk;
+    while ((chunk = find_free_chunk(writer)) < 0) {
+      uring_reap(writer, 1);
+    }
+    writer->states[chunk] = CHUNK_FILLING;
+    return chunk;
+  }
+#endif
+  pthread_mutex_lock(&writer->mutex);
+  int chunk;
+  while ((chunk = find_free_chunk(writer)) < 0) {
+    pthread_cond_wait(&writer->completed, &writer->mutex);
+  }
+  writer->states[chunk] = CHUNK_FILLING;
+  pthread_mutex_unlock(&writer->mutex);
+  return chunk;
+}
+
+/** @brief Wait until no write is in flight. */
+static void drain(file_writer_t* writer) {
+#ifdef FILE_WRITER_HAVE_IO_URING
+  if (writer->mode == FILE_WRITER_IO_URING) {
+    while (writer->in_flight > 0) {
+      int before = writer->in_flight;
+      uring_reap(writer, 1);
+      if (writer->in_flight == before && uring_enter(writer->ring.fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+          errno != EINTR) {
+        writer->failed = 1;
+        return;
+      }
+    }
+    return;
+  }
+#endif
+  pthread_mutex_lock(&writer->mutex);
+  while (writer->in_flight > 0) {
+    pthread_cond_wait(&writer->completed, &writer->mutex);
+  }
+  pthread_mutex_unlock(&writer->mutex);
+}
+
+static int start_thread(file_writer_t* writer) {
+  pthread_mutex_init(&writer->mutex, NULL);
+  pthread_cond_init(&writer->submitted, NULL);
+  pthread_cond_init(&writer->completed, NULL);
+  if (pthread_create(&writer->thread, NULL, writer_thread, writer) != 0) {
+    return -1;
+  }
+  writer->thread_running = 1;
+  return 0;
+}
+
+// IMPLEMENTATION OF FILE WRITER API *****************************************
+
+int file_writer_parse_mode(const char* value, file_writer_mode_t* mode) {
+  if (!value || value[0] == '\0' || strcmp(value, "auto") == 0) {
+    *mode = FILE_WRITER_AUTO;
+  } else if (strcmp(value, "io_uring") == 0) {
+    *mode = FILE_WRITER_IO_URING;
+  } else if (strcmp(value, "thread") == 0) {
+    *mode = FILE_WRITER_THREAD;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+file_writer_t* file_writer_open(const char* path, file_writer_mode_t mode, int direct) {
+  file_writer_t* writer = calloc(1, sizeof(file_writer_t));
+  if (!writer) {
+    return NULL;
+  }
+  writer->fd = -1;
+  writer->current = -1;
+#ifdef FILE_WRITER_HAVE_IO_URING
+  writer->ring.fd = -1;
+#endif
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+  if (direct) {
+    writer->fd = open(path, flags | O_DIRECT, 0644);
+    // tmpfs and some other file systems refuse O_DIRECT; the page cache is used there.
+    writer->direct = writer->fd >= 0;
+  }
+#else
+  (void)direct;
+#endif
+  if (writer->fd < 0) {
+    writer->fd = open(path, flags, 0644);
+  }
+  writer->memory = (uint8_t*)trace_alloc((size_t)FILE_WRITER_CHUNKS * FILE_WRITER_CHUNK_SIZE, &writer->mapped);
+  if (writer->fd < 0 || !writer->memory) {
+    int error = errno;
+    file_writer_close(writer);
+    errno = error;
+    return NULL;
+  }
+
+  writer->mode = FILE_WRITER_THREAD;
+#ifdef FILE_WRITER_HAVE_IO_URING
+  if (mode != FILE_WRITER_THREAD && uring_open(writer) == 0) {
+    writer->mode = FILE_WRITER_IO_URING;
+  }
+#endif
+  if (mode == FILE_WRITER_IO_URING && writer->mode != FILE_WRITER_IO_URING) {
+    file_writer_close(writer);
+    errno = ENOSYS;
+    return NULL;
+  }
+  if (writer->mode == FILE_WRITER_THREAD && start_thread(writer) != 0) {
+    file_writer_close(writer);
+    errno = EAGAIN;
+    return NULL;
+  }
+  return writer;
+}
+
+int file_writer_append(file_writer_t* writer, const void* data, size_t size) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  while (size > 0 && !writer->failed) {
+    if (writer->current < 0) {
+      writer->current = acquire_chunk(writer);
+      writer->fill = 0;
+    }
+    size_t room = FILE_WRITER_CHUNK_SIZE - writer->fill;
+    size_t n = size < room ? size : room;
+    memcpy(chunk_memory(writer, writer->current) + writer->fill, bytes, n);
+    writer->fill += n;
+    bytes += n;
+    size -= n;
+    if (writer->fill == FILE_WRITER_CHUNK_SIZE) {
+      submit_chunk(writer, writer->current, FILE_WRITER_CHUNK_SIZE);
+      writer->offset += FILE_WRITER_CHUNK_SIZE;
+      writer->current = -1;
+    }
+  }
+  return writer->failed ? -1 : 0;
+}
+
+uint64_t file_writer_offset(const file_writer_t* writer) {
+  return writer->offset + (writer->current >= 0 ? writer->fill : 0);
+}
+
+const char* file_writer_backend_name(const file_writer_t* writer) {
+  const char* name = writer->mode == FILE_WRITER_IO_URING ? "io_uring" : "thread";
+  return writer->direct ? (writer->mode == FILE_WRITER_IO_URING ? "io_uring, O_DIRECT" : "thread, O_DIRECT") : name;
+}
+
+int file_writer_close(file_writer_t* writer) {
+  if (!writer) {
+    return 0;
+  }
+  uint64_t size = file_writer_offset(writer);
+  if (writer->current >= 0 && writer->fill > 0 && !writer->failed) {
+    size_t length = writer->fill;
+    if (writer->direct) {
+      // O_DIRECT needs whole blocks; the padding is truncated away below.
+      length = (length + FILE_WRITER_DIRECT_ALIGNMENT - 1) & ~(size_t)(FILE_WRITER_DIRECT_ALIGNMENT - 1);
+      memset(chunk_memory(writer, writer->current) + writer->fill, 0, length - writer->fill);
+    }
+    submit_chunk(writer, writer->current, length);
+    writer->current = -1;
+  }
+  if (writer->fd >= 0 && (writer->mode == FILE_WRITER_IO_URING || writer->thread_running)) {
+    drain(writer);
+  }
+  if (writer->thread_running) {
+    pthread_mutex_lock(&writer->mutex);
+    writer->stopping = 1;
+    pthread_cond_signal(&writer->submitted);
+    pthread_mutex_unlock(&writer->mutex);
+    pthread_join(writer->thread, NULL);
+    pthread_mutex_destroy(&writer->mutex);
+    pthread_cond_destroy(&writer->submitted);
+    pthread_cond_destroy(&writer->completed);
+  }
+#ifdef FILE_WRITER_HAVE_IO_URING
+  uring_close(&writer->ring);
+#endif
+  int result = writer->failed ? -1 : 0;
+  if (writer->fd >= 0) {
+    if (writer->direct && ftruncate(writer->fd, (off_t)size) != 0) {
+      result = -1;
+    }
+    if (close(writer->fd) != 0) {
+      result = -1;
+    }
+  }
+  trace_alloc_free(writer->memory, writer->mapped);
+  free(writer);
+  return result;
+}
@@ -0,0 +1,328 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file flight_recorder.c
+ * @brief In-memory flight recorder of raw trace records
+ *
+ * Every worker appends its records to a private ring, which costs a copy and a release
+ * store of the ring head, like the shared-memory sink but without a shared mapping.
+ * A worker maps its ring on its first record, with trace_alloc(), so that the ring is
+ * backed by huge pages where possible and lives on the worker's NUMA node.
+ * Nothing is exported until a trigger: a plugin thread then waits for the post-trigger
+ * window to pass, copies the records of the window from all rings (discarding slots
+ * overwritten during the copy) and hands them to the handler registered by trace_impl.c.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "flight_recorder.h"
+#include "trace_alloc.h"
+
+// PRIVATE DATA STRUCTURES ***************************************************
+
+/** @brief Ring of one worker, on its own cache line. */
+typedef struct flight_ring {
+  uint64_t head;                ///< Number of records ever written (published after the record)
+  trace_record_nodeps_t* slots; ///< ring_capacity records, or NULL until the first record
+  size_t mapped;                ///< Size of the mapping of the slots
+  int failed;                   ///< The slots could not be allocated; records are dropped
+  char padding[64 - sizeof(uint64_t) - sizeof(trace_record_nodeps_t*) - sizeof(size_t) - sizeof(int)];
+} flight_ring_t;
+
+// Trigger states: a trigger claims IDLE -> CLAIMED, fills in the details and publishes PENDING.
+#define TRIGGER_IDLE 0
+#define TRIGGER_CLAIMED 1
+#define TRIGGER_PENDING 2
+
+static flight_ring_t* rings; // num_rings entries; rings[0] is buffer -1
+static int num_rings;
+static uint64_t ring_capacity;
+static uint64_t ring_mask;
+static int64_t window_before;
+static int64_t window_after;
+static flight_recorder_handler_t capture_handler;
+
+static pthread_t recorder_thread;
+static int recorder_running = 0;
+static int stopping = 0;
+static int wake_pipe[2] = {-1, -1};
+static int trigger_state = TRIGGER_IDLE;
+static int64_t trigger_time;
+static const char* trigger_reason;
+static unsigned captures = 0;
+
+static int trigger_signal = 0;
+static struct sigaction previous_action;
+
+// PRIVATE HELPERS ***********************************************************
+
+static int64_t now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/** @brief Wake up the recorder thread. Async-signal-safe. */
+static void wake(void) {
+  int saved_errno = errno;
+  ssize_t written;
+  do {
+    written = write(wake_pipe[1], "x", 1);
+  } while (written < 0 && errno == EINTR);
+  errno = saved_errno;
+}
+
+static void handle_signal(int signal_number) {
+  (void)signal_number;
+  flight_recorder_trigger(0, "signal");
+}
+
+/**
+ * @brief Wait for a wake-up or until the timeout expires.
+ *
+ * @param timeout_ms Milliseconds to wait, or -1 to wait indefinitely
+ */
+static void wait_for_wake(int timeout_ms) {
+  struct pollfd fd = {.fd = wake_pipe[0], .events = POLLIN};
+  if (poll(&fd, 1, timeout_ms) > 0) {
+    char drain[64];
+    ssize_t drained = read(wake_pipe[0], drain, sizeof(drain));
+    (void)drained;
+  }
+}
+
+/**
+ * @brief Copy the records of [from, to] out of one ring.
+ *
+ * @param ring The ring
+ * @param from Start of the window in physical time
+ * @param to End of the window in physical time
+ * @param out Receives the records (ring_capacity slots)
+ * @param lost Incremented by the number of slots overwritten during the copy
+ * @param truncated Set if the ring no longer holds the start of the window
+ * @return The number of records copied
+ */
+static size_t copy_window(flight_ring_t* ring, int64_t from, int64_t to, trace_record_nodeps_t* out, size_t* lost,
+                          int* truncated) {
+  const trace_record_nodeps_t* slots = __atomic_load_n(&ring->slots, __ATOMIC_ACQUIRE);
+  if (!slots) {
+    return 0;
+  }
+  uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  uint64_t first = head > ring_capacity ? head - ring_capacity : 0;
+  for (uint64_t sequence = first; sequence < head; sequence++) {
+    out[sequence - first] = slots[sequence & ring_mask];
+  }
+  // The writer may have overwritten the oldest slots meanwhile, and may be writing the slot of
+  // the record after the new head, which is skipped as well but not counted as lost.
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  uint64_t new_head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+  uint64_t overwritten = new_head > ring_capacity ? new_head - ring_capacity : 0;
+  uint64_t valid = new_head >= ring_capacity ? overwritten + 1 : 0;
+  if (overwritten > first) {
+    *lost += (size_t)((overwritten < head ? overwritten : head) - first);
+  }
+
+  uint64_t start = valid > first ? valid : first;
+  if (start > 0 && start < head && out[start - first].physical_time > from) {
+    // The ring wrapped since the start of the window: it is too small for the pre-trigger window.
+    *truncated = 1;
+  }
+  size_t count = 0;
+  for (uint64_t sequence = start; sequence < head; sequence++) {
+    const trace_record_nodeps_t* tr = &out[sequence - first];
+    if (tr->physical_time >= from && tr->physical_time <= to) {
+      out[count++] = *tr;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Map the slots of a ring, on the thread that writes to it.
+ *
+ * @return The slots, or NULL if they cannot be allocated
+ */
+static trace_record_nodeps_t* allocate_slots(flight_ring_t* ring) {
+  if (ring->failed) {
+    return NULL;
+  }
+  trace_record_nodeps_t* slots =
+      (trace_record_nodeps_t*)trace_alloc((size_t)ring_capacity * sizeof(trace_record_nodeps_t), &ring->mapped);
+  if (!slots) {
+    ring->failed = 1;
+    fprintf(stderr, "WARNING: Flight recorder: out of memory for %llu records of a worker.\n",
+            (unsigned long long)ring_capacity);
+    return NULL;
+  }
+  // Published for the recorder thread.
+  __atomic_store_n(&ring->slots, slots, __ATOMIC_RELEASE);
+  return slots;
+}
+
+static void capture(int64_t time, const char* reason) {
+  trace_record_nodeps_t** buffers = (trace_record_nodeps_t**)calloc((size_t)num_rings, sizeof(trace_record_nodeps_t*));
+  size_t* counts = (size_t*)calloc((size_t)num_rings, sizeof(size_t));
+  flight_recorder_snapshot_t snapshot = {.num_buffers = num_rings - 1, .trigger_time = time, .reason = reason,
+                                         .sequence = captures++};
+  if (!buffers || !counts) {
+    fprintf(stderr, "WARNING: Flight recorder: out of memory for capture %u.\n", snapshot.sequence);
+    free(buffers);
+    free(counts);
+    return;
+  }
+  int64_t from = time > window_before ? time - window_before : 0;
+  int64_t to = time + window_after;
+  for (int i = 0; i < num_rings; i++) {
+    buffers[i] = (trace_record_nodeps_t*)malloc((size_t)ring_capacity * sizeof(trace_record_nodeps_t));
+    if (buffers[i]) {
+      counts[i] = copy_window(&rings[i], from, to, buffers[i], &snapshot.lost, &snapshot.truncated);
+    }
+  }
+  snapshot.records = (const trace_record_nodeps_t* const*)(buffers + 1);
+  snapshot.counts = counts + 1;
+  capture_handler(&snapshot);
+  for (int i = 0; i < num_rings; i++) {
+    free(buffers[i]);
+  }
+  free(buffers);
+  free(counts);
+}
+
+static void* recorder_main(void* arg) {
+  (void)arg;
+  for (;;) {
+    int stop = __atomic_load_n(&stopping, __ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&trigger_state, __ATOMIC_ACQUIRE) == TRIGGER_PENDING) {
+      int64_t time = trigger_time ? trigger_time : now();
+      // Let the post-trigger window fill up, unless the program is shutting down.
+      for (int64_t remaining; !stop && (remaining = time + window_after - now()) > 0;) {
+        wait_for_wake((int)((remaining + 999999) / 1000000));
+        stop = __atomic_load_n(&stopping, __ATOMIC_ACQUIRE);
+      }
+      capture(time, trigger_reason);
+      __atomic_store_n(&trigger_state, TRIGGER_IDLE, __ATOMIC_RELEASE);
+    }
+    if (stop) {
+      break;
+    }
+    wait_for_wake(-1);
+  }
+  return NULL;
+}
+
+// IMPLEMENTATION OF FLIGHT RECORDER API *************************************
+
+int flight_recorder_open(int num_buffers, uint64_t capacity, int64_t before, int64_t after, int signal_number,
+                         flight_recorder_handler_t handler) {
+  if (rings || num_buffers < 0 || capacity == 0 || !handler) {
+    return -1;
+  }
+  ring_capacity = 1;
+  while (ring_capacity < capacity) {
+    ring_capacity <<= 1;
+  }
+  ring_mask = ring_capacity - 1;
+  num_rings = num_buffers + 1;
+  window_before = before;
+  window_after = after;
+  capture_handler = handler;
+
+  void* memory = NULL;
+  if (posix_memalign(&memory, 64, (size_t)num_rings * sizeof(flight_ring_t)) != 0) {
+    fprintf(stderr, "WARNING: Flight recorder: out of memory.\n");
+    return -1;
+  }
+  rings = (flight_ring_t*)memory;
+  memset(rings, 0, (size_t)num_rings * sizeof(flight_ring_t));
+
+  if (pipe(wake_pipe) != 0) {
+    fprintf(stderr, "WARNING: Flight recorder: failed to create pipe: %s\n", strerror(errno));
+    flight_recorder_close();
+    return -1;
+  }
+  stopping = 0;
+  if (pthread_create(&recorder_thread, NULL, recorder_main, NULL) != 0) {
+    fprintf(stderr, "WARNING: Flight recorder: failed to start the recorder thread.\n");
+    flight_recorder_close();
+    return -1;
+  }
+  recorder_running = 1;
+
+  if (signal_number > 0) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(signal_number, &action, &previous_action) == 0) {
+      trigger_signal = signal_number;
+    } else {
+      fprintf(stderr, "WARNING: Flight recorder: cannot handle signal %d: %s\n", signal_number, strerror(errno));
+    }
+  }
+  return 0;
+}
+
+void flight_recorder_record(int buffer, const trace_record_nodeps_t* tr) {
+  if (!rings || buffer + 1 >= num_rings) {
+    return;
+  }
+  flight_ring_t* ring = &rings[buffer + 1];
+  trace_record_nodeps_t* slots = ring->slots;
+  if (!slots && !(slots = allocate_slots(ring))) {
+    return;
+  }
+  uint64_t head = ring->head;
+  slots[head & ring_mask] = *tr;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void flight_recorder_trigger(int64_t physical_time, const char* reason) {
+  int expected = TRIGGER_IDLE;
+  if (!recorder_running ||
+      !__atomic_compare_exchange_n(&trigger_state, &expected, TRIGGER_CLAIMED, 0, __ATOMIC_ACQUIRE,
+                                   __ATOMIC_RELAXED)) {
+    return;
+  }
+  trigger_time = physical_time;
+  trigger_reason = reason;
+  __atomic_store_n(&trigger_state, TRIGGER_PENDING, __ATOMIC_RELEASE);
+  wake();
+}
+
+void flight_recorder_close(void) {
+  if (trigger_signal) {
+    sigaction(trigger_signal, &previous_action, NULL);
+    trigger_signal = 0;
+  }
+  if (recorder_running) {
+    __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+    wake();
+    pthread_join(recorder_thread, NULL);
+    recorder_running = 0;
+  }
+  for (int i = 0; i < 2; i++) {
+    if (wake_pipe[i] >= 0) {
+      close(wake_pipe[i]);
+      wake_pipe[i] = -1;
+    }
+  }
+  if (rings) {
+    for (int i = 0; i < num_rings; i++) {
+      trace_alloc_free(rings[i].slots, rings[i].mapped);
+    }
+    free(rings);
+    rings = NULL;
+  }
+  trigger_state = TRIGGER_IDLE;
+}
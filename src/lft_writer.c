@@ -0,0 +1,322 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file lft_writer.c
+ * @brief Writer for the standard Lingua Franca binary trace format (.lft)
+ *
+ * This is the file format produced by the default reactor-c trace plugin, so the
+ * files written here can be post-processed with the existing `trace_to_csv`,
+ * `trace_to_chrome` and `trace_to_influxdb` tools while spans are exported live.
+ *
+ * Records are appended without locking to a per-worker buffer. A full buffer is
+ * appended to the file as one block under a mutex. Blocks are gathered into large
+ * chunks that are written asynchronously (see file_writer.h), so a flushing worker
+ * copies its block and returns without waiting for the disk. The records of a buffer are
+ * allocated by the worker that writes them, so that on NUMA machines their pages are
+ * first touched on, and placed in the memory of, the worker's node.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "trace.h"
+#include "platform.h"
+#include "logging_macros.h"
+#include "lft_writer.h"
+
+/** Macro to use when access to trace file fails. */
+#define _LF_TRACE_FAILURE(trace)                                                                                       \
+  do {                                                                                                                 \
+    fprintf(stderr, "WARNING: Access to trace file failed.\n");                                                        \
+    file_writer_close(trace->_lf_trace_file);                                                                          \
+    trace->_lf_trace_file = NULL;                                                                                      \
+    return -1;                                                                                                         \
+  } while (0)
+
+// PRIVATE DATA STRUCTURES ***************************************************
+
+/** Serializes writes to the trace file. Distinct from the tracepoint mutex so that flushing never nests it. */
+static lf_platform_mutex_ptr_t file_mutex;
+static FILE* index_file;
+static int64_t header_start_time;
+
+// PRIVATE HELPERS ***********************************************************
+
+/** @brief Destination of write_header(): returns 0 if all `size` bytes were written. */
+typedef int (*write_fn_t)(void* destination, const void* data, size_t size);
+
+static int write_stdio(void* destination, const void* data, size_t size) {
+  return fwrite(data, 1, size, (FILE*)destination) == size ? 0 : -1;
+}
+
+static int write_file_writer(void* destination, const void* data, size_t size) {
+  return file_writer_append((file_writer_t*)destination, data, size);
+}
+
+/**
+ * @brief Write the start time and an object description table.
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int write_header(write_fn_t write, void* destination, const object_description_t* descriptions,
+                        size_t num_descriptions) {
+  // The second item in the header is the size of the object description table.
+  int table_size = (int)num_descriptions;
+  if (write(destination, &header_start_time, sizeof(int64_t)) != 0 ||
+      write(destination, &table_size, sizeof(int)) != 0) {
+    return -1;
+  }
+  for (size_t i = 0; i < num_descriptions; i++) {
+    const object_description_t* desc = &descriptions[i];
+    // The pointer to the self struct, the pointer to the trigger_t struct, the object type and
+    // the description, including the null terminator.
+    const char* description = desc->description ? desc->description : "";
+    size_t description_size = strlen(description) + 1;
+    if (write(destination, &desc->pointer, sizeof(void*)) != 0 ||
+        write(destination, &desc->trigger, sizeof(void*)) != 0 ||
+        write(destination, &desc->type, sizeof(_lf_trace_object_t)) != 0 ||
+        write(destination, description, description_size) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Write the header of the trace file.
+ *
+ * @return The number of object descriptions written, or -1 on failure
+ */
+static int write_trace_header(trace_t* trace) {
+  if (trace->_lf_trace_file != NULL &&
+      write_header(write_file_writer, trace->_lf_trace_file, trace->_lf_trace_object_descriptions,
+                   trace->_lf_trace_object_descriptions_size) != 0) {
+    _LF_TRACE_FAILURE(trace);
+  }
+  return (int)trace->_lf_trace_object_descriptions_size;
+}
+
+/**
+ * @brief Append the index entry of a block that is about to be written at the current file position.
+ */
+static void write_index_entry(trace_t* trace, int buffer, int count) {
+  if (index_file == NULL) {
+    return;
+  }
+  lft_index_entry_t entry = {.offset = file_writer_offset(trace->_lf_trace_file), .count = count, .buffer = buffer};
+  const trace_record_nodeps_t* records = trace->_lf_trace_buffers[buffer].records;
+  entry.min_logical_time = entry.max_logical_time = records[0].logical_time;
+  entry.min_physical_time = entry.max_physical_time = records[0].physical_time;
+  for (int i = 1; i < count; i++) {
+    if (records[i].logical_time < entry.min_logical_time)
+      entry.min_logical_time = records[i].logical_time;
+    if (records[i].logical_time > entry.max_logical_time)
+      entry.max_logical_time = records[i].logical_time;
+    if (records[i].physical_time < entry.min_physical_time)
+      entry.min_physical_time = records[i].physical_time;
+    if (records[i].physical_time > entry.max_physical_time)
+      entry.max_physical_time = records[i].physical_time;
+  }
+  if (fwrite(&entry, sizeof(entry), 1, index_file) != 1) {
+    // The index is an optimization for readers; the trace file stays valid without it.
+    fclose(index_file);
+    index_file = NULL;
+  }
+}
+
+/**
+ * @brief Write the contents of one worker buffer as a block. The file mutex must be held.
+ */
+static void flush_trace_locked(trace_t* trace, int buffer) {
+  trace_buffer_t* worker_buffer = &trace->_lf_trace_buffers[buffer];
+  if (trace->_lf_trace_file == NULL || worker_buffer->size == 0) {
+    return;
+  }
+
+  // The header is deferred to the first flush so that user trace objects
+  // registered in startup reactions are part of the table.
+  if (!trace->_lf_trace_header_written) {
+    if (write_trace_header(trace) < 0) {
+      lf_print_error("Failed to write trace header. Trace file will be incomplete.");
+      return;
+    }
+    trace->_lf_trace_header_written = true;
+  }
+
+  // Write first the length of the array, then its contents.
+  int count = (int)worker_buffer->size;
+  worker_buffer->size = 0;
+  write_index_entry(trace, buffer, count);
+  size_t records_size = sizeof(trace_record_nodeps_t) * (size_t)count;
+  if (file_writer_append(trace->_lf_trace_file, &count, sizeof(int)) != 0 ||
+      file_writer_append(trace->_lf_trace_file, worker_buffer->records, records_size) != 0) {
+    fprintf(stderr, "WARNING: Access to trace file failed.\n");
+    file_writer_close(trace->_lf_trace_file);
+    trace->_lf_trace_file = NULL;
+  }
+}
+
+// IMPLEMENTATION OF LFT WRITER API ******************************************
+
+int lft_writer_open(trace_t* trace, const char* filename, int max_num_local_threads) {
+  if (!trace || !filename || max_num_local_threads < 0) {
+    return -1;
+  }
+  if (strlen(filename) >= TRACE_MAX_FILENAME_LENGTH) {
+    lf_print_error("Trace file name is too long: %s", filename);
+    return -1;
+  }
+  strcpy(trace->filename, filename);
+
+  file_mutex = lf_platform_mutex_new();
+  if (!file_mutex) {
+    return -1;
+  }
+
+  file_writer_mode_t mode;
+  const char* io_env = getenv("LF_TRACE_FILE_IO");
+  if (file_writer_parse_mode(io_env, &mode) != 0) {
+    fprintf(stderr, "WARNING: Invalid LF_TRACE_FILE_IO value '%s'. Using auto.\n", io_env);
+  }
+  const char* direct_env = getenv("LF_TRACE_FILE_DIRECT");
+  int direct = direct_env && strcmp(direct_env, "1") == 0;
+  trace->_lf_trace_file = file_writer_open(trace->filename, mode, direct);
+  if (trace->_lf_trace_file == NULL) {
+    fprintf(stderr, "WARNING: Failed to open log file with error code %d. No log will be written.\n", errno);
+    lf_platform_mutex_free(file_mutex);
+    file_mutex = NULL;
+    return -1;
+  }
+
+  char index_filename[TRACE_MAX_FILENAME_LENGTH + 4];
+  snprintf(index_filename, sizeof(index_filename), "%s.idx", trace->filename);
+  index_file = fopen(index_filename, "wb");
+  if (index_file) {
+    const uint32_t index_header[2] = {LFT_INDEX_MAGIC, LFT_INDEX_VERSION};
+    if (fwrite(index_header, sizeof(index_header), 1, index_file) != 1) {
+      fclose(index_file);
+      index_file = NULL;
+    }
+  }
+
+  // Do not write the header yet so that startup reactions can register user-defined trace objects.
+  trace->_lf_trace_header_written = false;
+
+  // One buffer per LF thread plus one at index -1 for threads not managed by LF.
+  trace->_lf_number_of_trace_buffers = (size_t)max_num_local_threads;
+  size_t buffers_size = (trace->_lf_number_of_trace_buffers + 1) * sizeof(trace_buffer_t);
+  void* buffers = NULL;
+  if (posix_memalign(&buffers, 64, buffers_size) != 0) {
+    lft_writer_close(trace);
+    return -1;
+  }
+  memset(buffers, 0, buffers_size);
+  trace->_lf_trace_buffers = (trace_buffer_t*)buffers + 1;
+
+  trace->_lf_trace_stop = 0;
+  LF_PRINT_DEBUG("Started writing trace file %s.", trace->filename);
+  return 0;
+}
+
+void lft_writer_record(trace_t* trace, int buffer, const trace_record_nodeps_t* tr) {
+  if (trace->_lf_trace_stop) {
+    return;
+  }
+  trace_buffer_t* worker_buffer = &trace->_lf_trace_buffers[buffer];
+  if (worker_buffer->size >= TRACE_BUFFER_CAPACITY) {
+    // No more room in the buffer. Write the buffer to the file.
+    lf_platform_mutex_lock(file_mutex);
+    flush_trace_locked(trace, buffer);
+    // The file is only read under the mutex: a failed flush of another worker may have closed it.
+    int closed = trace->_lf_trace_file == NULL;
+    lf_platform_mutex_unlock(file_mutex);
+    if (closed || worker_buffer->size >= TRACE_BUFFER_CAPACITY) {
+      // Nothing was written; drop the buffered records and this one rather than overflow.
+      worker_buffer->size = 0;
+      return;
+    }
+  } else if (!worker_buffer->records) {
+    // The first record of the buffer. Allocated here, by the writing thread, to be local to it.
+    worker_buffer->records = (trace_record_nodeps_t*)malloc(sizeof(trace_record_nodeps_t) * TRACE_BUFFER_CAPACITY);
+    if (!worker_buffer->records) {
+      return;
+    }
+  }
+  worker_buffer->records[worker_buffer->size++] = *tr;
+}
+
+void lft_writer_close(trace_t* trace) {
+  if (!trace || !file_mutex) {
+    return;
+  }
+  lf_platform_mutex_lock(file_mutex);
+  if (!trace->_lf_trace_stop && trace->_lf_trace_buffers) {
+    for (int i = -1; i < (int)trace->_lf_number_of_trace_buffers; i++) {
+      flush_trace_locked(trace, i);
+    }
+  }
+  trace->_lf_trace_stop = 1;
+  if (trace->_lf_trace_file != NULL) {
+    // A run without any records still gets a valid header.
+    if (!trace->_lf_trace_header_written && write_trace_header(trace) >= 0) {
+      trace->_lf_trace_header_written = true;
+    }
+    if (trace->_lf_trace_file != NULL) {
+      if (file_writer_close(trace->_lf_trace_file) != 0) {
+        fprintf(stderr, "WARNING: Access to trace file failed.\n");
+      }
+      trace->_lf_trace_file = NULL;
+    }
+  }
+  if (index_file != NULL) {
+    fclose(index_file);
+    index_file = NULL;
+  }
+  lf_platform_mutex_unlock(file_mutex);
+
+  if (trace->_lf_trace_buffers) {
+    for (int i = -1; i < (int)trace->_lf_number_of_trace_buffers; i++) {
+      free(trace->_lf_trace_buffers[i].records);
+    }
+    free(trace->_lf_trace_buffers - 1);
+    trace->_lf_trace_buffers = NULL;
+  }
+  lf_platform_mutex_free(file_mutex);
+  file_mutex = NULL;
+  LF_PRINT_DEBUG("Stopped writing trace file %s.", trace->filename);
+}
+
+int lft_writer_write_snapshot(const trace_t* trace, const char* filename, int num_buffers,
+                              const trace_record_nodeps_t* const* records, const size_t* counts) {
+  FILE* file = fopen(filename, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "WARNING: Failed to open trace file %s: %s\n", filename, strerror(errno));
+    return -1;
+  }
+  // Objects may still be registered concurrently; entries below the published size are complete.
+  size_t num_descriptions = __atomic_load_n(&trace->_lf_trace_object_descriptions_size, __ATOMIC_ACQUIRE);
+  int result = write_header(write_stdio, file, trace->_lf_trace_object_descriptions, num_descriptions);
+  // Readers of the format expect blocks of at most TRACE_BUFFER_CAPACITY records.
+  for (int buffer = -1; buffer < num_buffers && result == 0; buffer++) {
+    for (size_t written = 0; written < counts[buffer] && result == 0;) {
+      size_t remaining = counts[buffer] - written;
+      int count = (int)(remaining < TRACE_BUFFER_CAPACITY ? remaining : TRACE_BUFFER_CAPACITY);
+      if (fwrite(&count, sizeof(int), 1, file) != 1 ||
+          fwrite(records[buffer] + written, sizeof(trace_record_nodeps_t), (size_t)count, file) != (size_t)count) {
+        result = -1;
+      }
+      written += (size_t)count;
+    }
+  }
+  if (fclose(file) != 0 || result != 0) {
+    fprintf(stderr, "WARNING: Access to trace file %s failed.\n", filename);
+    return -1;
+  }
+  return 0;
+}
+
+void lft_writer_set_start_time(int64_t start_time) { header_start_time = start_time; }
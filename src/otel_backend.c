@@ -21,6 +21,14 @@
 
 #include "opentelemetry_c/opentelemetry_c.h"
 #include "otel_backend.h"
+#include "otel_sdk_glue.h"
+
+// Only the entry point table is exported from the shared exporter library.
+#if defined(__GNUC__)
+#define OTEL_BACKEND_EXPORT __attribute__((visibility("default")))
+#else
+#define OTEL_BACKEND_EXPORT
+#endif
 
 /**
  * @brief Generate a random deployment ID (hexadecimal string)
@@ -97,6 +105,172 @@ static int configure_exporter(const char* endpoint) {
   return 0;
 }
 
+/**
+ * @brief Apply an attribute map to a span and destroy it.
+ *
+ * Every span gets a single map: each map is a heap allocation on the worker thread,
+ * and each otelc_set_span_attrs() call takes the span's lock, so the attributes of a
+ * span are collected first and set together.
+ */
+static void set_span_attributes(void* span, void* map) {
+  if (!map) {
+    return;
+  }
+  if (span) {
+    otelc_set_span_attrs(span, map);
+  }
+  otelc_destroy_attr_map(map);
+}
+
+/**
+ * @brief Add common high-cardinality attributes to an attribute map.
+ *
+ * High cardinality attributes: timestamp, microstep, lag.
+ */
+static void add_common_high_cardinality_attributes(void* map, const trace_record_nodeps_t* tr) {
+  if (!map || !tr) {
+    return;
+  }
+  otelc_set_int64_t_attr(map, "xronos.timestamp", tr->logical_time);
+  otelc_set_uint32_t_attr(map, "xronos.microstep", (uint32_t)tr->microstep);
+  otelc_set_int64_t_attr(map, "xronos.lag", tr->physical_time - tr->logical_time);
+}
+
+/**
+ * @brief Add the worker that executed a span (xronos.worker) to an attribute map.
+ */
+static void add_worker_attribute(void* map, int worker) {
+  if (!map) {
+    return;
+  }
+  otelc_set_int64_t_attr(map, "xronos.worker", worker);
+}
+
+/**
+ * @brief Add the attributes relating a span to the trigger that caused it to an attribute map.
+ *
+ * High cardinality attributes: trigger timestamp, microstep and latency (reaction spans only).
+ */
+static void add_trigger_attributes(void* map, const otel_trigger_info_t* trigger) {
+  if (!map || !trigger) {
+    return;
+  }
+  if (trigger->trigger_fqn) {
+    otelc_set_string_view_attr(map, "xronos.trigger_fqn", trigger->trigger_fqn, strlen(trigger->trigger_fqn));
+  }
+  if (trigger->source_fqn) {
+    otelc_set_string_view_attr(map, "xronos.source_fqn", trigger->source_fqn, strlen(trigger->source_fqn));
+  }
+  if (trigger->latency >= 0) {
+    otelc_set_int64_t_attr(map, "xronos.trigger.timestamp", trigger->timestamp);
+    otelc_set_uint32_t_attr(map, "xronos.trigger.microstep", (uint32_t)trigger->microstep);
+    otelc_set_int64_t_attr(map, "xronos.trigger.latency", trigger->latency);
+  }
+}
+
+/**
+ * @brief Add xronos.schema.low_cardinality_attributes to an attribute map.
+ */
+static void set_low_cardinality_schema_attr(void* map, int has_description, int has_container_fqn) {
+  if (!map) {
+    return;
+  }
+
+  static const char* kLowCardBase[] = {
+      "xronos.element_type",
+  };
+  static const char* kLowCardWithDescNoContainer[] = {
+      "xronos.element_type",
+      "xronos.fqn",
+      "xronos.name",
+  };
+  static const char* kLowCardWithDescWithContainer[] = {
+      "xronos.element_type",
+      "xronos.fqn",
+      "xronos.name",
+      "xronos.container_fqn",
+  };
+
+  const char* const* values = kLowCardBase;
+  size_t count = sizeof(kLowCardBase) / sizeof(kLowCardBase[0]);
+  if (has_description) {
+    if (has_container_fqn) {
+      values = kLowCardWithDescWithContainer;
+      count = sizeof(kLowCardWithDescWithContainer) / sizeof(kLowCardWithDescWithContainer[0]);
+    } else {
+      values = kLowCardWithDescNoContainer;
+      count = sizeof(kLowCardWithDescNoContainer) / sizeof(kLowCardWithDescNoContainer[0]);
+    }
+  }
+
+  otelc_set_span_of_string_view_attr(map,
+                                     "xronos.schema.low_cardinality_attributes",
+                                     values,
+                                     count);
+}
+
+/**
+ * @brief Add low-cardinality attributes for a reaction span to an attribute map.
+ *
+ * Note: We cannot iterate the opaque otelc attribute map to compute the
+ * low-cardinality attribute list dynamically, so we compute the expected list
+ * based on what we set.
+ */
+static void add_reaction_low_cardinality_attributes(void* map,
+                                                    const char* reaction_fqn,
+                                                    int reaction_number,
+                                                    const char* reactor_fqn) {
+  if (!map) {
+    return;
+  }
+
+  const char* element_type_value = "reaction";
+  otelc_set_string_view_attr(map, "xronos.element_type",
+                             element_type_value,
+                             strlen(element_type_value));
+
+  // We only set xronos.fqn/xronos.name/xronos.container_fqn if we have a reaction_fqn.
+  const int has_description = (reaction_fqn != NULL);
+  int has_container_fqn = 0;
+
+  if (reaction_fqn) {
+    otelc_set_string_view_attr(map, "xronos.fqn",
+                               reaction_fqn,
+                               strlen(reaction_fqn));
+
+    char reaction_name_str[32];
+    snprintf(reaction_name_str, sizeof(reaction_name_str), "%d", reaction_number);
+    otelc_set_string_view_attr(map, "xronos.name",
+                               reaction_name_str,
+                               strlen(reaction_name_str));
+
+    if (reactor_fqn && reactor_fqn[0] != '\0') {
+      otelc_set_string_view_attr(map, "xronos.container_fqn",
+                                 reactor_fqn,
+                                 strlen(reactor_fqn));
+      has_container_fqn = 1;
+    }
+  }
+
+  set_low_cardinality_schema_attr(map, has_description, has_container_fqn);
+}
+
+/**
+ * @brief Add low-cardinality attributes for a generic (non-reaction) trace event span to an attribute map.
+ */
+static void add_event_low_cardinality_attributes(void* map) {
+  if (!map) {
+    return;
+  }
+
+  const char* element_type_value = "trace_event";
+  otelc_set_string_view_attr(map, "xronos.element_type",
+                             element_type_value,
+                             strlen(element_type_value));
+  // Only element_type is set.
+  set_low_cardinality_schema_attr(map, 0, 0);
+}
+
 /**
  * @brief Create and initialize an OpenTelemetry backend
  * 
@@ -122,6 +296,7 @@ otel_backend_t* otel_backend_create(const char* endpoint,
   backend->hostname = hostname ? strdup(hostname) : NULL;
   backend->pid = pid;
   backend->initialized = 0;
+  backend->tracer = NULL;
 
   if ((endpoint && !backend->endpoint) ||
       (application_name && !backend->application_name) ||
@@ -177,6 +352,9 @@ int otel_backend_initialize(otel_backend_t* backend) {
     backend->hostname ? backend->hostname : "unknown-host"  // service_instance_id
   );
 
+  // Get tracer once and store it for reuse
+  backend->tracer = otelc_get_tracer();
+
   backend->initialized = 1;
   return 0;
 }
@@ -198,6 +376,12 @@ void otel_backend_destroy(otel_backend_t* backend) {
     return;
   }
 
+  // Destroy tracer if it was created
+  if (backend->tracer) {
+    otelc_destroy_tracer(backend->tracer);
+    backend->tracer = NULL;
+  }
+
   // Note: opentelemetry-c doesn't expose a way to set NoopTracerProvider
   // The tracer provider will remain active until process exit or re-initialization
   
@@ -207,3 +391,214 @@ void otel_backend_destroy(otel_backend_t* backend) {
   free(backend);
 }
 
+void* otel_backend_start_reaction_span(otel_backend_t* backend,
+                                       int worker,
+                                       int reaction,
+                                       const char* span_name,
+                                       const char* reaction_fqn,
+                                       int reaction_number,
+                                       const char* reactor_fqn,
+                                       const trace_record_nodeps_t* tr,
+                                       const otel_trigger_info_t* trigger) {
+  (void)reaction;
+  if (!backend || !backend->tracer) {
+    return NULL;
+  }
+  void* span = otelc_start_span(backend->tracer, span_name, OTELC_SPAN_KIND_INTERNAL, "");
+  if (!span) {
+    return NULL;
+  }
+  void* map = otelc_create_attr_map();
+  add_reaction_low_cardinality_attributes(map, reaction_fqn, reaction_number, reactor_fqn);
+  add_worker_attribute(map, worker);
+  add_common_high_cardinality_attributes(map, tr);
+  add_trigger_attributes(map, trigger);
+  set_span_attributes(span, map);
+  return span;
+}
+
+void otel_backend_end_span(otel_backend_t* backend, void* span) {
+  (void)backend;
+  if (span) {
+    otelc_end_span(span);
+  }
+}
+
+void otel_backend_end_incomplete_span(otel_backend_t* backend, void* span) {
+  (void)backend;
+  if (!span) {
+    return;
+  }
+  void* map = otelc_create_attr_map();
+  otelc_set_int64_t_attr(map, "xronos.incomplete", 1);
+  otelc_set_span_attrs(span, map);
+  otelc_destroy_attr_map(map);
+  otelc_end_span(span);
+}
+
+int otel_backend_flush(otel_backend_t* backend, int64_t timeout) {
+  if (!backend || !backend->tracer) {
+    return 0;
+  }
+  return otel_sdk_force_flush(timeout);
+}
+
+void otel_backend_emit_event_span(otel_backend_t* backend, int worker, const char* event_name,
+                                  const trace_record_nodeps_t* tr, const otel_trigger_info_t* trigger) {
+  if (!backend || !backend->tracer) {
+    return;
+  }
+  void* span = otelc_start_span(backend->tracer, event_name, OTELC_SPAN_KIND_INTERNAL, "");
+  if (!span) {
+    return;
+  }
+  void* map = otelc_create_attr_map();
+  add_event_low_cardinality_attributes(map);
+  add_worker_attribute(map, worker);
+  add_common_high_cardinality_attributes(map, tr);
+  add_trigger_attributes(map, trigger);
+  set_span_attributes(span, map);
+  otelc_end_span(span);
+}
+
+void otel_backend_emit_recorded_span(otel_backend_t* backend,
+                                     int worker,
+                                     int reaction,
+                                     const char* span_name,
+                                     const char* reaction_fqn,
+                                     int reaction_number,
+                                     const char* reactor_fqn,
+                                     const trace_record_nodeps_t* tr,
+                                     int64_t end_physical_time) {
+  (void)reaction;
+  if (!backend || !backend->tracer) {
+    return;
+  }
+  void* span = otelc_start_span(backend->tracer, span_name, OTELC_SPAN_KIND_INTERNAL, "");
+  if (!span) {
+    return;
+  }
+  void* map = otelc_create_attr_map();
+  add_reaction_low_cardinality_attributes(map, reaction_fqn, reaction_number, reactor_fqn);
+  add_worker_attribute(map, worker);
+  add_common_high_cardinality_attributes(map, tr);
+  // The span itself is timed at export; the recorded execution is carried in attributes.
+  otelc_set_int64_t_attr(map, "xronos.physical_time", tr->physical_time);
+  if (end_physical_time >= tr->physical_time) {
+    otelc_set_int64_t_attr(map, "xronos.duration", end_physical_time - tr->physical_time);
+  }
+  set_span_attributes(span, map);
+  otelc_end_span(span);
+}
+
+void* otel_backend_start_worker_span(otel_backend_t* backend, int worker) {
+  if (!backend || !backend->tracer) {
+    return NULL;
+  }
+  char span_name[32];
+  snprintf(span_name, sizeof(span_name), "worker %d", worker);
+  void* span = otelc_start_span(backend->tracer, span_name, OTELC_SPAN_KIND_INTERNAL, "");
+  if (!span) {
+    return NULL;
+  }
+  void* map = otelc_create_attr_map();
+  const char* element_type_value = "worker";
+  otelc_set_string_view_attr(map, "xronos.element_type",
+                             element_type_value,
+                             strlen(element_type_value));
+  set_low_cardinality_schema_attr(map, 0, 0);
+  otelc_set_int64_t_attr(map, "xronos.worker", worker);
+  otelc_set_span_attrs(span, map);
+  otelc_destroy_attr_map(map);
+  return span;
+}
+
+void otel_backend_end_worker_span(otel_backend_t* backend, void* span, int64_t reactions, int64_t busy_time) {
+  (void)backend;
+  if (!span) {
+    return;
+  }
+  void* map = otelc_create_attr_map();
+  otelc_set_int64_t_attr(map, "xronos.reactions", reactions);
+  otelc_set_int64_t_attr(map, "xronos.busy_time", busy_time);
+  otelc_set_span_attrs(span, map);
+  otelc_destroy_attr_map(map);
+  otelc_end_span(span);
+}
+
+void otel_backend_emit_critical_path_span(otel_backend_t* backend, const otel_critical_path_t* path) {
+  if (!backend || !backend->tracer) {
+    return;
+  }
+  void* span = otelc_start_span(backend->tracer, "critical path", OTELC_SPAN_KIND_INTERNAL, "");
+  if (!span) {
+    return;
+  }
+  void* map = otelc_create_attr_map();
+  const char* element_type_value = "tag";
+  otelc_set_string_view_attr(map, "xronos.element_type", element_type_value, strlen(element_type_value));
+  set_low_cardinality_schema_attr(map, 0, 0);
+  otelc_set_int64_t_attr(map, "xronos.timestamp", path->timestamp);
+  otelc_set_int64_t_attr(map, "xronos.microstep", (uint32_t)path->microstep);
+  otelc_set_int64_t_attr(map, "xronos.physical_time", path->end_time);
+  otelc_set_int64_t_attr(map, "xronos.reactions", path->reactions);
+  otelc_set_string_view_attr(map, "xronos.critical_path", path->path, strlen(path->path));
+  otelc_set_int64_t_attr(map, "xronos.critical_path.length", path->length);
+  otelc_set_int64_t_attr(map, "xronos.critical_path.latency", path->latency);
+  otelc_set_int64_t_attr(map, "xronos.critical_path.busy_time", path->busy_time);
+  otelc_set_int64_t_attr(map, "xronos.critical_path.wait_time", path->latency - path->busy_time);
+  if (path->slack >= 0) {
+    otelc_set_int64_t_attr(map, "xronos.critical_path.slack", path->slack);
+  }
+  if (path->bottleneck_fqn) {
+    otelc_set_string_view_attr(map, "xronos.critical_path.bottleneck", path->bottleneck_fqn,
+                               strlen(path->bottleneck_fqn));
+  }
+  set_span_attributes(span, map);
+  otelc_end_span(span);
+}
+
+void otel_backend_emit_reaction_summary_span(otel_backend_t* backend, int reaction, const char* reaction_fqn,
+                                             int reaction_number, const char* reactor_fqn,
+                                             const otel_reaction_summary_t* summary) {
+  (void)reaction;
+  if (!backend || !backend->tracer) {
+    return;
+  }
+  void* span = otelc_start_span(backend->tracer, "reaction summary", OTELC_SPAN_KIND_INTERNAL, "");
+  if (!span) {
+    return;
+  }
+  void* map = otelc_create_attr_map();
+  add_reaction_low_cardinality_attributes(map, reaction_fqn, reaction_number, reactor_fqn);
+  // The span itself is timed at export; the interval is carried in attributes.
+  otelc_set_int64_t_attr(map, "xronos.physical_time", summary->start_time);
+  otelc_set_int64_t_attr(map, "xronos.duration", summary->end_time - summary->start_time);
+  otelc_set_int64_t_attr(map, "xronos.summary.executions", summary->executions);
+  otelc_set_int64_t_attr(map, "xronos.summary.outliers", summary->outliers);
+  otelc_set_int64_t_attr(map, "xronos.summary.duration.total", summary->total_duration);
+  otelc_set_int64_t_attr(map, "xronos.summary.duration.max", summary->max_duration);
+  otelc_set_int64_t_attr(map, "xronos.summary.duration.mean", summary->duration_mean);
+  otelc_set_int64_t_attr(map, "xronos.summary.duration.stddev", summary->duration_stddev);
+  otelc_set_int64_t_attr(map, "xronos.summary.lag.mean", summary->lag_mean);
+  otelc_set_int64_t_attr(map, "xronos.summary.lag.stddev", summary->lag_stddev);
+  set_span_attributes(span, map);
+  otelc_end_span(span);
+}
+
+OTEL_BACKEND_EXPORT const otel_backend_ops_t lf_trace_otel_backend_ops = {
+    .create = otel_backend_create,
+    .initialize = otel_backend_initialize,
+    .set_batch_settings = NULL, // The provider is global and reads OTEL_BSP_* at startup
+    .destroy = otel_backend_destroy,
+    .start_reaction_span = otel_backend_start_reaction_span,
+    .end_span = otel_backend_end_span,
+    .emit_event_span = otel_backend_emit_event_span,
+    .emit_recorded_span = otel_backend_emit_recorded_span,
+    .start_worker_span = otel_backend_start_worker_span,
+    .end_worker_span = otel_backend_end_worker_span,
+    .end_incomplete_span = otel_backend_end_incomplete_span,
+    .flush = otel_backend_flush,
+    .emit_critical_path_span = otel_backend_emit_critical_path_span,
+    .emit_reaction_summary_span = otel_backend_emit_reaction_summary_span,
+};
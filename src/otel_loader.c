@@ -0,0 +1,90 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file otel_loader.c
+ * @brief Resolution of the OpenTelemetry backend entry points
+ *
+ * In the default build the backend is linked into liblf-trace-impl.a together with
+ * all of its OpenTelemetry, gRPC, protobuf and Abseil archives.
+ *
+ * With LF_TRACE_NO_OTEL (CMake option INCLUDE_OTEL=OFF) there is no backend at all and
+ * the plugin only writes to its local sinks.
+ *
+ * With LF_TRACE_OTEL_DLOPEN (CMake option LF_TRACE_SHARED_EXPORTER), the backend and
+ * its dependencies are built into a separate shared library instead. It is opened
+ * the first time the exporter is needed, so LF programs link only the small static
+ * plugin, and runs with the exporter disabled never load it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "otel_backend.h"
+
+#if defined(LF_TRACE_NO_OTEL)
+
+const otel_backend_ops_t* otel_backend_load(void) { return NULL; }
+
+#elif defined(LF_TRACE_OTEL_DLOPEN)
+
+#include <dlfcn.h>
+
+#ifndef LF_TRACE_OTEL_LIBRARY_NAME
+#define LF_TRACE_OTEL_LIBRARY_NAME "liblf-trace-otel.so"
+#endif
+
+static const otel_backend_ops_t* loaded_ops;
+
+/**
+ * @brief Open the exporter library and resolve its entry point table.
+ *
+ * The library is searched for at the path in LF_TRACE_OTEL_LIBRARY, then at its
+ * install location, and finally by name on the dynamic loader search path.
+ */
+static const otel_backend_ops_t* load_from(const char* path) {
+  if (!path || path[0] == '\0') {
+    return NULL;
+  }
+  // RTLD_LOCAL keeps the bundled gRPC/protobuf symbols from leaking into the program.
+  void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (!handle) {
+    return NULL;
+  }
+  const otel_backend_ops_t* ops = (const otel_backend_ops_t*)dlsym(handle, OTEL_BACKEND_OPS_SYMBOL);
+  if (!ops) {
+    fprintf(stderr, "WARNING: %s does not provide %s: %s\n", path, OTEL_BACKEND_OPS_SYMBOL, dlerror());
+    dlclose(handle);
+    return NULL;
+  }
+  // The handle is intentionally never closed: spans may be ended until process exit.
+  return ops;
+}
+
+const otel_backend_ops_t* otel_backend_load(void) {
+  if (loaded_ops) {
+    return loaded_ops;
+  }
+  loaded_ops = load_from(getenv("LF_TRACE_OTEL_LIBRARY"));
+#ifdef LF_TRACE_OTEL_LIBRARY_PATH
+  if (!loaded_ops) {
+    loaded_ops = load_from(LF_TRACE_OTEL_LIBRARY_PATH);
+  }
+#endif
+  if (!loaded_ops) {
+    loaded_ops = load_from(LF_TRACE_OTEL_LIBRARY_NAME);
+  }
+  if (!loaded_ops) {
+    fprintf(stderr, "WARNING: Failed to load the OpenTelemetry exporter library %s: %s\n",
+            LF_TRACE_OTEL_LIBRARY_NAME, dlerror());
+  }
+  return loaded_ops;
+}
+
+#else
+
+extern const otel_backend_ops_t lf_trace_otel_backend_ops;
+
+const otel_backend_ops_t* otel_backend_load(void) { return &lf_trace_otel_backend_ops; }
+
+#endif
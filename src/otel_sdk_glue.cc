@@ -0,0 +1,23 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file otel_sdk_glue.cc
+ * @brief Calls into the OpenTelemetry C++ SDK that the opentelemetry-c API does not offer
+ */
+
+#include <chrono>
+
+#include "opentelemetry/sdk/trace/tracer_provider.h"
+#include "opentelemetry/trace/provider.h"
+
+#include "otel_sdk_glue.h"
+
+int otel_sdk_force_flush(int64_t timeout) {
+  auto provider = opentelemetry::trace::Provider::GetTracerProvider();
+  auto* sdk_provider = dynamic_cast<opentelemetry::sdk::trace::TracerProvider*>(provider.get());
+  if (!sdk_provider) {
+    return -1;
+  }
+  return sdk_provider->ForceFlush(std::chrono::microseconds(timeout / 1000)) ? 0 : -1;
+}
@@ -0,0 +1,332 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file otlp_encoder.c
+ * @brief Protobuf encoding of OTLP trace export requests
+ *
+ * Writes the messages of opentelemetry/proto/collector/trace/v1/trace_service.proto
+ * directly in the protobuf wire format, without generated code or intermediate objects.
+ * A reaction span is the concatenation of a constant part, encoded once per reaction,
+ * and of the fields that vary between executions; protobuf allows the fields of a
+ * message in any order, so the two parts need no merging.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "otlp_encoder.h"
+
+/** Protobuf wire types. */
+#define WIRE_VARINT 0
+#define WIRE_FIXED64 1
+#define WIRE_LEN 2
+
+/** Field numbers (opentelemetry/proto/trace/v1/trace.proto and common.proto). */
+#define REQUEST_RESOURCE_SPANS 1
+#define RESOURCE_SPANS_RESOURCE 1
+#define RESOURCE_SPANS_SCOPE_SPANS 2
+#define RESOURCE_ATTRIBUTES 1
+#define SCOPE_SPANS_SCOPE 1
+#define SCOPE_SPANS_SPANS 2
+#define SCOPE_NAME 1
+#define SPAN_TRACE_ID 1
+#define SPAN_SPAN_ID 2
+#define SPAN_NAME 5
+#define SPAN_KIND 6
+#define SPAN_START_TIME 7
+#define SPAN_END_TIME 8
+#define SPAN_ATTRIBUTES 9
+#define KEY_VALUE_KEY 1
+#define KEY_VALUE_VALUE 2
+#define ANY_VALUE_STRING 1
+#define ANY_VALUE_INT 3
+#define ANY_VALUE_ARRAY 5
+#define ARRAY_VALUE_VALUES 1
+
+#define SPAN_KIND_INTERNAL 1
+
+/** Bound on the bytes of tags and lengths around an attribute's key and value. */
+#define ATTRIBUTE_OVERHEAD 32
+
+// PRIVATE HELPERS ***********************************************************
+
+static size_t varint_size(uint64_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+static uint8_t* write_varint(uint8_t* p, uint64_t value) {
+  while (value >= 0x80) {
+    *p++ = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  *p++ = (uint8_t)value;
+  return p;
+}
+
+static uint8_t* write_tag(uint8_t* p, int field, int wire_type) {
+  return write_varint(p, ((uint64_t)field << 3) | (uint64_t)wire_type);
+}
+
+static uint8_t* write_bytes(uint8_t* p, int field, const void* data, size_t length) {
+  p = write_tag(p, field, WIRE_LEN);
+  p = write_varint(p, length);
+  memcpy(p, data, length);
+  return p + length;
+}
+
+static uint8_t* write_fixed64(uint8_t* p, int field, uint64_t value) {
+  p = write_tag(p, field, WIRE_FIXED64);
+  for (int i = 0; i < 8; i++) {
+    p[i] = (uint8_t)(value >> (8 * i));
+  }
+  return p + 8;
+}
+
+/**
+ * @brief Make room for `more` bytes and return where they go, or NULL if out of memory.
+ */
+static uint8_t* reserve(otlp_buffer_t* buffer, size_t more) {
+  if (buffer->failed) {
+    return NULL;
+  }
+  if (buffer->size + more > buffer->capacity) {
+    size_t capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+    while (capacity < buffer->size + more) {
+      capacity *= 2;
+    }
+    uint8_t* data = buffer->owned ? realloc(buffer->data, capacity) : malloc(capacity);
+    if (!data) {
+      buffer->failed = 1;
+      return NULL;
+    }
+    if (!buffer->owned && buffer->size > 0) {
+      memcpy(data, buffer->data, buffer->size);
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    buffer->owned = 1;
+  }
+  return buffer->data + buffer->size;
+}
+
+static void commit(otlp_buffer_t* buffer, const uint8_t* end) { buffer->size = (size_t)(end - buffer->data); }
+
+/**
+ * @brief Write the key of a KeyValue in a repeated field and the header of its AnyValue.
+ *
+ * The caller writes the `value_size` bytes of the AnyValue next.
+ */
+static uint8_t* write_attribute_header(uint8_t* p, int field, const char* key, size_t key_length,
+                                       size_t value_size) {
+  size_t key_value_size = 1 + varint_size(key_length) + key_length + 1 + varint_size(value_size) + value_size;
+  p = write_tag(p, field, WIRE_LEN);
+  p = write_varint(p, key_value_size);
+  p = write_bytes(p, KEY_VALUE_KEY, key, key_length);
+  p = write_tag(p, KEY_VALUE_VALUE, WIRE_LEN);
+  return write_varint(p, value_size);
+}
+
+static void put_string_attribute(otlp_buffer_t* out, int field, const char* key, const char* value,
+                                 size_t length) {
+  size_t key_length = strlen(key);
+  uint8_t* p = reserve(out, key_length + length + ATTRIBUTE_OVERHEAD);
+  if (!p) {
+    return;
+  }
+  p = write_attribute_header(p, field, key, key_length, 1 + varint_size(length) + length);
+  commit(out, write_bytes(p, ANY_VALUE_STRING, value, length));
+}
+
+/** @brief Encode an array of strings, e.g. xronos.schema.low_cardinality_attributes. */
+static void put_string_array_attribute(otlp_buffer_t* out, const char* key, const char* const* values,
+                                       size_t count) {
+  size_t array_size = 0;
+  size_t bound = strlen(key) + ATTRIBUTE_OVERHEAD;
+  for (size_t i = 0; i < count; i++) {
+    size_t length = strlen(values[i]);
+    size_t element_size = 1 + varint_size(length) + length;
+    array_size += 1 + varint_size(element_size) + element_size;
+  }
+  bound += array_size + 16;
+  uint8_t* p = reserve(out, bound);
+  if (!p) {
+    return;
+  }
+  p = write_attribute_header(p, SPAN_ATTRIBUTES, key, strlen(key), 1 + varint_size(array_size) + array_size);
+  p = write_tag(p, ANY_VALUE_ARRAY, WIRE_LEN);
+  p = write_varint(p, array_size);
+  for (size_t i = 0; i < count; i++) {
+    size_t length = strlen(values[i]);
+    p = write_tag(p, ARRAY_VALUE_VALUES, WIRE_LEN);
+    p = write_varint(p, 1 + varint_size(length) + length);
+    p = write_bytes(p, ANY_VALUE_STRING, values[i], length);
+  }
+  commit(out, p);
+}
+
+/** @brief Encode a message field holding the bytes of an encoded message. */
+static void put_message(otlp_buffer_t* out, int field, const otlp_buffer_t* message) {
+  uint8_t* p = reserve(out, message->size + 16);
+  if (!p) {
+    return;
+  }
+  commit(out, write_bytes(p, field, message->data, message->size));
+}
+
+// IMPLEMENTATION OF OTLP ENCODER API ****************************************
+
+void otlp_buffer_init(otlp_buffer_t* buffer, uint8_t* storage, size_t capacity) {
+  buffer->data = storage;
+  buffer->size = 0;
+  buffer->capacity = storage ? capacity : 0;
+  buffer->owned = 0;
+  buffer->failed = 0;
+}
+
+void otlp_buffer_free(otlp_buffer_t* buffer) {
+  if (buffer->owned) {
+    free(buffer->data);
+  }
+  otlp_buffer_init(buffer, NULL, 0);
+}
+
+void otlp_buffer_append(otlp_buffer_t* buffer, const void* data, size_t size) {
+  uint8_t* p = reserve(buffer, size);
+  if (!p) {
+    return;
+  }
+  memcpy(p, data, size);
+  commit(buffer, p + size);
+}
+
+void otlp_encode_span_constant(otlp_buffer_t* out, const char* name, const char* element_type, const char* fqn,
+                               const char* element_name, const char* container_fqn) {
+  static const char* const schema[] = {"xronos.element_type", "xronos.fqn", "xronos.name", "xronos.container_fqn"};
+  size_t name_length = strlen(name);
+  uint8_t* p = reserve(out, name_length + 16);
+  if (!p) {
+    return;
+  }
+  p = write_bytes(p, SPAN_NAME, name, name_length);
+  p = write_tag(p, SPAN_KIND, WIRE_VARINT);
+  commit(out, write_varint(p, SPAN_KIND_INTERNAL));
+
+  size_t schema_count = 1;
+  put_string_attribute(out, SPAN_ATTRIBUTES, "xronos.element_type", element_type, strlen(element_type));
+  if (fqn) {
+    put_string_attribute(out, SPAN_ATTRIBUTES, "xronos.fqn", fqn, strlen(fqn));
+    put_string_attribute(out, SPAN_ATTRIBUTES, "xronos.name", element_name, strlen(element_name));
+    schema_count = 3;
+    if (container_fqn && container_fqn[0] != '\0') {
+      put_string_attribute(out, SPAN_ATTRIBUTES, "xronos.container_fqn", container_fqn, strlen(container_fqn));
+      schema_count = 4;
+    }
+  }
+  put_string_array_attribute(out, "xronos.schema.low_cardinality_attributes", schema, schema_count);
+}
+
+void otlp_encode_span_ids(otlp_buffer_t* out, const uint8_t trace_id[16], const uint8_t span_id[8]) {
+  uint8_t* p = reserve(out, 28);
+  if (!p) {
+    return;
+  }
+  p = write_bytes(p, SPAN_TRACE_ID, trace_id, 16);
+  commit(out, write_bytes(p, SPAN_SPAN_ID, span_id, 8));
+}
+
+void otlp_encode_start_time(otlp_buffer_t* out, uint64_t time) {
+  uint8_t* p = reserve(out, 9);
+  if (p) {
+    commit(out, write_fixed64(p, SPAN_START_TIME, time));
+  }
+}
+
+void otlp_encode_end_time(otlp_buffer_t* out, uint64_t time) {
+  uint8_t* p = reserve(out, 9);
+  if (p) {
+    commit(out, write_fixed64(p, SPAN_END_TIME, time));
+  }
+}
+
+void otlp_encode_int_attribute(otlp_buffer_t* out, const char* key, int64_t value) {
+  size_t key_length = strlen(key);
+  uint8_t* p = reserve(out, key_length + ATTRIBUTE_OVERHEAD);
+  if (!p) {
+    return;
+  }
+  // int64 fields are varints of the two's complement, so negative values take ten bytes.
+  p = write_attribute_header(p, SPAN_ATTRIBUTES, key, key_length, 1 + varint_size((uint64_t)value));
+  p = write_tag(p, ANY_VALUE_INT, WIRE_VARINT);
+  commit(out, write_varint(p, (uint64_t)value));
+}
+
+void otlp_encode_string_attribute(otlp_buffer_t* out, const char* key, const char* value, size_t length) {
+  put_string_attribute(out, SPAN_ATTRIBUTES, key, value, length);
+}
+
+void otlp_encode_span(otlp_buffer_t* out, const otlp_span_constant_t* constant, const otlp_buffer_t* varying) {
+  size_t size = constant->size + varying->size;
+  uint8_t* p = reserve(out, size + 16);
+  if (!p) {
+    return;
+  }
+  p = write_tag(p, SCOPE_SPANS_SPANS, WIRE_LEN);
+  p = write_varint(p, size);
+  memcpy(p, constant->data, constant->size);
+  p += constant->size;
+  memcpy(p, varying->data, varying->size);
+  commit(out, p + varying->size);
+}
+
+int otlp_request_prefix_init(otlp_request_prefix_t* prefix, const char* service_name, const char* instance_id,
+                             const char* scope_name) {
+  otlp_buffer_t message;
+  otlp_buffer_init(&message, NULL, 0);
+  otlp_buffer_init(&prefix->resource, NULL, 0);
+  otlp_buffer_init(&prefix->scope, NULL, 0);
+
+  put_string_attribute(&message, RESOURCE_ATTRIBUTES, "service.name", service_name, strlen(service_name));
+  put_string_attribute(&message, RESOURCE_ATTRIBUTES, "service.instance.id", instance_id, strlen(instance_id));
+  put_message(&prefix->resource, RESOURCE_SPANS_RESOURCE, &message);
+
+  message.size = 0;
+  uint8_t* p = reserve(&message, strlen(scope_name) + 16);
+  if (p) {
+    commit(&message, write_bytes(p, SCOPE_NAME, scope_name, strlen(scope_name)));
+  }
+  put_message(&prefix->scope, SCOPE_SPANS_SCOPE, &message);
+
+  int failed = message.failed || prefix->resource.failed || prefix->scope.failed;
+  otlp_buffer_free(&message);
+  if (failed) {
+    otlp_request_prefix_free(prefix);
+    return -1;
+  }
+  return 0;
+}
+
+void otlp_request_prefix_free(otlp_request_prefix_t* prefix) {
+  otlp_buffer_free(&prefix->resource);
+  otlp_buffer_free(&prefix->scope);
+}
+
+size_t otlp_encode_request_header(const otlp_request_prefix_t* prefix, size_t spans_size, uint8_t* out,
+                                  size_t* header_size, size_t* scope_header_size) {
+  size_t scope_spans_size = prefix->scope.size + spans_size;
+  size_t resource_spans_size =
+      prefix->resource.size + 1 + varint_size(scope_spans_size) + scope_spans_size;
+  uint8_t* p = write_tag(out, REQUEST_RESOURCE_SPANS, WIRE_LEN);
+  p = write_varint(p, resource_spans_size);
+  *header_size = (size_t)(p - out);
+  uint8_t* scope_header = p;
+  p = write_tag(p, RESOURCE_SPANS_SCOPE_SPANS, WIRE_LEN);
+  p = write_varint(p, scope_spans_size);
+  *scope_header_size = (size_t)(p - scope_header);
+  return 1 + varint_size(resource_spans_size) + resource_spans_size;
+}
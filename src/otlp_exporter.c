@@ -0,0 +1,859 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file otlp_exporter.c
+ * @brief Built-in OTLP/HTTP exporter with pre-encoded reaction spans
+ *
+ * An alternative to otel_backend.c behind the same entry points. Instead of building
+ * every span through the SDK (attribute maps, span objects, a protobuf message tree and
+ * its serialization), the exporter writes the OTLP wire format directly:
+ *
+ * - The name, kind and low-cardinality attributes of a reaction's spans are encoded
+ *   once, the first time the reaction runs, and kept under its reaction ID.
+ * - Starting a span encodes only what varies (IDs, timestamps, tag, lag, worker, trigger)
+ *   into a small buffer in the span; ending it appends the end time and copies both
+ *   parts into the pending batch of its worker's lane.
+ * - A background thread swaps the lanes out every OTEL_BSP_SCHEDULE_DELAY milliseconds,
+ *   or when OTEL_BSP_MAX_EXPORT_BATCH_SIZE spans are pending, and sends them in one
+ *   `POST /v1/traces` whose framing is written in front of the encoded spans with a
+ *   gather write, so the spans are never copied again.
+ *
+ * The spans carry the same names and attributes as those of otel_backend.c. They start at
+ * the physical time of their trace record rather than when the export call is made.
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "otlp_encoder.h"
+#include "otlp_exporter.h"
+
+/** Pending batches, one per group of workers so that workers rarely share a lock. */
+#define OTLP_LANES 64
+
+/** Reactions whose constant span fields are cached; reactions with higher IDs are encoded for every span. */
+#define OTLP_TEMPLATE_SLOTS 4096
+
+/** Bytes of a span's varying fields that fit without allocating. */
+#define OTLP_SPAN_STORAGE 256
+
+/** Largest request body; bigger batches are split. */
+#define OTLP_REQUEST_MAX ((size_t)4 * 1024 * 1024)
+
+/** Defaults of the OTEL_BSP_* settings, as in the SDK batch span processor. */
+#define OTLP_SCHEDULE_DELAY_DEFAULT_MS 500
+#define OTLP_MAX_QUEUE_SIZE_DEFAULT 2048
+#define OTLP_MAX_EXPORT_BATCH_SIZE_DEFAULT 512
+
+/** Timeout of connecting to the collector and of each request (OTEL_EXPORTER_OTLP_TIMEOUT, ms). */
+#define OTLP_TIMEOUT_DEFAULT_MS 10000
+
+// PRIVATE DATA STRUCTURES ***************************************************
+
+/** @brief Spans ended but not yet exported by a group of workers. */
+typedef struct otlp_lane {
+  int lock;
+  int64_t count; ///< Spans in the buffer
+  otlp_buffer_t spans;
+} __attribute__((aligned(64))) otlp_lane_t;
+
+typedef struct otlp_exporter {
+  otel_backend_t base; ///< Must be first: the plugin sees only this part
+  char* host;
+  char* port;
+  char* path;
+  otlp_request_prefix_t prefix;
+  int64_t schedule_delay_ms;
+  int64_t max_queue_size;
+  int64_t max_export_batch_size;
+  int64_t timeout_ms;
+
+  otlp_span_constant_t* templates[OTLP_TEMPLATE_SLOTS];
+  otlp_lane_t lanes[OTLP_LANES];
+  int64_t queued;  ///< Spans in the lanes
+  uint64_t dropped;
+
+  pthread_t thread;
+  int thread_running;
+  pthread_mutex_t mutex;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  int stopping;
+  uint64_t flush_requested; ///< Incremented by every flush
+  uint64_t flush_completed; ///< The last flush_requested covered by a finished export
+  int last_result;          ///< Result of that export
+  otlp_buffer_t sending[OTLP_LANES];
+  int socket;
+  int64_t retry_time; ///< CLOCK_MONOTONIC before which no new connection is attempted
+  int warned;
+} otlp_exporter_t;
+
+/** @brief A span between its start and end. */
+typedef struct otlp_span {
+  const otlp_span_constant_t* constant; ///< The reaction's template, or &own_constant
+  otlp_span_constant_t own_constant;
+  otlp_buffer_t varying;
+  int lane;
+  int64_t start_time; ///< Start of the span, from the trace record
+  int64_t started;    ///< CLOCK_MONOTONIC at the start, to time the span like the SDK would
+  uint8_t storage[OTLP_SPAN_STORAGE];
+} otlp_span_t;
+
+static __thread uint64_t random_state;
+
+// PRIVATE HELPERS ***********************************************************
+
+static int64_t now_ns(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/** @brief splitmix64 on a per-thread state, for span and trace IDs. */
+static uint64_t next_random(void) {
+  if (random_state == 0) {
+    random_state = (uint64_t)now_ns(CLOCK_MONOTONIC) ^ (uint64_t)(uintptr_t)&random_state ^ (uint64_t)getpid();
+  }
+  uint64_t z = (random_state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static void encode_new_ids(otlp_buffer_t* out) {
+  uint64_t words[3] = {next_random(), next_random(), next_random()};
+  otlp_encode_span_ids(out, (const uint8_t*)words, (const uint8_t*)&words[2]);
+}
+
+static int64_t env_positive(const char* name, int64_t default_value) {
+  const char* value = getenv(name);
+  if (!value || value[0] == '\0') {
+    return default_value;
+  }
+  long long number = atoll(value);
+  return number > 0 ? (int64_t)number : default_value;
+}
+
+static inline void lock_lane(otlp_lane_t* lane) {
+  while (__atomic_exchange_n(&lane->lock, 1, __ATOMIC_ACQUIRE)) {
+  }
+}
+
+static inline void unlock_lane(otlp_lane_t* lane) { __atomic_store_n(&lane->lock, 0, __ATOMIC_RELEASE); }
+
+/**
+ * @brief Split "http://host[:port][/path]" into its parts; an IPv6 host is written in brackets.
+ *
+ * @return 0 on success, -1 if the endpoint is not a plain http URL
+ */
+static int parse_endpoint(otlp_exporter_t* exporter, const char* endpoint) {
+  if (strncmp(endpoint, "http://", 7) != 0) {
+    fprintf(stderr, "WARNING: The otlp-http exporter supports only http:// endpoints, got '%s'\n", endpoint);
+    return -1;
+  }
+  const char* host = endpoint + 7;
+  const char* path = strchr(host, '/');
+  const char* end = path ? path : host + strlen(host);
+  const char* host_end;
+  const char* colon;
+  if (host[0] == '[') {
+    host_end = memchr(host, ']', (size_t)(end - host));
+    if (!host_end || (host_end + 1 != end && host_end[1] != ':')) {
+      fprintf(stderr, "WARNING: The otlp-http endpoint '%s' has an invalid IPv6 host\n", endpoint);
+      return -1;
+    }
+    host++;
+    colon = host_end + 1 != end ? host_end + 1 : NULL;
+  } else {
+    colon = memchr(host, ':', (size_t)(end - host));
+    host_end = colon ? colon : end;
+  }
+  if (host_end == host || (colon && colon + 1 == end)) {
+    fprintf(stderr, "WARNING: The otlp-http endpoint '%s' has no host or port\n", endpoint);
+    return -1;
+  }
+  exporter->host = strndup(host, (size_t)(host_end - host));
+  exporter->port = colon ? strndup(colon + 1, (size_t)(end - colon - 1)) : strdup("80");
+  // Like the SDK, a base endpoint gets the traces path appended.
+  exporter->path = (path && strcmp(path, "/") != 0) ? strdup(path) : strdup("/v1/traces");
+  return (exporter->host && exporter->port && exporter->path) ? 0 : -1;
+}
+
+static void close_connection(otlp_exporter_t* exporter) {
+  if (exporter->socket >= 0) {
+    close(exporter->socket);
+    exporter->socket = -1;
+  }
+}
+
+static int connect_to_collector(otlp_exporter_t* exporter) {
+  struct addrinfo hints;
+  struct addrinfo* addresses = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(exporter->host, exporter->port, &hints, &addresses) != 0) {
+    return -1;
+  }
+  struct timeval timeout = {.tv_sec = exporter->timeout_ms / 1000, .tv_usec = (exporter->timeout_ms % 1000) * 1000};
+  for (struct addrinfo* address = addresses; address; address = address->ai_next) {
+    int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    // On Linux, SO_SNDTIMEO also bounds connect().
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+      exporter->socket = fd;
+      break;
+    }
+    close(fd);
+  }
+  freeaddrinfo(addresses);
+  return exporter->socket >= 0 ? 0 : -1;
+}
+
+/** @brief Write all of an iovec array, advancing it over partial writes. */
+static int send_all(int fd, struct iovec* iov, int count) {
+  while (count > 0) {
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = (size_t)count;
+    ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    while (count > 0 && (size_t)sent >= iov->iov_len) {
+      sent -= (ssize_t)iov->iov_len;
+      iov++;
+      count--;
+    }
+    if (count > 0) {
+      iov->iov_base = (char*)iov->iov_base + sent;
+      iov->iov_len -= (size_t)sent;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Read an HTTP response and discard its body.
+ *
+ * @return The status code, or -1 if the response cannot be read. *keep_alive is cleared
+ * when the connection cannot be reused.
+ */
+static int read_response(int fd, int* keep_alive) {
+  char buffer[4096];
+  size_t size = 0;
+  char* body = NULL;
+  while (!body) {
+    if (size == sizeof(buffer) - 1) {
+      return -1;
+    }
+    ssize_t received = recv(fd, buffer + size, sizeof(buffer) - 1 - size, 0);
+    if (received <= 0) {
+      if (received < 0 && errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    size += (size_t)received;
+    buffer[size] = '\0';
+    body = strstr(buffer, "\r\n\r\n");
+  }
+  body += 4;
+  int status = -1;
+  if (sscanf(buffer, "HTTP/%*d.%*d %d", &status) != 1) {
+    return -1;
+  }
+  long long content_length = -1;
+  for (char* line = strstr(buffer, "\r\n"); line && line + 2 < body; line = strstr(line + 2, "\r\n")) {
+    if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+      content_length = atoll(line + 17);
+    } else if (strncasecmp(line + 2, "Connection: close", 17) == 0) {
+      *keep_alive = 0;
+    }
+  }
+  if (content_length < 0) {
+    // Without a length (e.g. chunked), the end of the body cannot be found cheaply.
+    *keep_alive = 0;
+    return status;
+  }
+  long long remaining = content_length - (long long)(buffer + size - body);
+  while (remaining > 0) {
+    ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+    if (received <= 0) {
+      *keep_alive = 0;
+      break;
+    }
+    remaining -= received;
+  }
+  return status;
+}
+
+/**
+ * @brief Post one ExportTraceServiceRequest made of the given lanes' spans.
+ *
+ * @return 0 if the collector accepted it
+ */
+static int post_request(otlp_exporter_t* exporter, otlp_buffer_t** parts, int count, size_t spans_size) {
+  uint8_t header[OTLP_REQUEST_HEADER_MAX];
+  size_t header_size;
+  size_t scope_header_size;
+  size_t body_size =
+      otlp_encode_request_header(&exporter->prefix, spans_size, header, &header_size, &scope_header_size);
+  char http[512];
+  int ipv6 = strchr(exporter->host, ':') != NULL;
+  int http_size = snprintf(http, sizeof(http),
+                           "POST %s HTTP/1.1\r\nHost: %s%s%s:%s\r\nContent-Type: application/x-protobuf\r\n"
+                           "Content-Length: %zu\r\n\r\n",
+                           exporter->path, ipv6 ? "[" : "", exporter->host, ipv6 ? "]" : "", exporter->port, body_size);
+  if (http_size < 0 || (size_t)http_size >= sizeof(http)) {
+    return -1;
+  }
+
+  struct iovec iov[OTLP_LANES + 5];
+  for (int attempt = 0; attempt < 2; attempt++) {
+    int reused = exporter->socket >= 0;
+    if (!reused) {
+      // While the collector is unreachable, drop batches rather than retry for each of them.
+      int64_t now = now_ns(CLOCK_MONOTONIC);
+      if (now < exporter->retry_time) {
+        return -1;
+      }
+      if (connect_to_collector(exporter) != 0) {
+        exporter->retry_time = now + exporter->schedule_delay_ms * 1000000LL;
+        return -1;
+      }
+    }
+    int n = 0;
+    iov[n++] = (struct iovec){http, (size_t)http_size};
+    iov[n++] = (struct iovec){header, header_size};
+    iov[n++] = (struct iovec){exporter->prefix.resource.data, exporter->prefix.resource.size};
+    iov[n++] = (struct iovec){header + header_size, scope_header_size};
+    iov[n++] = (struct iovec){exporter->prefix.scope.data, exporter->prefix.scope.size};
+    for (int i = 0; i < count; i++) {
+      iov[n++] = (struct iovec){parts[i]->data, parts[i]->size};
+    }
+    int keep_alive = 1;
+    int status = send_all(exporter->socket, iov, n) == 0 ? read_response(exporter->socket, &keep_alive) : -1;
+    if (status < 0) {
+      close_connection(exporter);
+      if (reused) {
+        // The collector may have closed an idle connection; retry once on a new one.
+        continue;
+      }
+      return -1;
+    }
+    if (!keep_alive) {
+      close_connection(exporter);
+    }
+    return (status >= 200 && status < 300) ? 0 : -1;
+  }
+  return -1;
+}
+
+/**
+ * @brief Take the pending spans out of the lanes and post them.
+ *
+ * @return 0 if every request was accepted
+ */
+static int export_pending(otlp_exporter_t* exporter) {
+  int result = 0;
+  otlp_buffer_t* parts[OTLP_LANES];
+  int count = 0;
+  size_t spans_size = 0;
+  for (int i = 0; i < OTLP_LANES; i++) {
+    otlp_lane_t* lane = &exporter->lanes[i];
+    if (__atomic_load_n(&lane->spans.size, __ATOMIC_RELAXED) == 0) {
+      continue;
+    }
+    // Swap the lane's buffer with an empty one, so that workers append while this one is sent.
+    otlp_buffer_t* sending = &exporter->sending[i];
+    sending->size = 0;
+    lock_lane(lane);
+    otlp_buffer_t pending = lane->spans;
+    int64_t taken = lane->count;
+    lane->spans = *sending;
+    lane->count = 0;
+    unlock_lane(lane);
+    *sending = pending;
+    __atomic_fetch_sub(&exporter->queued, taken, __ATOMIC_RELAXED);
+    if (sending->failed) {
+      // Spans after the failed allocation were lost, but the ones before are complete.
+      sending->failed = 0;
+    }
+    if (count > 0 && spans_size + sending->size > OTLP_REQUEST_MAX) {
+      result |= post_request(exporter, parts, count, spans_size);
+      count = 0;
+      spans_size = 0;
+    }
+    parts[count++] = sending;
+    spans_size += sending->size;
+  }
+  if (count > 0) {
+    result |= post_request(exporter, parts, count, spans_size);
+  }
+  if (result != 0 && !exporter->warned) {
+    exporter->warned = 1;
+    fprintf(stderr, "WARNING: Failed to export spans to http://%s:%s%s\n", exporter->host, exporter->port,
+            exporter->path);
+  }
+  return result;
+}
+
+static void* export_thread(void* arg) {
+  otlp_exporter_t* exporter = (otlp_exporter_t*)arg;
+  pthread_mutex_lock(&exporter->mutex);
+  while (!exporter->stopping) {
+    if (exporter->flush_requested == exporter->flush_completed &&
+        __atomic_load_n(&exporter->queued, __ATOMIC_RELAXED) < exporter->max_export_batch_size) {
+      int64_t deadline = now_ns(CLOCK_MONOTONIC) + exporter->schedule_delay_ms * 1000000LL;
+      struct timespec ts = {.tv_sec = deadline / 1000000000LL, .tv_nsec = deadline % 1000000000LL};
+      pthread_cond_timedwait(&exporter->wake, &exporter->mutex, &ts);
+    }
+    uint64_t request = exporter->flush_requested;
+    pthread_mutex_unlock(&exporter->mutex);
+    int result = export_pending(exporter);
+    pthread_mutex_lock(&exporter->mutex);
+    exporter->flush_completed = request;
+    exporter->last_result = result;
+    pthread_cond_broadcast(&exporter->done);
+  }
+  pthread_mutex_unlock(&exporter->mutex);
+  // Spans ended since the last flush, e.g. by a reconfiguration that replaced this exporter.
+  export_pending(exporter);
+  return NULL;
+}
+
+/** @brief Move an ended span into its lane and free it. */
+static void finish_span(otlp_exporter_t* exporter, otlp_span_t* span, int64_t end_time) {
+  otlp_encode_end_time(&span->varying, (uint64_t)end_time);
+  if (span->varying.failed || span->constant->failed) {
+    __atomic_fetch_add(&exporter->dropped, 1, __ATOMIC_RELAXED);
+  } else if (__atomic_add_fetch(&exporter->queued, 1, __ATOMIC_RELAXED) > exporter->max_queue_size) {
+    // Like the SDK's batch processor, drop spans rather than block when the queue is full.
+    __atomic_fetch_sub(&exporter->queued, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&exporter->dropped, 1, __ATOMIC_RELAXED);
+  } else {
+    otlp_lane_t* lane = &exporter->lanes[span->lane];
+    lock_lane(lane);
+    otlp_encode_span(&lane->spans, span->constant, &span->varying);
+    lane->count++;
+    unlock_lane(lane);
+    if (__atomic_load_n(&exporter->queued, __ATOMIC_RELAXED) == exporter->max_export_batch_size) {
+      pthread_cond_signal(&exporter->wake);
+    }
+  }
+  otlp_buffer_free(&span->varying);
+  otlp_buffer_free(&span->own_constant);
+  free(span);
+}
+
+static otlp_span_t* new_span(int worker, int64_t start_time) {
+  otlp_span_t* span = malloc(sizeof(otlp_span_t));
+  if (!span) {
+    return NULL;
+  }
+  span->start_time = start_time;
+  span->started = now_ns(CLOCK_MONOTONIC);
+  otlp_buffer_init(&span->own_constant, NULL, 0);
+  otlp_buffer_init(&span->varying, span->storage, sizeof(span->storage));
+  span->constant = &span->own_constant;
+  span->lane = (int)((unsigned)(worker + 1) % OTLP_LANES);
+  encode_new_ids(&span->varying);
+  otlp_encode_start_time(&span->varying, (uint64_t)start_time);
+  return span;
+}
+
+/**
+ * @brief The end of a span ended now.
+ *
+ * The start comes from the trace record, whose clock is the runtime's, so the end is
+ * derived from the time elapsed since the start rather than read from another clock.
+ */
+static int64_t end_time_now(const otlp_span_t* span) {
+  return span->start_time + (now_ns(CLOCK_MONOTONIC) - span->started);
+}
+
+static void encode_reaction_constant(otlp_buffer_t* out, const char* span_name, const char* reaction_fqn,
+                                     int reaction_number, const char* reactor_fqn) {
+  char name[32];
+  snprintf(name, sizeof(name), "%d", reaction_number);
+  otlp_encode_span_constant(out, span_name, "reaction", reaction_fqn, name, reactor_fqn);
+}
+
+/**
+ * @brief Get the constant fields of a reaction's spans, encoding them on its first span.
+ *
+ * @return The template, or NULL if the reaction has no cacheable ID
+ */
+static const otlp_span_constant_t* reaction_template(otlp_exporter_t* exporter, int reaction, const char* span_name,
+                                                     const char* reaction_fqn, int reaction_number,
+                                                     const char* reactor_fqn) {
+  if (reaction < 0 || reaction >= OTLP_TEMPLATE_SLOTS) {
+    return NULL;
+  }
+  otlp_span_constant_t* cached = __atomic_load_n(&exporter->templates[reaction], __ATOMIC_ACQUIRE);
+  if (cached) {
+    return cached;
+  }
+  otlp_span_constant_t* created = malloc(sizeof(otlp_span_constant_t));
+  if (!created) {
+    return NULL;
+  }
+  otlp_buffer_init(created, NULL, 0);
+  encode_reaction_constant(created, span_name, reaction_fqn, reaction_number, reactor_fqn);
+  if (created->failed) {
+    otlp_buffer_free(created);
+    free(created);
+    return NULL;
+  }
+  // Two workers may run the reaction for the first time at once; the first template wins.
+  if (!__atomic_compare_exchange_n(&exporter->templates[reaction], &cached, created, 0, __ATOMIC_ACQ_REL,
+                                   __ATOMIC_ACQUIRE)) {
+    otlp_buffer_free(created);
+    free(created);
+    return cached;
+  }
+  return created;
+}
+
+static void encode_record_fields(otlp_buffer_t* out, int worker, const trace_record_nodeps_t* tr) {
+  otlp_encode_int_attribute(out, "xronos.worker", worker);
+  otlp_encode_int_attribute(out, "xronos.timestamp", tr->logical_time);
+  otlp_encode_int_attribute(out, "xronos.microstep", (uint32_t)tr->microstep);
+  otlp_encode_int_attribute(out, "xronos.lag", tr->physical_time - tr->logical_time);
+}
+
+static void encode_trigger_fields(otlp_buffer_t* out, const otel_trigger_info_t* trigger) {
+  if (!trigger) {
+    return;
+  }
+  if (trigger->trigger_fqn) {
+    otlp_encode_string_attribute(out, "xronos.trigger_fqn", trigger->trigger_fqn, strlen(trigger->trigger_fqn));
+  }
+  if (trigger->source_fqn) {
+    otlp_encode_string_attribute(out, "xronos.source_fqn", trigger->source_fqn, strlen(trigger->source_fqn));
+  }
+  if (trigger->latency >= 0) {
+    otlp_encode_int_attribute(out, "xronos.trigger.timestamp", trigger->timestamp);
+    otlp_encode_int_attribute(out, "xronos.trigger.microstep", (uint32_t)trigger->microstep);
+    otlp_encode_int_attribute(out, "xronos.trigger.latency", trigger->latency);
+  }
+}
+
+// IMPLEMENTATION OF OTLP EXPORTER API ***************************************
+
+static void otlp_exporter_destroy(otel_backend_t* backend);
+
+static otel_backend_t* otlp_exporter_create(const char* endpoint, const char* application_name,
+                                            const char* hostname, int64_t pid) {
+  otlp_exporter_t* exporter = calloc(1, sizeof(otlp_exporter_t));
+  if (!exporter) {
+    return NULL;
+  }
+  exporter->socket = -1;
+  exporter->base.endpoint = endpoint ? strdup(endpoint) : NULL;
+  exporter->base.application_name = application_name ? strdup(application_name) : NULL;
+  exporter->base.hostname = hostname ? strdup(hostname) : NULL;
+  exporter->base.pid = pid;
+  if ((endpoint && !exporter->base.endpoint) || (application_name && !exporter->base.application_name) ||
+      (hostname && !exporter->base.hostname)) {
+    otlp_exporter_destroy(&exporter->base);
+    return NULL;
+  }
+  return &exporter->base;
+}
+
+static void otlp_exporter_set_batch_settings(otel_backend_t* backend, const otel_batch_settings_t* batch) {
+  otlp_exporter_t* exporter = (otlp_exporter_t*)backend;
+  exporter->schedule_delay_ms = batch->schedule_delay_ms;
+  exporter->max_queue_size = batch->max_queue_size;
+  exporter->max_export_batch_size = batch->max_export_batch_size;
+}
+
+static int otlp_exporter_initialize(otel_backend_t* backend) {
+  otlp_exporter_t* exporter = (otlp_exporter_t*)backend;
+  if (!backend || backend->initialized || !backend->endpoint || parse_endpoint(exporter, backend->endpoint) != 0) {
+    return -1;
+  }
+  if (otlp_request_prefix_init(&exporter->prefix,
+                               backend->application_name ? backend->application_name : "unknown-service",
+                               backend->hostname ? backend->hostname : "unknown-host", "lf-trace-xronos") != 0) {
+    return -1;
+  }
+  // Settings given by set_batch_settings (the batch command) take precedence over the environment.
+  if (exporter->schedule_delay_ms <= 0) {
+    exporter->schedule_delay_ms = env_positive("OTEL_BSP_SCHEDULE_DELAY", OTLP_SCHEDULE_DELAY_DEFAULT_MS);
+  }
+  if (exporter->max_queue_size <= 0) {
+    exporter->max_queue_size = env_positive("OTEL_BSP_MAX_QUEUE_SIZE", OTLP_MAX_QUEUE_SIZE_DEFAULT);
+  }
+  if (exporter->max_export_batch_size <= 0) {
+    exporter->max_export_batch_size =
+        env_positive("OTEL_BSP_MAX_EXPORT_BATCH_SIZE", OTLP_MAX_EXPORT_BATCH_SIZE_DEFAULT);
+  }
+  exporter->timeout_ms = env_positive("OTEL_EXPORTER_OTLP_TIMEOUT", OTLP_TIMEOUT_DEFAULT_MS);
+
+  pthread_condattr_t attributes;
+  pthread_condattr_init(&attributes);
+  pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+  pthread_mutex_init(&exporter->mutex, NULL);
+  pthread_cond_init(&exporter->wake, &attributes);
+  pthread_cond_init(&exporter->done, &attributes);
+  pthread_condattr_destroy(&attributes);
+  if (pthread_create(&exporter->thread, NULL, export_thread, exporter) != 0) {
+    return -1;
+  }
+  exporter->thread_running = 1;
+  // Not a tracer, but the plugin and otel_backend.c only test that it is set.
+  backend->tracer = exporter;
+  backend->initialized = 1;
+  return 0;
+}
+
+static void otlp_exporter_destroy(otel_backend_t* backend) {
+  otlp_exporter_t* exporter = (otlp_exporter_t*)backend;
+  if (!exporter) {
+    return;
+  }
+  if (exporter->thread_running) {
+    pthread_mutex_lock(&exporter->mutex);
+    exporter->stopping = 1;
+    pthread_cond_signal(&exporter->wake);
+    pthread_mutex_unlock(&exporter->mutex);
+    pthread_join(exporter->thread, NULL);
+  }
+  if (backend->initialized) {
+    pthread_mutex_destroy(&exporter->mutex);
+    pthread_cond_destroy(&exporter->wake);
+    pthread_cond_destroy(&exporter->done);
+  }
+  uint64_t dropped = __atomic_load_n(&exporter->dropped, __ATOMIC_RELAXED);
+  if (dropped > 0) {
+    fprintf(stderr, "WARNING: The otlp-http exporter dropped %llu spans because its queue was full.\n",
+            (unsigned long long)dropped);
+  }
+  close_connection(exporter);
+  for (int i = 0; i < OTLP_TEMPLATE_SLOTS; i++) {
+    if (exporter->templates[i]) {
+      otlp_buffer_free(exporter->templates[i]);
+      free(exporter->templates[i]);
+    }
+  }
+  for (int i = 0; i < OTLP_LANES; i++) {
+    otlp_buffer_free(&exporter->lanes[i].spans);
+    otlp_buffer_free(&exporter->sending[i]);
+  }
+  otlp_request_prefix_free(&exporter->prefix);
+  free(exporter->host);
+  free(exporter->port);
+  free(exporter->path);
+  free(backend->endpoint);
+  free(backend->application_name);
+  free(backend->hostname);
+  free(exporter);
+}
+
+static void* otlp_exporter_start_reaction_span(otel_backend_t* backend, int worker, int reaction,
+                                               const char* span_name, const char* reaction_fqn, int reaction_number,
+                                               const char* reactor_fqn, const trace_record_nodeps_t* tr,
+                                               const otel_trigger_info_t* trigger) {
+  otlp_exporter_t* exporter = (otlp_exporter_t*)backend;
+  if (!backend || !backend->initialized) {
+    return NULL;
+  }
+  otlp_span_t* span = new_span(worker, tr->physical_time);
+  if (!span) {
+    return NULL;
+  }
+  const otlp_span_constant_t* constant =
+      reaction_fqn ? reaction_template(exporter, reaction, span_name, reaction_fqn, reaction_number, reactor_fqn)
+                   : NULL;
+  if (constant) {
+    span->constant = constant;
+  } else {
+    encode_reaction_constant(&span->own_constant, span_name, reaction_fqn, reaction_number, reactor_fqn);
+  }
+  encode_record_fields(&span->varying, worker, tr);
+  encode_trigger_fields(&span->varying, trigger);
+  return span;
+}
+
+static void otlp_exporter_end_span(otel_backend_t* backend, void* span) {
+  if (span) {
+    finish_span((otlp_exporter_t*)backend, (otlp_span_t*)span, end_time_now((otlp_span_t*)span));
+  }
+}
+
+static void otlp_exporter_end_incomplete_span(otel_backend_t* backend, void* span) {
+  if (span) {
+    otlp_encode_int_attribute(&((otlp_span_t*)span)->varying, "xronos.incomplete", 1);
+    finish_span((otlp_exporter_t*)backend, (otlp_span_t*)span, end_time_now((otlp_span_t*)span));
+  }
+}
+
+static int otlp_exporter_flush(otel_backend_t* backend, int64_t timeout) {
+  otlp_exporter_t* exporter = (otlp_exporter_t*)backend;
+  if (!backend || !backend->initialized) {
+    return 0;
+  }
+  int64_t deadline = now_ns(CLOCK_MONOTONIC) + timeout;
+  struct timespec ts = {.tv_sec = deadline / 1000000000LL, .tv_nsec = deadline % 1000000000LL};
+  pthread_mutex_lock(&exporter->mutex);
+  uint64_t request = ++exporter->flush_requested;
+  pthread_cond_signal(&exporter->wake);
+  int result = 0;
+  while (exporter->flush_completed < request && result == 0) {
+    result = pthread_cond_timedwait(&exporter->done, &exporter->mutex, &ts);
+  }
+  int flushed = exporter->flush_completed >= request && exporter->last_result == 0;
+  pthread_mutex_unlock(&exporter->mutex);
+  return flushed ? 0 : -1;
+}
+
+static void otlp_exporter_emit_event_span(otel_backend_t* backend, int worker, const char* event_name,
+                                          const trace_record_nodeps_t* tr, const otel_trigger_info_t* trigger) {
+  if (!backend || !backend->initialized) {
+    return;
+  }
+  otlp_span_t* span = new_span(worker, tr->physical_time);
+  if (!span) {
+    return;
+  }
+  otlp_encode_span_constant(&span->own_constant, event_name, "trace_event", NULL, NULL, NULL);
+  encode_record_fields(&span->varying, worker, tr);
+  encode_trigger_fields(&span->varying, trigger);
+  finish_span((otlp_exporter_t*)backend, span, tr->physical_time);
+}
+
+static void otlp_exporter_emit_recorded_span(otel_backend_t* backend, int worker, int reaction,
+                                             const char* span_name, const char* reaction_fqn, int reaction_number,
+                                             const char* reactor_fqn, const trace_record_nodeps_t* tr,
+                                             int64_t end_physical_time) {
+  otlp_span_t* span = otlp_exporter_start_reaction_span(backend, worker, reaction, span_name, reaction_fqn,
+                                                        reaction_number, reactor_fqn, tr, NULL);
+  if (!span) {
+    return;
+  }
+  // Unlike with the SDK, the span itself covers the recorded execution; the attributes are kept for queries.
+  otlp_encode_int_attribute(&span->varying, "xronos.physical_time", tr->physical_time);
+  int64_t end_time = tr->physical_time;
+  if (end_physical_time >= tr->physical_time) {
+    otlp_encode_int_attribute(&span->varying, "xronos.duration", end_physical_time - tr->physical_time);
+    end_time = end_physical_time;
+  }
+  finish_span((otlp_exporter_t*)backend, span, end_time);
+}
+
+static void* otlp_exporter_start_worker_span(otel_backend_t* backend, int worker) {
+  if (!backend || !backend->initialized) {
+    return NULL;
+  }
+  otlp_span_t* span = new_span(worker, now_ns(CLOCK_REALTIME));
+  if (!span) {
+    return NULL;
+  }
+  char span_name[32];
+  snprintf(span_name, sizeof(span_name), "worker %d", worker);
+  otlp_encode_span_constant(&span->own_constant, span_name, "worker", NULL, NULL, NULL);
+  otlp_encode_int_attribute(&span->varying, "xronos.worker", worker);
+  return span;
+}
+
+static void otlp_exporter_end_worker_span(otel_backend_t* backend, void* span, int64_t reactions,
+                                          int64_t busy_time) {
+  if (!span) {
+    return;
+  }
+  otlp_encode_int_attribute(&((otlp_span_t*)span)->varying, "xronos.reactions", reactions);
+  otlp_encode_int_attribute(&((otlp_span_t*)span)->varying, "xronos.busy_time", busy_time);
+  finish_span((otlp_exporter_t*)backend, (otlp_span_t*)span, end_time_now((otlp_span_t*)span));
+}
+
+static void otlp_exporter_emit_critical_path_span(otel_backend_t* backend, const otel_critical_path_t* path) {
+  if (!backend || !backend->initialized) {
+    return;
+  }
+  // The span covers the tag, from its logical time to the end of its last reaction.
+  otlp_span_t* span = new_span(-1, path->timestamp);
+  if (!span) {
+    return;
+  }
+  otlp_encode_span_constant(&span->own_constant, "critical path", "tag", NULL, NULL, NULL);
+  otlp_encode_int_attribute(&span->varying, "xronos.timestamp", path->timestamp);
+  otlp_encode_int_attribute(&span->varying, "xronos.microstep", (uint32_t)path->microstep);
+  otlp_encode_int_attribute(&span->varying, "xronos.reactions", path->reactions);
+  otlp_encode_string_attribute(&span->varying, "xronos.critical_path", path->path, strlen(path->path));
+  otlp_encode_int_attribute(&span->varying, "xronos.critical_path.length", path->length);
+  otlp_encode_int_attribute(&span->varying, "xronos.critical_path.latency", path->latency);
+  otlp_encode_int_attribute(&span->varying, "xronos.critical_path.busy_time", path->busy_time);
+  otlp_encode_int_attribute(&span->varying, "xronos.critical_path.wait_time", path->latency - path->busy_time);
+  if (path->slack >= 0) {
+    otlp_encode_int_attribute(&span->varying, "xronos.critical_path.slack", path->slack);
+  }
+  if (path->bottleneck_fqn) {
+    otlp_encode_string_attribute(&span->varying, "xronos.critical_path.bottleneck", path->bottleneck_fqn,
+                                 strlen(path->bottleneck_fqn));
+  }
+  finish_span((otlp_exporter_t*)backend, span, path->end_time);
+}
+
+static void otlp_exporter_emit_reaction_summary_span(otel_backend_t* backend, int reaction, const char* reaction_fqn,
+                                                     int reaction_number, const char* reactor_fqn,
+                                                     const otel_reaction_summary_t* summary) {
+  (void)reaction;
+  if (!backend || !backend->initialized) {
+    return;
+  }
+  // The span covers the interval, from the start of its first execution to the end of its last.
+  otlp_span_t* span = new_span(-1, summary->start_time);
+  if (!span) {
+    return;
+  }
+  encode_reaction_constant(&span->own_constant, "reaction summary", reaction_fqn, reaction_number, reactor_fqn);
+  otlp_buffer_t* out = &span->varying;
+  otlp_encode_int_attribute(out, "xronos.summary.executions", summary->executions);
+  otlp_encode_int_attribute(out, "xronos.summary.outliers", summary->outliers);
+  otlp_encode_int_attribute(out, "xronos.summary.duration.total", summary->total_duration);
+  otlp_encode_int_attribute(out, "xronos.summary.duration.max", summary->max_duration);
+  otlp_encode_int_attribute(out, "xronos.summary.duration.mean", summary->duration_mean);
+  otlp_encode_int_attribute(out, "xronos.summary.duration.stddev", summary->duration_stddev);
+  otlp_encode_int_attribute(out, "xronos.summary.lag.mean", summary->lag_mean);
+  otlp_encode_int_attribute(out, "xronos.summary.lag.stddev", summary->lag_stddev);
+  finish_span((otlp_exporter_t*)backend, span, summary->end_time);
+}
+
+const otel_backend_ops_t otlp_exporter_ops = {
+    .create = otlp_exporter_create,
+    .initialize = otlp_exporter_initialize,
+    .set_batch_settings = otlp_exporter_set_batch_settings,
+    .destroy = otlp_exporter_destroy,
+    .start_reaction_span = otlp_exporter_start_reaction_span,
+    .end_span = otlp_exporter_end_span,
+    .emit_event_span = otlp_exporter_emit_event_span,
+    .emit_recorded_span = otlp_exporter_emit_recorded_span,
+    .start_worker_span = otlp_exporter_start_worker_span,
+    .end_worker_span = otlp_exporter_end_worker_span,
+    .end_incomplete_span = otlp_exporter_end_incomplete_span,
+    .flush = otlp_exporter_flush,
+    .emit_critical_path_span = otlp_exporter_emit_critical_path_span,
+    .emit_reaction_summary_span = otlp_exporter_emit_reaction_summary_span,
+};
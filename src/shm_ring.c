@@ -0,0 +1,144 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file shm_ring.c
+ * @brief Shared-memory ring sink for trace records
+ *
+ * Keeps the most recent records of every worker in a POSIX shared-memory segment
+ * (see shm_ring.h for the layout). Recording is a copy into the ring of the calling
+ * worker followed by a release store of its head, so an external process can attach
+ * to a running program, or inspect the segment after it exits, without any I/O on
+ * the traced side.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "shm_ring.h"
+#include "trace_alloc.h"
+#include "trace_impl.h"
+
+#define SHM_RING_ALIGN(x) (((x) + 63u) & ~(uint64_t)63u)
+
+// PRIVATE DATA STRUCTURES ***************************************************
+
+static shm_ring_header_t* header;
+static size_t segment_size;
+static uint64_t ring_mask;
+static size_t strings_used;
+
+// PRIVATE HELPERS ***********************************************************
+
+static shm_ring_t* ring_at(int buffer) {
+  return (shm_ring_t*)((char*)header + header->rings_offset + (uint64_t)(buffer + 1) * header->ring_stride);
+}
+
+// IMPLEMENTATION OF SHM RING API ********************************************
+
+int shm_ring_open(const char* name, int num_buffers, uint64_t ring_capacity) {
+  if (!name || num_buffers < 0 || ring_capacity == 0) {
+    return -1;
+  }
+  uint64_t capacity = 1;
+  while (capacity < ring_capacity) {
+    capacity <<= 1;
+  }
+
+  uint64_t descriptions_offset = SHM_RING_ALIGN(sizeof(shm_ring_header_t));
+  uint64_t strings_offset =
+      SHM_RING_ALIGN(descriptions_offset + TRACE_OBJECT_TABLE_SIZE * sizeof(shm_ring_description_t));
+  uint64_t rings_offset = SHM_RING_ALIGN(strings_offset + SHM_RING_STRING_POOL_SIZE);
+  uint64_t ring_stride = SHM_RING_ALIGN(sizeof(shm_ring_t) + capacity * sizeof(trace_record_nodeps_t));
+  uint64_t size = rings_offset + (uint64_t)(num_buffers + 1) * ring_stride;
+
+  shm_unlink(name);
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "WARNING: Failed to create shared memory %s: %s\n", name, strerror(errno));
+    return -1;
+  }
+  if (ftruncate(fd, (off_t)size) != 0) {
+    fprintf(stderr, "WARNING: Failed to size shared memory %s: %s\n", name, strerror(errno));
+    close(fd);
+    shm_unlink(name);
+    return -1;
+  }
+  void* mapping = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    fprintf(stderr, "WARNING: Failed to map shared memory %s: %s\n", name, strerror(errno));
+    shm_unlink(name);
+    return -1;
+  }
+  // The rings are swept continuously; fewer, larger pages save TLB misses (LF_TRACE_HUGE_PAGES).
+  trace_alloc_advise(mapping, (size_t)size);
+
+  // ftruncate zero-fills the segment, so all heads and counts start at zero.
+  header = (shm_ring_header_t*)mapping;
+  segment_size = (size_t)size;
+  ring_mask = capacity - 1;
+  strings_used = 0;
+  header->record_size = sizeof(trace_record_nodeps_t);
+  header->num_rings = (uint32_t)num_buffers + 1;
+  header->ring_capacity = capacity;
+  header->ring_stride = ring_stride;
+  header->descriptions_offset = descriptions_offset;
+  header->strings_offset = strings_offset;
+  header->rings_offset = rings_offset;
+  header->max_descriptions = TRACE_OBJECT_TABLE_SIZE;
+  header->version = SHM_RING_VERSION;
+  // Readers check the magic number last.
+  __atomic_store_n(&header->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+  return 0;
+}
+
+void shm_ring_register(const object_description_t* description) {
+  if (!header || header->num_descriptions >= header->max_descriptions) {
+    return;
+  }
+  const char* text = description->description ? description->description : "";
+  size_t length = strlen(text) + 1;
+  if (strings_used + length > SHM_RING_STRING_POOL_SIZE) {
+    return;
+  }
+  memcpy((char*)header + header->strings_offset + strings_used, text, length);
+
+  shm_ring_description_t* entry =
+      (shm_ring_description_t*)((char*)header + header->descriptions_offset) + header->num_descriptions;
+  entry->pointer = (uint64_t)(uintptr_t)description->pointer;
+  entry->trigger = (uint64_t)(uintptr_t)description->trigger;
+  entry->type = (int32_t)description->type;
+  entry->string_offset = (uint32_t)strings_used;
+  strings_used += length;
+  __atomic_store_n(&header->num_descriptions, header->num_descriptions + 1, __ATOMIC_RELEASE);
+}
+
+void shm_ring_set_start_time(int64_t start_time) {
+  if (header) {
+    header->start_time = start_time;
+  }
+}
+
+void shm_ring_record(int buffer, const trace_record_nodeps_t* tr) {
+  if (!header || buffer + 1 >= (int)header->num_rings) {
+    return;
+  }
+  shm_ring_t* ring = ring_at(buffer);
+  uint64_t head = ring->head;
+  trace_record_nodeps_t* slots = (trace_record_nodeps_t*)(ring + 1);
+  slots[head & ring_mask] = *tr;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void shm_ring_close(void) {
+  if (header) {
+    munmap(header, segment_size);
+    header = NULL;
+  }
+}
@@ -0,0 +1,126 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file string_arena.c
+ * @brief Append-only arena of interned strings
+ *
+ * Strings are copied into chunks that are never moved or freed before string_arena_free(),
+ * each preceded by its length and hash. A hash set of the interned strings, used only when
+ * interning, deduplicates them; lookups by the plugin go through the returned pointers.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "string_arena.h"
+
+// PRIVATE DATA STRUCTURES ***************************************************
+
+typedef struct string_arena_chunk {
+  struct string_arena_chunk* next;
+  size_t used;
+  size_t capacity;
+  char data[];  // 8-byte aligned, like the chunk itself
+} string_arena_chunk_t;
+
+static string_arena_chunk_t* chunks;  // Newest first
+static const char** interned_set;     // Open addressing; NULL marks an empty slot
+static size_t set_capacity;           // Power of two
+static size_t set_count;
+
+// PRIVATE HELPERS ***********************************************************
+
+/** @brief FNV-1a, which is enough for the few hundred names of a program. */
+static uint32_t hash_string(const char* text, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/** @brief Double the hash set (or create it), keeping its load below one half. */
+static int grow_set(void) {
+  size_t capacity = set_capacity ? set_capacity * 2 : 256;
+  const char** set = (const char**)calloc(capacity, sizeof(const char*));
+  if (!set) {
+    return -1;
+  }
+  for (size_t i = 0; i < set_capacity; i++) {
+    if (interned_set[i]) {
+      size_t slot = string_arena_hash(interned_set[i]) & (capacity - 1);
+      while (set[slot]) {
+        slot = (slot + 1) & (capacity - 1);
+      }
+      set[slot] = interned_set[i];
+    }
+  }
+  free(interned_set);
+  interned_set = set;
+  set_capacity = capacity;
+  return 0;
+}
+
+/** @brief Copy a string with its header into the current chunk, starting a new chunk if needed. */
+static const char* append(const char* text, size_t length, uint32_t hash) {
+  size_t size = (sizeof(string_arena_header_t) + length + 1 + 7) & ~(size_t)7;
+  if (!chunks || chunks->capacity - chunks->used < size) {
+    size_t capacity = size > STRING_ARENA_CHUNK_SIZE ? size : STRING_ARENA_CHUNK_SIZE;
+    string_arena_chunk_t* chunk = (string_arena_chunk_t*)malloc(sizeof(string_arena_chunk_t) + capacity);
+    if (!chunk) {
+      return NULL;
+    }
+    chunk->used = 0;
+    chunk->capacity = capacity;
+    chunk->next = chunks;
+    chunks = chunk;
+  }
+  string_arena_header_t* header = (string_arena_header_t*)(chunks->data + chunks->used);
+  header->length = (uint32_t)length;
+  header->hash = hash;
+  char* characters = (char*)(header + 1);
+  memcpy(characters, text, length);
+  characters[length] = '\0';
+  chunks->used += size;
+  return characters;
+}
+
+// IMPLEMENTATION OF STRING ARENA API ****************************************
+
+const char* string_arena_intern(const char* text) {
+  if (!text) {
+    return NULL;
+  }
+  if (2 * (set_count + 1) > set_capacity && grow_set() != 0) {
+    return NULL;
+  }
+  size_t length = strlen(text);
+  uint32_t hash = hash_string(text, length);
+  size_t slot = hash & (set_capacity - 1);
+  for (; interned_set[slot]; slot = (slot + 1) & (set_capacity - 1)) {
+    const char* candidate = interned_set[slot];
+    if (string_arena_hash(candidate) == hash && string_arena_length(candidate) == length &&
+        memcmp(candidate, text, length) == 0) {
+      return candidate;
+    }
+  }
+  const char* interned = append(text, length, hash);
+  if (interned) {
+    interned_set[slot] = interned;
+    set_count++;
+  }
+  return interned;
+}
+
+void string_arena_free(void) {
+  while (chunks) {
+    string_arena_chunk_t* next = chunks->next;
+    free(chunks);
+    chunks = next;
+  }
+  free(interned_set);
+  interned_set = NULL;
+  set_capacity = 0;
+  set_count = 0;
+}
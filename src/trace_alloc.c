@@ -0,0 +1,142 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file trace_alloc.c
+ * @brief Huge-page and NUMA-aware allocation of large trace buffers
+ *
+ * Large rings are mapped directly rather than taken from malloc, so that they can be
+ * backed by huge pages (fewer TLB misses when a worker sweeps through tens of MB) and
+ * given a memory policy. The policy prefers the node of the allocating thread; since
+ * every ring is allocated by its owning worker, the ring lives next to the worker even
+ * if the kernel would not otherwise place first-touched pages there (e.g. under a
+ * process-wide interleave policy). libnuma is not needed: mbind(2) and getcpu(2) are
+ * called directly, and everything degrades to plain anonymous mappings where they, or
+ * huge pages, are not available.
+ */
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "trace_alloc.h"
+
+/** mbind(2) mode that prefers a node but falls back to others (linux/mempolicy.h). */
+#define TRACE_ALLOC_MPOL_PREFERRED 1
+
+// PRIVATE DATA STRUCTURES ***************************************************
+
+static trace_alloc_huge_pages_t huge_pages = TRACE_ALLOC_HUGE_PAGES_AUTO;
+static int hugetlb_failed = 0;  // Set once MAP_HUGETLB fails, so that later allocations skip it
+static trace_alloc_stats_t stats;
+
+// PRIVATE HELPERS ***********************************************************
+
+static void count(uint64_t* counter, uint64_t bytes) { __atomic_fetch_add(counter, bytes, __ATOMIC_RELAXED); }
+
+/** @brief Bind a mapping to the node of the calling thread, if the kernel supports it. */
+static int bind_to_local_node(void* memory, size_t size) {
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_getcpu)
+  unsigned cpu;
+  unsigned node;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0 || node >= 8 * sizeof(unsigned long) * 16) {
+    return -1;
+  }
+  unsigned long nodemask[16] = {0};
+  nodemask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+  // Before the first touch, so no pages need to be moved.
+  if (syscall(SYS_mbind, memory, size, TRACE_ALLOC_MPOL_PREFERRED, nodemask, 8 * sizeof(nodemask), 0) != 0) {
+    return -1;
+  }
+  return 0;
+#else
+  (void)memory;
+  (void)size;
+  return -1;
+#endif
+}
+
+/** @brief Advise transparent huge pages and count the bytes by the outcome. */
+static void advise(void* memory, size_t size) {
+#ifdef MADV_HUGEPAGE
+  if (huge_pages != TRACE_ALLOC_HUGE_PAGES_OFF && size >= TRACE_ALLOC_HUGE_PAGE_SIZE &&
+      madvise(memory, size, MADV_HUGEPAGE) == 0) {
+    count(&stats.thp_bytes, size);
+    return;
+  }
+#else
+  (void)memory;
+#endif
+  count(&stats.small_page_bytes, size);
+}
+
+// IMPLEMENTATION OF TRACE ALLOC API *****************************************
+
+int trace_alloc_configure(const char* value) {
+  if (!value || value[0] == '\0' || strcmp(value, "1") == 0) {
+    huge_pages = TRACE_ALLOC_HUGE_PAGES_AUTO;
+  } else if (strcmp(value, "thp") == 0) {
+    huge_pages = TRACE_ALLOC_HUGE_PAGES_THP;
+  } else if (strcmp(value, "0") == 0) {
+    huge_pages = TRACE_ALLOC_HUGE_PAGES_OFF;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+void* trace_alloc(size_t size, size_t* mapped) {
+  if (size == 0) {
+    return NULL;
+  }
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  void* memory = MAP_FAILED;
+  size_t length = (size + page - 1) & ~(page - 1);
+#ifdef MAP_HUGETLB
+  if (huge_pages == TRACE_ALLOC_HUGE_PAGES_AUTO && size >= TRACE_ALLOC_HUGE_PAGE_SIZE &&
+      !__atomic_load_n(&hugetlb_failed, __ATOMIC_RELAXED)) {
+    // Reserved huge pages must be configured (vm.nr_hugepages); without them this fails at once.
+    size_t huge_length = (size + TRACE_ALLOC_HUGE_PAGE_SIZE - 1) & ~(TRACE_ALLOC_HUGE_PAGE_SIZE - 1);
+    memory = mmap(NULL, huge_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED) {
+      length = huge_length;
+      count(&stats.hugetlb_bytes, length);
+    } else {
+      __atomic_store_n(&hugetlb_failed, 1, __ATOMIC_RELAXED);
+    }
+  }
+#endif
+  if (memory == MAP_FAILED) {
+    memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+      return NULL;
+    }
+    advise(memory, length);
+  }
+  if (bind_to_local_node(memory, length) == 0) {
+    count(&stats.node_bytes, length);
+  }
+  count(&stats.allocations, 1);
+  *mapped = length;
+  return memory;
+}
+
+void trace_alloc_free(void* memory, size_t mapped) {
+  if (!memory) {
+    return;
+  }
+  munmap(memory, mapped);
+}
+
+void trace_alloc_advise(void* memory, size_t size) { advise(memory, size); }
+
+void trace_alloc_get_stats(trace_alloc_stats_t* result) {
+  result->hugetlb_bytes = __atomic_load_n(&stats.hugetlb_bytes, __ATOMIC_RELAXED);
+  result->thp_bytes = __atomic_load_n(&stats.thp_bytes, __ATOMIC_RELAXED);
+  result->small_page_bytes = __atomic_load_n(&stats.small_page_bytes, __ATOMIC_RELAXED);
+  result->node_bytes = __atomic_load_n(&stats.node_bytes, __ATOMIC_RELAXED);
+  result->allocations = __atomic_load_n(&stats.allocations, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,415 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file trace_config.c
+ * @brief Runtime-adjustable tracing settings
+ *
+ * Parsing and formatting of the settings in trace_config_t, shared by the initial
+ * configuration from the environment and the commands of the control socket.
+ * Publishing a configuration is up to trace_impl.c.
+ */
+
+#include <ctype.h>
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace_types.h"
+#include "trace_config.h"
+
+// PRIVATE HELPERS ***********************************************************
+
+/** @brief Compare an event name with a user-supplied one, ignoring case and treating `_` as a space. */
+static int event_name_equals(const char* name, const char* user, size_t user_length) {
+  size_t i = 0;
+  for (; i < user_length && name[i] != '\0'; i++) {
+    char c = (user[i] == '_') ? ' ' : user[i];
+    if (tolower((unsigned char)c) != tolower((unsigned char)name[i])) {
+      return 0;
+    }
+  }
+  return i == user_length && name[i] == '\0';
+}
+
+/**
+ * @brief Parse an event specification into a mask.
+ *
+ * @return 0 on success, -1 if a name is unknown
+ */
+static int parse_events(const char* spec, uint64_t* mask, char error[TRACE_CONFIG_ERROR_SIZE]) {
+  if (strcmp(spec, "all") == 0) {
+    *mask = TRACE_CONFIG_ALL_EVENTS;
+    return 0;
+  }
+  if (strcmp(spec, "reactions") == 0) {
+    *mask = TRACE_CONFIG_REACTION_EVENTS;
+    return 0;
+  }
+  if (strncmp(spec, "0x", 2) == 0) {
+    char* end;
+    unsigned long long value = strtoull(spec + 2, &end, 16);
+    // strtoull would also accept leading spaces and a sign.
+    if (!isxdigit((unsigned char)spec[2]) || *end != '\0') {
+      snprintf(error, TRACE_CONFIG_ERROR_SIZE, "invalid event mask '%s'", spec);
+      return -1;
+    }
+    *mask = (uint64_t)value;
+    return 0;
+  }
+  uint64_t result = 0;
+  const char* start = spec;
+  while (*start != '\0') {
+    const char* end = strchr(start, ',');
+    size_t length = end ? (size_t)(end - start) : strlen(start);
+    int found = 0;
+    for (int i = 0; i < NUM_EVENT_TYPES && i < 64; i++) {
+      if (event_name_equals(trace_event_names[i], start, length)) {
+        result |= UINT64_C(1) << i;
+        found = 1;
+        break;
+      }
+    }
+    if (!found && length > 0) {
+      snprintf(error, TRACE_CONFIG_ERROR_SIZE, "unknown event '%.*s'", (int)length, start);
+      return -1;
+    }
+    start += length + (end ? 1 : 0);
+  }
+  *mask = result;
+  return 0;
+}
+
+static int parse_positive(const char* text, long long* value) {
+  char* end;
+  long long result = strtoll(text, &end, 10);
+  if (*text == '\0' || *end != '\0' || result <= 0) {
+    return -1;
+  }
+  *value = result;
+  return 0;
+}
+
+/** @brief Replace a pattern list; `-` or an empty string clears it. */
+static int set_patterns(char** patterns, const char* value) {
+  char* copy = NULL;
+  if (value[0] != '\0' && strcmp(value, "-") != 0) {
+    copy = strdup(value);
+    if (!copy) {
+      return -1;
+    }
+  }
+  free(*patterns);
+  *patterns = copy;
+  return 0;
+}
+
+/** @brief Whether the FQN matches one of the comma-separated globs. */
+static int matches_any(const char* patterns, const char* fqn) {
+  char pattern[256];
+  const char* start = patterns;
+  while (*start != '\0') {
+    const char* end = strchr(start, ',');
+    size_t length = end ? (size_t)(end - start) : strlen(start);
+    if (length > 0 && length < sizeof(pattern)) {
+      memcpy(pattern, start, length);
+      pattern[length] = '\0';
+      if (fnmatch(pattern, fqn, 0) == 0) {
+        return 1;
+      }
+    }
+    start += length + (end ? 1 : 0);
+  }
+  return 0;
+}
+
+/**
+ * @brief Parse a window specification `<from>-[<to>] [every <period>]`; `-` clears the window.
+ *
+ * @return 0 on success, -1 if the specification is invalid
+ */
+static int parse_window(const char* spec, trace_config_t* config, char error[TRACE_CONFIG_ERROR_SIZE]) {
+  if (spec[0] == '\0' || strcmp(spec, "-") == 0) {
+    config->windowed = 0;
+    config->window_start = 0;
+    config->window_end = INT64_MAX;
+    config->window_period = 0;
+    return 0;
+  }
+  char text[128];
+  if (strlen(spec) >= sizeof(text)) {
+    snprintf(error, TRACE_CONFIG_ERROR_SIZE, "window specification too long");
+    return -1;
+  }
+  strcpy(text, spec);
+  int64_t start, end = INT64_MAX, period = 0;
+  char* saveptr = NULL;
+  char* bounds = strtok_r(text, " \t", &saveptr);
+  char* keyword = strtok_r(NULL, " \t", &saveptr);
+  char* period_text = strtok_r(NULL, " \t", &saveptr);
+  char* dash = bounds ? strchr(bounds, '-') : NULL;
+  if (!dash || (keyword && (strcmp(keyword, "every") != 0 || !period_text)) || strtok_r(NULL, " \t", &saveptr)) {
+    snprintf(error, TRACE_CONFIG_ERROR_SIZE, "expected <from>-[<to>] [every <period>], got '%.64s'", spec);
+    return -1;
+  }
+  *dash = '\0';
+  if (trace_config_parse_duration(bounds, &start) != 0 ||
+      (dash[1] != '\0' && trace_config_parse_duration(dash + 1, &end) != 0) ||
+      (period_text && trace_config_parse_duration(period_text, &period) != 0)) {
+    snprintf(error, TRACE_CONFIG_ERROR_SIZE, "invalid duration in window '%.64s'", spec);
+    return -1;
+  }
+  if (end <= start || (period_text && (end == INT64_MAX || period < end - start))) {
+    snprintf(error, TRACE_CONFIG_ERROR_SIZE, "window '%.64s' is empty, or longer than its period", spec);
+    return -1;
+  }
+  config->windowed = 1;
+  config->window_start = start;
+  config->window_end = end;
+  config->window_period = period;
+  return 0;
+}
+
+/** @brief Format a duration with the largest unit that represents it exactly. */
+static void format_duration(int64_t nanoseconds, char* buffer, size_t size) {
+  static const struct {
+    int64_t scale;
+    const char* unit;
+  } units[] = {{1000000000, "s"}, {1000000, "ms"}, {1000, "us"}, {1, "ns"}};
+  for (size_t i = 0; i < sizeof(units) / sizeof(units[0]); i++) {
+    if (nanoseconds % units[i].scale == 0) {
+      snprintf(buffer, size, "%lld%s", (long long)(nanoseconds / units[i].scale), units[i].unit);
+      return;
+    }
+  }
+}
+
+static int apply_batch(trace_config_t* config, char* arguments, char error[TRACE_CONFIG_ERROR_SIZE]) {
+  otel_batch_settings_t batch = config->batch;
+  for (char* saveptr = NULL, *token = strtok_r(arguments, " \t", &saveptr); token;
+       token = strtok_r(NULL, " \t", &saveptr)) {
+    char* value = strchr(token, '=');
+    long long number;
+    if (!value || parse_positive(value + 1, &number) != 0) {
+      snprintf(error, TRACE_CONFIG_ERROR_SIZE, "expected <setting>=<positive number>, got '%s'", token);
+      return -1;
+    }
+    *value = '\0';
+    if (strcmp(token, "delay") == 0) {
+      batch.schedule_delay_ms = number;
+    } else if (strcmp(token, "queue") == 0) {
+      batch.max_queue_size = number;
+    } else if (strcmp(token, "size") == 0) {
+      batch.max_export_batch_size = number;
+    } else {
+      snprintf(error, TRACE_CONFIG_ERROR_SIZE, "unknown batch setting '%s'", token);
+      return -1;
+    }
+  }
+  if (memcmp(&batch, &config->batch, sizeof(batch)) == 0) {
+    return 0;
+  }
+  config->batch = batch;
+  return TRACE_CONFIG_CHANGED_BATCH;
+}
+
+// IMPLEMENTATION OF TRACE CONFIG API ****************************************
+
+trace_config_t* trace_config_from_env(void) {
+  trace_config_t* config = (trace_config_t*)calloc(1, sizeof(trace_config_t));
+  if (!config) {
+    return NULL;
+  }
+  memset(config->keep, 0xff, sizeof(config->keep));
+  config->sample_period = 1;
+  config->window_end = INT64_MAX;
+
+  // Default: only reaction events are exported. LF_TRACE_VERBOSE=1 exports every event.
+  const char* verbose_env = getenv("LF_TRACE_VERBOSE");
+  config->event_mask =
+      (verbose_env && strcmp(verbose_env, "1") == 0) ? TRACE_CONFIG_ALL_EVENTS : TRACE_CONFIG_REACTION_EVENTS;
+
+  char error[TRACE_CONFIG_ERROR_SIZE];
+  const char* events_env = getenv("LF_TRACE_EVENTS");
+  if (events_env && events_env[0] != '\0' && parse_events(events_env, &config->event_mask, error) != 0) {
+    fprintf(stderr, "WARNING: Ignoring LF_TRACE_EVENTS: %s\n", error);
+  }
+  const char* sample_env = getenv("LF_TRACE_SAMPLE");
+  long long period;
+  if (sample_env && sample_env[0] != '\0') {
+    if (parse_positive(sample_env, &period) == 0 && period <= UINT32_MAX) {
+      config->sample_period = (uint32_t)period;
+    } else {
+      fprintf(stderr, "WARNING: Ignoring LF_TRACE_SAMPLE: expected a positive number, got '%s'\n", sample_env);
+    }
+  }
+  const char* window_env = getenv("LF_TRACE_WINDOW");
+  if (window_env && parse_window(window_env, config, error) != 0) {
+    fprintf(stderr, "WARNING: Ignoring LF_TRACE_WINDOW: %s\n", error);
+  }
+  const char* include_env = getenv("LF_TRACE_INCLUDE");
+  const char* exclude_env = getenv("LF_TRACE_EXCLUDE");
+  if ((include_env && set_patterns(&config->include, include_env) != 0) ||
+      (exclude_env && set_patterns(&config->exclude, exclude_env) != 0)) {
+    trace_config_free(config);
+    return NULL;
+  }
+  return config;
+}
+
+trace_config_t* trace_config_copy(const trace_config_t* config) {
+  trace_config_t* copy = (trace_config_t*)malloc(sizeof(trace_config_t));
+  if (!copy) {
+    return NULL;
+  }
+  *copy = *config;
+  copy->include = config->include ? strdup(config->include) : NULL;
+  copy->exclude = config->exclude ? strdup(config->exclude) : NULL;
+  copy->retired = NULL;
+  if ((config->include && !copy->include) || (config->exclude && !copy->exclude)) {
+    trace_config_free(copy);
+    return NULL;
+  }
+  return copy;
+}
+
+void trace_config_free(trace_config_t* config) {
+  while (config) {
+    trace_config_t* retired = config->retired;
+    free(config->include);
+    free(config->exclude);
+    free(config);
+    config = retired;
+  }
+}
+
+int trace_config_apply_command(trace_config_t* config, const char* command, char error[TRACE_CONFIG_ERROR_SIZE]) {
+  char line[1024];
+  if (strlen(command) >= sizeof(line)) {
+    snprintf(error, TRACE_CONFIG_ERROR_SIZE, "command too long");
+    return -1;
+  }
+  strcpy(line, command);
+  char* name = line;
+  while (isspace((unsigned char)*name)) {
+    name++;
+  }
+  char* arguments = name + strcspn(name, " \t");
+  if (*arguments != '\0') {
+    *arguments++ = '\0';
+    while (isspace((unsigned char)*arguments)) {
+      arguments++;
+    }
+  }
+  for (char* end = arguments + strlen(arguments); end > arguments && isspace((unsigned char)end[-1]); end--) {
+    end[-1] = '\0';
+  }
+
+  if (strcmp(name, "events") == 0) {
+    return parse_events(arguments, &config->event_mask, error) == 0 ? 0 : -1;
+  }
+  if (strcmp(name, "verbose") == 0) {
+    if (strcmp(arguments, "0") != 0 && strcmp(arguments, "1") != 0) {
+      snprintf(error, TRACE_CONFIG_ERROR_SIZE, "expected verbose 0 or 1");
+      return -1;
+    }
+    config->event_mask = (arguments[0] == '1') ? TRACE_CONFIG_ALL_EVENTS : TRACE_CONFIG_REACTION_EVENTS;
+    return 0;
+  }
+  if (strcmp(name, "sample") == 0) {
+    long long period;
+    if (parse_positive(arguments, &period) != 0 || period > UINT32_MAX) {
+      snprintf(error, TRACE_CONFIG_ERROR_SIZE, "expected a positive sampling period");
+      return -1;
+    }
+    config->sample_period = (uint32_t)period;
+    return 0;
+  }
+  if (strcmp(name, "include") == 0 || strcmp(name, "exclude") == 0) {
+    if (set_patterns(name[0] == 'i' ? &config->include : &config->exclude, arguments) != 0) {
+      snprintf(error, TRACE_CONFIG_ERROR_SIZE, "out of memory");
+      return -1;
+    }
+    return TRACE_CONFIG_CHANGED_FILTERS;
+  }
+  if (strcmp(name, "window") == 0) {
+    return parse_window(arguments, config, error) == 0 ? 0 : -1;
+  }
+  if (strcmp(name, "batch") == 0) {
+    return apply_batch(config, arguments, error);
+  }
+  snprintf(error, TRACE_CONFIG_ERROR_SIZE, "unknown command '%.64s'", name);
+  return -1;
+}
+
+int trace_config_reactor_matches(const trace_config_t* config, const char* fqn) {
+  if (!fqn) {
+    fqn = "";
+  }
+  if (config->include && !matches_any(config->include, fqn)) {
+    return 0;
+  }
+  return !(config->exclude && matches_any(config->exclude, fqn));
+}
+
+void trace_config_update_keep(trace_config_t* config, size_t index, const object_description_t* description) {
+  if (index >= TRACE_OBJECT_TABLE_SIZE) {
+    return;
+  }
+  int keep = description->type != trace_reactor || trace_config_reactor_matches(config, description->description);
+  uint64_t bit = UINT64_C(1) << (index % 64);
+  if (keep) {
+    __atomic_fetch_or(&config->keep[index / 64], bit, __ATOMIC_RELAXED);
+  } else {
+    __atomic_fetch_and(&config->keep[index / 64], ~bit, __ATOMIC_RELAXED);
+  }
+}
+
+void trace_config_format(const trace_config_t* config, char* buffer, size_t size) {
+  // Three durations and the separators of "<start>-<end> every <period>".
+  char window[3 * 32 + sizeof("- every ")] = "-";
+  if (config->windowed) {
+    char start[32], end[32] = "", period[32];
+    format_duration(config->window_start, start, sizeof(start));
+    if (config->window_end != INT64_MAX) {
+      format_duration(config->window_end, end, sizeof(end));
+    }
+    if (config->window_period > 0) {
+      format_duration(config->window_period, period, sizeof(period));
+      snprintf(window, sizeof(window), "%s-%s every %s", start, end, period);
+    } else {
+      snprintf(window, sizeof(window), "%s-%s", start, end);
+    }
+  }
+  snprintf(buffer, size,
+           "events=0x%016llx sample=%u include=%s exclude=%s window=%s batch delay=%lld queue=%lld size=%lld",
+           (unsigned long long)config->event_mask, config->sample_period, config->include ? config->include : "-",
+           config->exclude ? config->exclude : "-", window, (long long)config->batch.schedule_delay_ms,
+           (long long)config->batch.max_queue_size, (long long)config->batch.max_export_batch_size);
+}
+
+int trace_config_parse_duration(const char* text, int64_t* nanoseconds) {
+  char* end;
+  double value = strtod(text, &end);
+  if (end == text || value < 0) {
+    return -1;
+  }
+  double scale;
+  if (*end == '\0' || strcmp(end, "ns") == 0) {
+    scale = 1.0;
+  } else if (strcmp(end, "us") == 0) {
+    scale = 1e3;
+  } else if (strcmp(end, "ms") == 0) {
+    scale = 1e6;
+  } else if (strcmp(end, "s") == 0) {
+    scale = 1e9;
+  } else {
+    return -1;
+  }
+  if (value * scale >= 9.2e18) {
+    return -1;
+  }
+  *nanoseconds = (int64_t)(value * scale);
+  return 0;
+}
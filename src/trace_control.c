@@ -0,0 +1,206 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file trace_control.c
+ * @brief Control socket for changing tracing settings at runtime
+ *
+ * A single plugin thread accepts connections on a Unix domain socket and passes each
+ * received line to the handler registered by trace_impl.c. The thread is the only
+ * writer of the configuration besides registration, so it never touches the tracepoint
+ * path. It waits in poll() on the socket and a wake-up pipe used to stop it.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "trace_control.h"
+
+#define TRACE_CONTROL_LINE_SIZE 1024
+
+#ifndef MSG_NOSIGNAL
+// macOS: SO_NOSIGPIPE is set on the client socket instead.
+#define MSG_NOSIGNAL 0
+#endif
+
+// PRIVATE DATA STRUCTURES ***************************************************
+
+static pthread_t control_thread;
+static int control_running = 0;
+static int listen_fd = -1;
+static int wake_pipe[2] = {-1, -1};
+static trace_control_handler_t control_handler;
+static char socket_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+
+// PRIVATE HELPERS ***********************************************************
+
+/** @brief Wait until the descriptor is readable or the thread is asked to stop. */
+static int wait_readable(int fd) {
+  struct pollfd fds[2] = {{.fd = fd, .events = POLLIN}, {.fd = wake_pipe[0], .events = POLLIN}};
+  for (;;) {
+    int result = poll(fds, 2, -1);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0 || (fds[1].revents & POLLIN)) {
+      return -1;
+    }
+    return 0;
+  }
+}
+
+static void write_all(int fd, const char* data, size_t length) {
+  while (length > 0) {
+    ssize_t written = send(fd, data, length, MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return;
+    }
+    data += written;
+    length -= (size_t)written;
+  }
+}
+
+/** @brief Serve one client until it disconnects. @return -1 if the thread must stop. */
+static int serve_client(int client_fd) {
+  char line[TRACE_CONTROL_LINE_SIZE];
+  size_t used = 0;
+  for (;;) {
+    if (wait_readable(client_fd) != 0) {
+      return -1;
+    }
+    ssize_t received = recv(client_fd, line + used, sizeof(line) - 1 - used, 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      return 0;
+    }
+    used += (size_t)received;
+    line[used] = '\0';
+
+    char* start = line;
+    char* newline;
+    while ((newline = strchr(start, '\n')) != NULL) {
+      *newline = '\0';
+      if (newline > start && newline[-1] == '\r') {
+        newline[-1] = '\0';
+      }
+      if (*start != '\0') {
+        char reply[TRACE_CONTROL_REPLY_SIZE + 1];
+        control_handler(start, reply);
+        size_t length = strnlen(reply, TRACE_CONTROL_REPLY_SIZE - 1);
+        reply[length] = '\n';
+        write_all(client_fd, reply, length + 1);
+      }
+      start = newline + 1;
+    }
+    used = strlen(start);
+    memmove(line, start, used + 1);
+    if (used == sizeof(line) - 1) {
+      write_all(client_fd, "error: line too long\n", 21);
+      return 0;
+    }
+  }
+}
+
+static void* control_main(void* arg) {
+  (void)arg;
+  for (;;) {
+    if (wait_readable(listen_fd) != 0) {
+      break;
+    }
+    int client_fd = accept(listen_fd, NULL, NULL);
+    if (client_fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      break;
+    }
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(client_fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    int stop = serve_client(client_fd);
+    close(client_fd);
+    if (stop) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+// IMPLEMENTATION OF TRACE CONTROL API ***************************************
+
+int trace_control_start(const char* path, trace_control_handler_t handler) {
+  if (control_running || !path || !handler) {
+    return -1;
+  }
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    fprintf(stderr, "WARNING: Control socket path is too long: %s\n", path);
+    return -1;
+  }
+  strcpy(address.sun_path, path);
+
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0) {
+    fprintf(stderr, "WARNING: Failed to create control socket: %s\n", strerror(errno));
+    return -1;
+  }
+  unlink(path);
+  if (bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listen_fd, 4) != 0) {
+    fprintf(stderr, "WARNING: Failed to listen on control socket %s: %s\n", path, strerror(errno));
+    close(listen_fd);
+    listen_fd = -1;
+    return -1;
+  }
+  if (pipe(wake_pipe) != 0) {
+    fprintf(stderr, "WARNING: Failed to create control pipe: %s\n", strerror(errno));
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(path);
+    return -1;
+  }
+  strcpy(socket_path, path);
+  control_handler = handler;
+  if (pthread_create(&control_thread, NULL, control_main, NULL) != 0) {
+    fprintf(stderr, "WARNING: Failed to start the control thread.\n");
+    trace_control_stop();
+    return -1;
+  }
+  control_running = 1;
+  return 0;
+}
+
+void trace_control_stop(void) {
+  if (control_running) {
+    ssize_t written;
+    do {
+      written = write(wake_pipe[1], "x", 1);
+    } while (written < 0 && errno == EINTR);
+    pthread_join(control_thread, NULL);
+    control_running = 0;
+  }
+  if (listen_fd >= 0) {
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(socket_path);
+  }
+  for (int i = 0; i < 2; i++) {
+    if (wake_pipe[i] >= 0) {
+      close(wake_pipe[i]);
+      wake_pipe[i] = -1;
+    }
+  }
+}
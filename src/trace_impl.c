@@ -5,52 +5,236 @@
 #include <assert.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#endif
 
 #include "trace.h"
 #include "trace_types.h"
 #include "platform.h"
 #include "logging_macros.h"
 #include "trace_impl.h"
+#include "lft_writer.h"
+#include "shm_ring.h"
+#include "ctf_writer.h"
 #include "otel_backend.h"
-#include "opentelemetry_c/opentelemetry_c.h"
+#include "otlp_exporter.h"
+#include "trace_config.h"
+#include "trace_control.h"
+#include "flight_recorder.h"
+#include "critical_path.h"
+#include "string_arena.h"
+#include "trace_alloc.h"
+#include "trace_probes.h"
 
 // These are the standard OpenTelemetry OTLP endpoints:
 // gRPC endpoint - port 4317 (0.0.0.0:4317)
 // HTTP endpoint - port 4318 (0.0.0.0:4318)
 #define OTEL_ENDPOINT_DEFAULT "http://localhost:4317"
 
-/** Macro to use when access to trace file fails. */
-#define _LF_TRACE_FAILURE(trace)                                                                                       \
-  do {                                                                                                                 \
-    fprintf(stderr, "WARNING: Access to trace file failed.\n");                                                        \
-    fclose(trace->_lf_trace_file);                                                                                     \
-    trace->_lf_trace_file = NULL;                                                                                      \
-    return -1;                                                                                                         \
-  } while (0)
+/** log2 of the slots in the pointer index of the object table; at least twice TRACE_OBJECT_TABLE_SIZE. */
+#define DESCRIPTION_INDEX_BITS 11
+#define DESCRIPTION_INDEX_SLOTS ((size_t)1 << DESCRIPTION_INDEX_BITS)
+
+/** Default number of records kept per worker in the shared-memory ring (LF_TRACE_SHM_RECORDS). */
+#define SHM_RING_RECORDS_DEFAULT 65536
+
+/** Maximum number of reactions with a dense ID; the reactions beyond it take the slow path. */
+#define REACTION_TABLE_SIZE 4096
+
+/** log2 of the slots in the reaction index; at least twice REACTION_TABLE_SIZE. */
+#define REACTION_INDEX_BITS 13
+#define REACTION_INDEX_SLOTS ((size_t)1 << REACTION_INDEX_BITS)
+
+/** Maximum nesting of reaction spans on one thread; deeper reactions are not exported. */
+#define REACTION_SPAN_STACK_DEPTH 16
+
+/** Default number of records kept per worker by the flight recorder (LF_TRACE_FLIGHT_RECORDER_RECORDS). */
+#define FLIGHT_RECORDER_RECORDS_DEFAULT 65536
+
+/** Default post-trigger window of the flight recorder (LF_TRACE_FLIGHT_RECORDER_AFTER). */
+#define FLIGHT_RECORDER_AFTER_DEFAULT "500ms"
+
+/** Executions that the moving averages of the outlier detector (LF_TRACE_OUTLIERS) mostly cover. */
+#define OUTLIER_EWMA_SPAN 64
+
+/** Executions of a reaction before its moving averages are trusted to flag outliers. */
+#define OUTLIER_WARMUP 16
+
+/** Least excess over the moving average, in nanoseconds, that makes an outlier. */
+#define OUTLIER_MIN_DEVIATION 1000
+
+/** Default interval of the reaction summaries (LF_TRACE_OUTLIERS_SUMMARY). */
+#define OUTLIER_SUMMARY_DEFAULT "10s"
+
+/** Default time shutdown may take to drain and flush the sinks (LF_TRACE_SHUTDOWN_TIMEOUT). */
+#define SHUTDOWN_TIMEOUT_DEFAULT "5s"
 
 // PRIVATE DATA STRUCTURES ***************************************************
 
 static lf_platform_mutex_ptr_t trace_mutex;
 static trace_t trace;
-otel_backend_t* backend;
-static void* tracer;
+static const otel_backend_ops_t* otel;  // NULL when the OpenTelemetry exporter is disabled (LF_TRACE_OTEL=0)
 static int64_t start_time;
-static int trace_only_reactions = 1;  // Default: only trace reaction events (reaction_starts, reaction_ends). Set LF_TRACE_VERBOSE=1 to trace all events.
+// Current runtime settings (event mask, sampling, filters, exporter). Loaded once per tracepoint and
+// replaced as a whole by the control thread; see trace_config.h.
+static trace_config_t* current_config;
+static int lft_enabled = 0;  // Set LF_TRACE_FILE=1 (or to a file name) to also write the LF binary trace format.
+static int shm_enabled = 0;  // Set LF_TRACE_SHM=<name> to keep the latest records in a shared-memory ring.
+static int ctf_enabled = 0;  // Set LF_TRACE_CTF=1 (or to a directory) to write a CTF trace.
+static int flight_enabled = 0;  // Set LF_TRACE_FLIGHT_RECORDER=<window> to capture records around anomalies.
+static int64_t flight_lag_threshold = 0;  // Lag that triggers a capture (LF_TRACE_FLIGHT_RECORDER_LAG), 0 = none
+static char flight_file_prefix[TRACE_MAX_FILENAME_LENGTH];
+static int critical_path_enabled = 0;  // Set LF_TRACE_CRITICAL_PATH=1 (or to an interval) to export critical paths.
+
+// Open-addressing indexes of the object table, so that tracepoints find a description (and its
+// keep bit) without scanning the table: one by object pointer and one by trigger pointer.
+typedef struct description_index_slot {
+  const void* key;
+  int32_t entry;      // Position in the object table plus one; 0 marks an empty slot.
+  int32_t triggers;   // Pointer index only: first trigger registered with this pointer plus one
+  int32_t schedules;  // Pointer index only: triggers of the chain with an outstanding schedule
+} description_index_slot_t;
+static description_index_slot_t description_index[DESCRIPTION_INDEX_SLOTS];
+static description_index_slot_t trigger_index[DESCRIPTION_INDEX_SLOTS];
+// Chains of the triggers that share a pointer (their reactor), plus one; 0 ends a chain.
+static int32_t next_trigger[TRACE_OBJECT_TABLE_SIZE];
+
+// Outstanding schedule of each trigger, indexed like the object table, relating a
+// schedule_called to the first reaction of the trigger's reactor at or after the earliest
+// tag the trigger can fire at. reaction_starts records do not carry the trigger, so this
+// is a heuristic; one schedule per trigger is tracked (the oldest one pending).
+#define SCHEDULE_NONE 0
+#define SCHEDULE_PENDING 1   // Scheduled, not yet fired
+#define SCHEDULE_RESOLVED 2  // Fired at the tag in fired_time/fired_microstep
+typedef struct trigger_schedule {
+  int state;
+  int64_t earliest_time;      // Earliest tag the trigger can fire at
+  int64_t earliest_microstep;
+  int64_t fired_time;         // Tag of the reactions it triggered
+  int64_t fired_microstep;
+  int64_t logical_time;       // Tag and physical time of the schedule_called
+  int64_t microstep;
+  int64_t physical_time;
+  int source;                 // Reaction ID of the scheduling reaction, or -1
+} trigger_schedule_t;
+// On cache lines of their own, so that workers scheduling different triggers do not contend.
+typedef struct trigger_schedule_slot {
+  int lock;  // Spin lock; any worker may schedule a trigger while its reactor runs
+  trigger_schedule_t schedule;
+} __attribute__((aligned(64))) trigger_schedule_slot_t;
+static trigger_schedule_slot_t trigger_schedules[TRACE_OBJECT_TABLE_SIZE];
 
-// Thread-local storage for an in-flight reaction span on the current OS thread.
+// Dense reaction IDs, assigned on the first reaction_starts of a reaction whose reactor is
+// registered. The reaction index, keyed by (pointer, dst_id), is looked up once per
+// reaction_starts; everything kept per reaction lives in flat arrays indexed by the ID.
+typedef struct reaction_index_slot {
+  const void* pointer;  // Reactor of the reaction
+  int32_t dst_id;       // Reaction number
+  int32_t reaction;     // Reaction ID plus one; 0 marks an empty slot
+} reaction_index_slot_t;
+static reaction_index_slot_t reaction_index[REACTION_INDEX_SLOTS];
+static int32_t reaction_count = 0;
+// Per-reaction state, written before the ID is published in the reaction index.
+static const char* reaction_fqns[REACTION_TABLE_SIZE] __attribute__((aligned(64)));  // Interned "<reactor>.<n>"
+static description_index_slot_t* reaction_reactors[REACTION_TABLE_SIZE] __attribute__((aligned(64)));
+
+// Stack of the in-flight reaction spans of each OS thread.
 // The LF runtime emits reaction tracepoints as a pair:
 // - reaction_starts: immediately before invoking a reaction
 // - reaction_ends:   immediately after the reaction returns
-// We create the span on reaction_starts and end it on reaction_ends.
+// We create the span on reaction_starts and end it on the reaction_ends of the same reaction
+// (same pointer and dst_id), which is normally the top of the stack. Nested invocations push
+// further frames; an end that matches a deeper frame means the frames above lost their ends.
 #if __STDC_VERSION__ >= 201112L
 #define LF_THREAD_LOCAL _Thread_local
 #else
 #define LF_THREAD_LOCAL __thread
 #endif
 
-static LF_THREAD_LOCAL void* active_reaction_span = NULL;
-static LF_THREAD_LOCAL void* active_reaction_pointer = NULL;
-static LF_THREAD_LOCAL int active_reaction_dst_id = -1;
+typedef struct reaction_span_frame {
+  void* span;          // NULL if the reaction is not exported (sampled out or not in the event mask)
+  void* pointer;       // Reactor of the reaction
+  int dst_id;          // Reaction number
+  int reaction;        // Reaction ID, or -1 if it has none
+  int64_t start_time;  // Physical time of the reaction_starts
+} reaction_span_frame_t;
+
+// Per-thread state, allocated on the first tracepoint of a thread and kept until shutdown, so
+// that shutdown can wait for the threads inside a tracepoint and end the spans they left open,
+// including those of threads that have exited.
+typedef struct thread_state {
+  int busy;          // Inside a tracepoint; see stop_ingest()
+  int thread_id;     // LF thread ID; it identifies the worker in spans
+  int depth;         // Frames in use
+  int overflow;      // Starts beyond the depth, whose ends come first
+  uint32_t sample_counter;  // Reaction executions seen by this thread, for sampling (LF_TRACE_SAMPLE)
+  reaction_span_frame_t frames[REACTION_SPAN_STACK_DEPTH];
+  struct thread_state* next;
+} thread_state_t;
+static LF_THREAD_LOCAL thread_state_t* this_thread;
+static thread_state_t* all_threads;  // Every registered thread, linked through next
+// Pairing anomalies over all threads, reported at shutdown.
+static uint64_t unmatched_starts = 0;   // Spans ended because the reaction_ends was lost
+static uint64_t unmatched_ends = 0;     // reaction_ends without a matching reaction_starts
+static uint64_t overflowed_starts = 0;  // Reactions nested deeper than REACTION_SPAN_STACK_DEPTH
+
+// Shutdown (see lf_tracing_global_shutdown()): once ingest is stopped, tracepoints only count
+// the events they drop. Stopping must see every thread that entered a tracepoint before; the
+// tracepoints only order their busy store before the load of the flag for the compiler, and
+// the stopping thread makes that a full barrier on all threads with membarrier(2). Without
+// it, the tracepoints issue a full fence.
+static int ingest_stopped = 0;
+static int tracepoint_fence = 1;  // Cleared once membarrier is registered
+static uint64_t dropped_after_stop = 0;
+static int64_t shutdown_timeout = 0;  // LF_TRACE_SHUTDOWN_TIMEOUT
+
+// Timeline span of each worker buffer (LF_TRACE_WORKER_SPANS), rolled over every interval.
+// Only the thread(s) of a buffer touch its entry; buffer -1 is serialized by the trace mutex.
+typedef struct worker_span_state {
+  void* span;        // Open worker span, or NULL
+  int64_t opened;    // Physical time of the first event in the span
+  int64_t reactions; // Reactions completed in the span
+  int64_t busy;      // Nanoseconds spent in outermost reactions in the span
+  char padding[64 - sizeof(void*) - 3 * sizeof(int64_t)];
+} worker_span_state_t;
+static worker_span_state_t* worker_spans;  // Indexed by buffer + 1; NULL if disabled
+static int64_t worker_span_interval = 0;
+
+// Outlier detector of each reaction (LF_TRACE_OUTLIERS), indexed by reaction ID. LF never runs two
+// reactions of a reactor at once, so the worker running a reaction is the only writer of its entry.
+// The summary thread takes the summaries of reactions that stop running without writing the entry:
+// it marks them taken in `state`, and the worker starts a new summary when it next sees the mark.
+#define STATS_TAKEN 1     // In state: the summary thread took the summary
+#define STATS_UPDATING 2  // In state: a worker is updating the entry; also the step of the update count
+typedef struct reaction_stats {
+  uint64_t state;           // Updates since the start times STATS_UPDATING, plus STATS_TAKEN
+  double duration_mean;     // Moving average and variance of the execution time
+  double duration_variance;
+  double lag_mean;          // Moving average and variance of the start minus the logical time
+  double lag_variance;
+  int32_t samples;          // Executions seen, up to OUTLIER_EWMA_SPAN
+  int32_t reaction_number;
+  int64_t opened;           // Physical start of the first execution in the summary
+  int64_t closed;           // Physical end of the last execution in the summary
+  int64_t executions;       // Executions in the summary; 0 if none
+  int64_t outliers;         // Executions in the summary exported as spans
+  int64_t total_duration;
+  int64_t max_duration;
+} __attribute__((aligned(64))) reaction_stats_t;
+static reaction_stats_t* reaction_stats;  // REACTION_TABLE_SIZE entries; NULL if disabled
+static double outlier_threshold = 0;      // Square of the k of LF_TRACE_OUTLIERS=k
+static int64_t outlier_summary_interval = 0;
+static pthread_t summary_thread;          // Takes the summaries of reactions that stopped running
+static int summary_running = 0;
+static int summary_stopping = 0;          // Guarded by summary_mutex
+static pthread_mutex_t summary_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t summary_wake;
 static version_t version = {.build_config =
                                 {
                                     .single_threaded = TRIBOOL_DOES_NOT_MATTER,
@@ -66,175 +250,489 @@ static version_t version = {.build_config =
 // PRIVATE HELPERS ***********************************************************
 
 /**
- * @brief Set common high-cardinality attributes on a span.
+ * @brief Build a reaction FQN as "<reactor_fqn>.<reaction_number>".
  *
- * High cardinality attributes: timestamp, microstep, lag.
+ * @return malloc'd string owned by the caller, or NULL if not enough information.
  */
-static void set_common_high_cardinality_attributes(void* span, const trace_record_nodeps_t* tr) {
-  if (!span || !tr) {
-    return;
+static char* build_reaction_fqn(const object_description_t* reactor_desc, int reaction_number) {
+  if (!reactor_desc || !reactor_desc->description || reactor_desc->description[0] == '\0') {
+    return NULL;
   }
-  void* map = otelc_create_attr_map();
-  otelc_set_int64_t_attr(map, "xronos.timestamp", tr->logical_time);
-  otelc_set_uint32_t_attr(map, "xronos.microstep", (uint32_t)tr->microstep);
-  otelc_set_int64_t_attr(map, "xronos.lag", tr->physical_time - tr->logical_time);
-  otelc_set_span_attrs(span, map);
-  otelc_destroy_attr_map(map);
+  if (reaction_number < 0) {
+    return NULL;
+  }
+  // Registered names are interned, so their length is known.
+  const char* reactor_name = reactor_desc->description;
+  size_t reactor_len = string_arena_length(reactor_name);
+  size_t fqn_len = reactor_len + 1 + 20 + 1; // reactor + "." + number + null
+  char* reaction_fqn = (char*)malloc(fqn_len);
+  if (!reaction_fqn) {
+    return NULL;
+  }
+  memcpy(reaction_fqn, reactor_name, reactor_len);
+  snprintf(reaction_fqn + reactor_len, fqn_len - reactor_len, ".%d", reaction_number);
+  return reaction_fqn;
 }
 
 /**
- * @brief Add xronos.schema.low_cardinality_attributes to an attribute map.
+ * @brief Name of a reaction span: the reaction FQN, else the reactor FQN, else "reaction".
  */
-static void set_low_cardinality_schema_attr(void* map, int has_description, int has_container_fqn) {
-  if (!map) {
-    return;
+static const char* reaction_span_name(const object_description_t* reactor_desc, const char* reaction_fqn) {
+  if (reaction_fqn != NULL) {
+    return reaction_fqn;
+  }
+  if (reactor_desc && reactor_desc->description && reactor_desc->description[0] != '\0') {
+    return reactor_desc->description;
   }
+  return "reaction";
+}
 
-  static const char* kLowCardBase[] = {
-      "xronos.element_type",
-  };
-  static const char* kLowCardWithDescNoContainer[] = {
-      "xronos.element_type",
-      "xronos.fqn",
-      "xronos.name",
-  };
-  static const char* kLowCardWithDescWithContainer[] = {
-      "xronos.element_type",
-      "xronos.fqn",
-      "xronos.name",
-      "xronos.container_fqn",
-  };
-
-  const char* const* values = kLowCardBase;
-  size_t count = sizeof(kLowCardBase) / sizeof(kLowCardBase[0]);
-  if (has_description) {
-    if (has_container_fqn) {
-      values = kLowCardWithDescWithContainer;
-      count = sizeof(kLowCardWithDescWithContainer) / sizeof(kLowCardWithDescWithContainer[0]);
-    } else {
-      values = kLowCardWithDescNoContainer;
-      count = sizeof(kLowCardWithDescNoContainer) / sizeof(kLowCardWithDescNoContainer[0]);
+/**
+ * @brief Hash a pointer to a slot of a description index.
+ *
+ * Fibonacci hashing: the multiplication spreads the (aligned) pointer bits into the
+ * top bits, which select the slot.
+ */
+static inline size_t description_slot(const void* pointer) {
+  return (size_t)(((uint64_t)(uintptr_t)pointer * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - DESCRIPTION_INDEX_BITS));
+}
+
+/**
+ * @brief Find or claim the slot of a key in a description index.
+ *
+ * Called with the trace mutex held. A claimed slot has its key set but no entry; the caller
+ * publishes the entry last, so that a reader that sees the entry also sees the key.
+ */
+static description_index_slot_t* claim_index_slot(description_index_slot_t* index, const void* key) {
+  for (size_t slot = description_slot(key);; slot = (slot + 1) & (DESCRIPTION_INDEX_SLOTS - 1)) {
+    if (index[slot].entry == 0) {
+      index[slot].key = key;
+      return &index[slot];
+    }
+    if (index[slot].key == key) {
+      return &index[slot];
     }
   }
-
-  otelc_set_span_of_string_view_attr(map,
-                                     "xronos.schema.low_cardinality_attributes",
-                                     values,
-                                     count);
 }
 
 /**
- * @brief Build a reaction FQN as "<reactor_fqn>.<reaction_number>".
+ * @brief Find the slot of a key in a description index.
  *
- * @return malloc'd string owned by the caller, or NULL if not enough information.
+ * A single probe sequence; safe to call without the trace mutex.
+ *
+ * @return The slot, or NULL if the key was never registered
  */
-static char* build_reaction_fqn(const object_description_t* reactor_desc, int reaction_number) {
-  if (!reactor_desc || !reactor_desc->description || reactor_desc->description[0] == '\0') {
+static inline description_index_slot_t* find_index_slot(description_index_slot_t* index, const void* key) {
+  if (!key) {
     return NULL;
   }
-  if (reaction_number < 0) {
-    return NULL;
+  for (size_t slot = description_slot(key);; slot = (slot + 1) & (DESCRIPTION_INDEX_SLOTS - 1)) {
+    if (__atomic_load_n(&index[slot].entry, __ATOMIC_ACQUIRE) == 0) {
+      return NULL;
+    }
+    if (index[slot].key == key) {
+      return &index[slot];
+    }
   }
-  const char* reactor_name = reactor_desc->description;
-  size_t fqn_len = strlen(reactor_name) + 1 + 20 + 1; // reactor + "." + number + null
-  char* reaction_fqn = (char*)malloc(fqn_len);
-  if (!reaction_fqn) {
-    return NULL;
+}
+
+/**
+ * @brief Add a registered description to the indexes.
+ *
+ * Called with the trace mutex held. Reactors and their triggers are registered with the
+ * same pointer (the reactor's self struct); the reactor's entry wins, because the
+ * tracepoints that carry only that pointer (reaction_starts and friends) refer to it.
+ * Triggers are also indexed by their trigger pointer and chained to the pointer's slot,
+ * whichever of the reactor and its triggers is registered first.
+ *
+ * @param index Position of the description in the object table
+ */
+static void index_object_description(size_t index) {
+  const object_description_t* description = &trace._lf_trace_object_descriptions[index];
+  if (description->pointer) {
+    description_index_slot_t* slot = claim_index_slot(description_index, description->pointer);
+    if (slot->entry == 0 || (description->type == trace_reactor &&
+                             trace._lf_trace_object_descriptions[slot->entry - 1].type != trace_reactor)) {
+      __atomic_store_n(&slot->entry, (int32_t)index + 1, __ATOMIC_RELEASE);
+    }
+    if (description->type == trace_trigger) {
+      next_trigger[index] = slot->triggers;
+      __atomic_store_n(&slot->triggers, (int32_t)index + 1, __ATOMIC_RELEASE);
+    }
   }
-  snprintf(reaction_fqn, fqn_len, "%s.%d", reactor_name, reaction_number);
-  return reaction_fqn;
+  if (description->type == trace_trigger && description->trigger) {
+    description_index_slot_t* slot = claim_index_slot(trigger_index, description->trigger);
+    if (slot->entry == 0) {
+      __atomic_store_n(&slot->entry, (int32_t)index + 1, __ATOMIC_RELEASE);
+    }
+  }
+}
+
+/**
+ * @brief Find the object description registered for a pointer.
+ *
+ * @param pointer The pointer to match
+ * @return Position of the description in the object table (preferring a reactor), or -1
+ */
+static inline int find_object_description(const void* pointer) {
+  description_index_slot_t* slot = find_index_slot(description_index, pointer);
+  return slot ? __atomic_load_n(&slot->entry, __ATOMIC_ACQUIRE) - 1 : -1;
+}
+
+/** @brief Hash a reaction (its reactor pointer and number) to a slot of the reaction index. */
+static inline size_t reaction_slot(const void* pointer, int dst_id) {
+  uint64_t key = (uint64_t)(uintptr_t)pointer ^ ((uint64_t)(uint32_t)dst_id << 48);
+  return (size_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - REACTION_INDEX_BITS));
 }
 
 /**
- * @brief Set low-cardinality attributes for a reaction span.
+ * @brief Find the ID of the reaction of a record.
+ *
+ * A single probe sequence; safe to call without the trace mutex.
  *
- * Note: We cannot iterate the opaque otelc attribute map to compute the
- * low-cardinality attribute list dynamically, so we compute the expected list
- * based on what we set.
+ * @return The reaction ID, or -1 if the reaction has none yet
  */
-static void set_reaction_low_cardinality_attributes(void* span,
-                                                    const char* reaction_fqn,
-                                                    int reaction_number,
-                                                    const char* reactor_fqn) {
-  if (!span) {
+static inline int find_reaction(const trace_record_nodeps_t* tr) {
+  for (size_t slot = reaction_slot(tr->pointer, tr->dst_id);; slot = (slot + 1) & (REACTION_INDEX_SLOTS - 1)) {
+    int32_t reaction = __atomic_load_n(&reaction_index[slot].reaction, __ATOMIC_ACQUIRE);
+    if (reaction == 0) {
+      return -1;
+    }
+    if (reaction_index[slot].pointer == tr->pointer && reaction_index[slot].dst_id == tr->dst_id) {
+      return reaction - 1;
+    }
+  }
+}
+
+/**
+ * @brief Assign the next reaction ID to the reaction of a reaction_starts record.
+ *
+ * Takes the trace mutex, so it must not be called with it held. The reaction FQN is built
+ * and interned here, once per reaction.
+ *
+ * @return The reaction ID, or -1 if the reactor is not registered or the IDs are exhausted
+ */
+static int register_reaction(const trace_record_nodeps_t* tr) {
+  description_index_slot_t* reactor = find_index_slot(description_index, tr->pointer);
+  if (!reactor || tr->dst_id < 0) {
+    return -1;
+  }
+  const object_description_t* reactor_desc =
+      &trace._lf_trace_object_descriptions[__atomic_load_n(&reactor->entry, __ATOMIC_ACQUIRE) - 1];
+  if (reactor_desc->type != trace_reactor) {
+    return -1;
+  }
+  int reaction = -1;
+  lf_platform_mutex_lock(trace_mutex);
+  size_t slot = reaction_slot(tr->pointer, tr->dst_id);
+  while (reaction_index[slot].reaction != 0 &&
+         (reaction_index[slot].pointer != tr->pointer || reaction_index[slot].dst_id != tr->dst_id)) {
+    slot = (slot + 1) & (REACTION_INDEX_SLOTS - 1);
+  }
+  if (reaction_index[slot].reaction != 0) {
+    // Another thread started the same reaction first.
+    reaction = reaction_index[slot].reaction - 1;
+  } else if (reaction_count < REACTION_TABLE_SIZE) {
+    reaction = reaction_count;
+    char* fqn = build_reaction_fqn(reactor_desc, tr->dst_id);
+    reaction_fqns[reaction] = fqn ? string_arena_intern(fqn) : NULL;
+    free(fqn);
+    reaction_reactors[reaction] = reactor;
+    // The summary thread reads the count without the mutex.
+    __atomic_store_n(&reaction_count, reaction_count + 1, __ATOMIC_RELEASE);
+    reaction_index[slot].pointer = tr->pointer;
+    reaction_index[slot].dst_id = tr->dst_id;
+    __atomic_store_n(&reaction_index[slot].reaction, reaction + 1, __ATOMIC_RELEASE);
+    if (reaction_count == REACTION_TABLE_SIZE) {
+      fprintf(stderr, "WARNING: More than %d reactions. Further reactions are traced more slowly.\n",
+              REACTION_TABLE_SIZE);
+    }
+  }
+  lf_platform_mutex_unlock(trace_mutex);
+  return reaction;
+}
+
+/** @brief Load the current configuration; see trace_config_t for why this needs no lock. */
+static inline const trace_config_t* load_config(void) {
+  return __atomic_load_n(&current_config, __ATOMIC_ACQUIRE);
+}
+
+/** @brief Position of the innermost span stack frame of the reaction of the record, or -1. */
+static inline int span_stack_find(const thread_state_t* self, const trace_record_nodeps_t* tr) {
+  for (int i = self->depth - 1; i >= 0; i--) {
+    if (self->frames[i].pointer == tr->pointer && self->frames[i].dst_id == tr->dst_id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Push the frame of a starting reaction.
+ *
+ * @param span The span of the reaction, or NULL if it is not exported. Must be NULL when the
+ *             stack is full, in which case the start is only counted.
+ * @param reaction The reaction ID, or -1
+ */
+static void span_stack_push(thread_state_t* self, void* span, int reaction, const trace_record_nodeps_t* tr) {
+  if (self->depth == REACTION_SPAN_STACK_DEPTH) {
+    self->overflow++;
+    __atomic_fetch_add(&overflowed_starts, 1, __ATOMIC_RELAXED);
     return;
   }
+  self->frames[self->depth++] = (reaction_span_frame_t){
+      .span = span,
+      .pointer = tr->pointer,
+      .dst_id = tr->dst_id,
+      .reaction = reaction,
+      .start_time = tr->physical_time};
+}
 
-  void* map = otelc_create_attr_map();
+/**
+ * @brief End the span of the reaction of a reaction_ends record and pop its frame.
+ *
+ * @param start_time Receives the physical start time of the reaction
+ * @return The nesting depth of the reaction (0 for an outermost one), or -1 if it has no frame
+ */
+static int span_stack_pop(thread_state_t* self, otel_backend_t* backend, const trace_record_nodeps_t* tr,
+                          int64_t* start_time) {
+  int position = span_stack_find(self, tr);
+  if (self->overflow > 0) {
+    if (position < 0) {
+      // Reactions end in the reverse order of their starts, so this ends the innermost overflowed one.
+      self->overflow--;
+      return -1;
+    }
+    // A reaction cannot be nested in itself, so the overflowed starts above the frame never ended.
+    __atomic_fetch_add(&unmatched_starts, (uint64_t)self->overflow, __ATOMIC_RELAXED);
+    self->overflow = 0;
+  }
+  if (position < 0) {
+    __atomic_fetch_add(&unmatched_ends, 1, __ATOMIC_RELAXED);
+    return -1;
+  }
+  for (int i = self->depth - 1; i >= position; i--) {
+    if (self->frames[i].span) {
+      otel->end_span(backend, self->frames[i].span);
+    }
+  }
+  if (self->depth - 1 > position) {
+    __atomic_fetch_add(&unmatched_starts, (uint64_t)(self->depth - 1 - position), __ATOMIC_RELAXED);
+  }
+  *start_time = self->frames[position].start_time;
+  self->depth = position;
+  return position;
+}
 
-  const char* element_type_value = "reaction";
-  otelc_set_string_view_attr(map, "xronos.element_type",
-                             element_type_value,
-                             strlen(element_type_value));
+static inline void lock_schedule(int trigger) {
+  while (__atomic_exchange_n(&trigger_schedules[trigger].lock, 1, __ATOMIC_ACQUIRE)) {
+  }
+}
 
-  // We only set xronos.fqn/xronos.name/xronos.container_fqn if we have a reaction_fqn.
-  const int has_description = (reaction_fqn != NULL);
-  int has_container_fqn = 0;
+static inline void unlock_schedule(int trigger) {
+  __atomic_store_n(&trigger_schedules[trigger].lock, 0, __ATOMIC_RELEASE);
+}
 
-  if (reaction_fqn) {
-    otelc_set_string_view_attr(map, "xronos.fqn",
-                               reaction_fqn,
-                               strlen(reaction_fqn));
+/** @brief Whether the tag (time, microstep) is at or after the tag (at_time, at_microstep). */
+static inline int tag_reached(int64_t time, int64_t microstep, int64_t at_time, int64_t at_microstep) {
+  return time > at_time || (time == at_time && microstep >= at_microstep);
+}
 
-    char reaction_name_str[32];
-    snprintf(reaction_name_str, sizeof(reaction_name_str), "%d", reaction_number);
-    otelc_set_string_view_attr(map, "xronos.name",
-                               reaction_name_str,
-                               strlen(reaction_name_str));
+/**
+ * @brief Record a schedule_called as the outstanding schedule of its trigger.
+ *
+ * The scheduling reaction is the innermost reaction running on this thread, if any.
+ *
+ * @param scheduled Receives the schedule described by the record
+ * @return Object table position of the trigger, or -1 if it is not registered
+ */
+static int record_schedule(const thread_state_t* self, const trace_record_nodeps_t* tr,
+                           trigger_schedule_t* scheduled) {
+  description_index_slot_t* slot = find_index_slot(trigger_index, tr->trigger);
+  if (!slot) {
+    return -1;
+  }
+  int trigger = __atomic_load_n(&slot->entry, __ATOMIC_ACQUIRE) - 1;
+  const reaction_span_frame_t* source = self->depth > 0 ? &self->frames[self->depth - 1] : NULL;
+  // A zero delay schedules the trigger at the next microstep at the earliest.
+  *scheduled = (trigger_schedule_t){
+      .state = SCHEDULE_PENDING,
+      .earliest_time = tr->logical_time + tr->extra_delay,
+      .earliest_microstep = tr->extra_delay == 0 ? tr->microstep + 1 : 0,
+      .logical_time = tr->logical_time,
+      .microstep = tr->microstep,
+      .physical_time = tr->physical_time,
+      .source = source ? source->reaction : -1};
 
-    if (reactor_fqn && reactor_fqn[0] != '\0') {
-      otelc_set_string_view_attr(map, "xronos.container_fqn",
-                                 reactor_fqn,
-                                 strlen(reactor_fqn));
-      has_container_fqn = 1;
+  description_index_slot_t* reactor =
+      find_index_slot(description_index, trace._lf_trace_object_descriptions[trigger].pointer);
+  if (reactor) {
+    trigger_schedule_t* schedule = &trigger_schedules[trigger].schedule;
+    lock_schedule(trigger);
+    if (schedule->state != SCHEDULE_PENDING) {
+      if (schedule->state == SCHEDULE_NONE) {
+        __atomic_fetch_add(&reactor->schedules, 1, __ATOMIC_RELAXED);
+      }
+      *schedule = *scheduled;
     }
+    unlock_schedule(trigger);
   }
+  return trigger;
+}
 
-  set_low_cardinality_schema_attr(map, has_description, has_container_fqn);
-
-  otelc_set_span_attrs(span, map);
-  otelc_destroy_attr_map(map);
+/**
+ * @brief Find the trigger that caused a starting reaction among the triggers of its reactor.
+ *
+ * Fires the pending schedules whose earliest tag is reached at the tag of the record and
+ * retires those that fired at an earlier tag. Only called while the reactor has
+ * outstanding schedules.
+ *
+ * @param reactor Pointer index slot of the reaction's reactor
+ * @param cause Receives a copy of the schedule that fired at the tag of the record
+ * @return Object table position of the trigger, or -1 if none fired at that tag
+ */
+static int resolve_trigger(description_index_slot_t* reactor, const trace_record_nodeps_t* tr,
+                           trigger_schedule_t* cause) {
+  int found = -1;
+  for (int32_t next = __atomic_load_n(&reactor->triggers, __ATOMIC_ACQUIRE); next; next = next_trigger[next - 1]) {
+    trigger_schedule_t* schedule = &trigger_schedules[next - 1].schedule;
+    if (__atomic_load_n(&schedule->state, __ATOMIC_RELAXED) == SCHEDULE_NONE) {
+      continue;
+    }
+    lock_schedule(next - 1);
+    if (schedule->state == SCHEDULE_PENDING &&
+        tag_reached(tr->logical_time, tr->microstep, schedule->earliest_time, schedule->earliest_microstep)) {
+      schedule->state = SCHEDULE_RESOLVED;
+      schedule->fired_time = tr->logical_time;
+      schedule->fired_microstep = tr->microstep;
+    }
+    if (schedule->state == SCHEDULE_RESOLVED) {
+      if (schedule->fired_time == tr->logical_time && schedule->fired_microstep == tr->microstep) {
+        if (found < 0) {
+          *cause = *schedule;
+          found = next - 1;
+        }
+      } else if (tag_reached(tr->logical_time, tr->microstep, schedule->fired_time, schedule->fired_microstep)) {
+        schedule->state = SCHEDULE_NONE;
+        __atomic_fetch_sub(&reactor->schedules, 1, __ATOMIC_RELAXED);
+      }
+    }
+    unlock_schedule(next - 1);
+  }
+  return found;
 }
 
 /**
- * @brief Set low-cardinality attributes for a generic (non-reaction) trace event span.
+ * @brief Describe a trigger and its schedule for the exporter.
+ *
+ * @param latency Physical time from the schedule to the reaction, or -1 for the schedule_called itself
  */
-static void set_event_low_cardinality_attributes(void* span) {
-  if (!span) {
+static void describe_trigger(int trigger, const trigger_schedule_t* schedule, int64_t latency,
+                             otel_trigger_info_t* info) {
+  *info = (otel_trigger_info_t){.trigger_fqn = trace._lf_trace_object_descriptions[trigger].description,
+                                .source_fqn = schedule->source >= 0 ? reaction_fqns[schedule->source] : NULL,
+                                .timestamp = schedule->logical_time,
+                                .microstep = schedule->microstep,
+                                .latency = latency};
+}
+
+/** @brief Roll the timeline span of a worker buffer over once its interval has passed. */
+static void update_worker_span(otel_backend_t* backend, int buffer, int64_t physical_time) {
+  worker_span_state_t* state = &worker_spans[buffer + 1];
+  if (state->span && physical_time - state->opened < worker_span_interval) {
     return;
   }
-
-  void* map = otelc_create_attr_map();
-  const char* element_type_value = "trace_event";
-  otelc_set_string_view_attr(map, "xronos.element_type",
-                             element_type_value,
-                             strlen(element_type_value));
-  // Only element_type is set.
-  set_low_cardinality_schema_attr(map, 0, 0);
-  otelc_set_span_attrs(span, map);
-  otelc_destroy_attr_map(map);
+  if (state->span) {
+    otel->end_worker_span(backend, state->span, state->reactions, state->busy);
+  }
+  state->span = otel->start_worker_span(backend, buffer);
+  state->opened = physical_time;
+  state->reactions = 0;
+  state->busy = 0;
 }
 
 /**
- * @brief Find object description by matching pointer
- * 
- * Searches the trace object descriptions table for an entry matching the given pointer.
- * 
- * @param pointer The pointer to match
- * @return Pointer to matching object_description_t, or NULL if not found
+ * @brief Handle a command from the control socket (LF_TRACE_CONTROL_SOCKET).
+ *
+ * Applies the command to a copy of the current configuration and publishes the copy.
+ * The trace mutex serializes this with registration, which sets keep bits in the
+ * current configuration. The replaced configuration is kept until shutdown.
  */
-static object_description_t* find_object_description(void* pointer) {
-  if (!pointer) {
-    return NULL;
+static void handle_control_command(const char* command, char reply[TRACE_CONTROL_REPLY_SIZE]) {
+  char settings[TRACE_CONTROL_REPLY_SIZE - 8];
+  if (strcmp(command, "show") == 0) {
+    trace_config_format(load_config(), settings, sizeof(settings));
+    snprintf(reply, TRACE_CONTROL_REPLY_SIZE, "ok %s", settings);
+    return;
   }
-  
-  for (size_t i = 0; i < trace._lf_trace_object_descriptions_size; i++) {
-    if (trace._lf_trace_object_descriptions[i].pointer == pointer) {
-      return &trace._lf_trace_object_descriptions[i];
+  if (strcmp(command, "memory") == 0) {
+    trace_alloc_stats_t stats;
+    trace_alloc_get_stats(&stats);
+    snprintf(reply, TRACE_CONTROL_REPLY_SIZE,
+             "ok allocations=%llu hugetlb=%llu thp=%llu small=%llu node-local=%llu",
+             (unsigned long long)stats.allocations, (unsigned long long)stats.hugetlb_bytes,
+             (unsigned long long)stats.thp_bytes, (unsigned long long)stats.small_page_bytes,
+             (unsigned long long)stats.node_bytes);
+    return;
+  }
+  if (strcmp(command, "capture") == 0) {
+    if (!flight_enabled) {
+      snprintf(reply, TRACE_CONTROL_REPLY_SIZE, "error: the flight recorder is not enabled");
+      return;
     }
+    flight_recorder_trigger(0, "control command");
+    snprintf(reply, TRACE_CONTROL_REPLY_SIZE, "ok capture requested");
+    return;
   }
-  
-  return NULL;
+
+  lf_platform_mutex_lock(trace_mutex);
+  trace_config_t* current = current_config;
+  trace_config_t* next = trace_config_copy(current);
+  char error[TRACE_CONFIG_ERROR_SIZE];
+  int changes = next ? trace_config_apply_command(next, command, error) : -1;
+  if (!next) {
+    snprintf(error, sizeof(error), "out of memory");
+  }
+  if (changes > 0 && (changes & TRACE_CONFIG_CHANGED_FILTERS)) {
+    for (size_t i = 0; i < trace._lf_trace_object_descriptions_size; i++) {
+      trace_config_update_keep(next, i, &trace._lf_trace_object_descriptions[i]);
+    }
+  }
+  if (changes > 0 && (changes & TRACE_CONFIG_CHANGED_BATCH) && otel && !otel->set_batch_settings) {
+    // The SDK reads OTEL_BSP_* into its process-wide provider once; changing the environment
+    // now would race with the threads reading it.
+    snprintf(error, sizeof(error), "the SDK exporter takes batch settings from OTEL_BSP_* at startup only");
+    changes = -1;
+  } else if (changes > 0 && (changes & TRACE_CONFIG_CHANGED_BATCH) && otel) {
+    // An exporter reads its batch settings when initialized, so create a new one.
+    // The previous exporter keeps exporting the spans already started on it.
+    otel_backend_t* backend = otel->create(current->backend->endpoint, current->backend->application_name,
+                                           current->backend->hostname, current->backend->pid);
+    if (backend) {
+      otel->set_batch_settings(backend, &next->batch);
+    }
+    if (backend && otel->initialize(backend) == 0) {
+      next->backend = backend;
+    } else {
+      if (backend) {
+        otel->destroy(backend);
+      }
+      snprintf(error, sizeof(error), "failed to create an exporter with the new batch settings");
+      changes = -1;
+    }
+  }
+  if (changes < 0) {
+    lf_platform_mutex_unlock(trace_mutex);
+    trace_config_free(next);
+    snprintf(reply, TRACE_CONTROL_REPLY_SIZE, "error: %s", error);
+    return;
+  }
+  next->retired = current;
+  __atomic_store_n(&current_config, next, __ATOMIC_RELEASE);
+  lf_platform_mutex_unlock(trace_mutex);
+
+  trace_config_format(next, settings, sizeof(settings));
+  snprintf(reply, TRACE_CONTROL_REPLY_SIZE, "ok %s", settings);
 }
 
 /**
@@ -258,6 +756,374 @@ static const char* get_event_type_name(int event_type) {
   return "Unknown event";
 }
 
+/** @brief Export a reaction captured by the flight recorder. */
+static void emit_recorded_reaction(otel_backend_t* backend, int worker, const trace_record_nodeps_t* start,
+                                   int64_t end_physical_time) {
+  int description = find_object_description(start->pointer);
+  const object_description_t* reactor_desc =
+      (description >= 0) ? &trace._lf_trace_object_descriptions[description] : NULL;
+  int reaction = find_reaction(start);
+  char* built_fqn = NULL;
+  const char* reaction_fqn =
+      reaction >= 0 ? reaction_fqns[reaction] : (built_fqn = build_reaction_fqn(reactor_desc, start->dst_id));
+  otel->emit_recorded_span(backend, worker, reaction, reaction_span_name(reactor_desc, reaction_fqn), reaction_fqn,
+                           start->dst_id, reactor_desc ? reactor_desc->description : NULL, start, end_physical_time);
+  free(built_fqn);
+}
+
+/**
+ * @brief Handle a flight recorder capture (on the recorder thread).
+ *
+ * Writes the captured records as a trace file and, if the exporter is enabled, exports
+ * every captured event as a span, independent of the event mask and sampling.
+ */
+static void handle_flight_capture(const flight_recorder_snapshot_t* snapshot) {
+  size_t total = 0;
+  for (int i = -1; i < snapshot->num_buffers; i++) {
+    total += snapshot->counts[i];
+  }
+  char filename[TRACE_MAX_FILENAME_LENGTH + 16];
+  snprintf(filename, sizeof(filename), "%s_%u.lft", flight_file_prefix, snapshot->sequence);
+  int written = lft_writer_write_snapshot(&trace, filename, snapshot->num_buffers, snapshot->records,
+                                          snapshot->counts) == 0;
+  lf_print("Flight recorder: captured %zu records around a %s%s%s.", total, snapshot->reason,
+           written ? " into " : "", written ? filename : "");
+  if (snapshot->truncated) {
+    fprintf(stderr, "WARNING: Flight recorder: the capture misses the start of the window. "
+                    "Increase LF_TRACE_FLIGHT_RECORDER_RECORDS.\n");
+  }
+  if (snapshot->lost > 0) {
+    fprintf(stderr, "WARNING: Flight recorder: %zu records were overwritten during the capture.\n", snapshot->lost);
+  }
+
+  otel_backend_t* backend = otel ? load_config()->backend : NULL;
+  if (!backend) {
+    return;
+  }
+  for (int i = -1; i < snapshot->num_buffers; i++) {
+    // Records of a buffer come from one thread, so a reaction_ends follows its reaction_starts.
+    const trace_record_nodeps_t* start = NULL;
+    for (size_t j = 0; j < snapshot->counts[i]; j++) {
+      const trace_record_nodeps_t* tr = &snapshot->records[i][j];
+      if (tr->event_type == reaction_starts) {
+        if (start) {
+          emit_recorded_reaction(backend, i, start, -1);
+        }
+        start = tr;
+      } else if (tr->event_type == reaction_ends) {
+        if (start && start->pointer == tr->pointer && start->dst_id == tr->dst_id) {
+          emit_recorded_reaction(backend, i, start, tr->physical_time);
+          start = NULL;
+        }
+      } else {
+        otel->emit_event_span(backend, i, get_event_type_name(tr->event_type), tr, NULL);
+      }
+    }
+    if (start) {
+      emit_recorded_reaction(backend, i, start, -1);
+    }
+  }
+}
+
+/**
+ * @brief Export the critical path of a tag (on the analysis thread).
+ *
+ * The path is named by the FQNs of its reactions; a path longer than CRITICAL_PATH_MAX_STEPS
+ * starts with "...".
+ */
+static void handle_critical_path(const critical_path_t* path) {
+  otel_backend_t* backend = load_config()->backend;
+  if (!backend) {
+    return;
+  }
+  static char names[4096];
+  size_t used = 0;
+  if (path->length > path->num_steps) {
+    used = (size_t)snprintf(names, sizeof(names), "...");
+  }
+  const char* bottleneck_fqn = NULL;
+  int64_t bottleneck_time = -1;
+  for (int i = 0; i < path->num_steps; i++) {
+    const critical_path_execution_t* step = &path->steps[i];
+    const char* fqn = reaction_fqns[step->reaction] ? reaction_fqns[step->reaction] : "<unknown>";
+    if (used < sizeof(names)) {
+      used += (size_t)snprintf(names + used, sizeof(names) - used, "%s%s", used > 0 ? " -> " : "", fqn);
+    }
+    if (step->end_time - step->start_time > bottleneck_time) {
+      bottleneck_time = step->end_time - step->start_time;
+      bottleneck_fqn = reaction_fqns[step->reaction];
+    }
+  }
+  otel_critical_path_t exported = {.timestamp = path->logical_time,
+                                   .microstep = path->microstep,
+                                   .end_time = path->end_time,
+                                   .path = names,
+                                   .bottleneck_fqn = bottleneck_fqn,
+                                   .length = path->length,
+                                   .reactions = path->executions,
+                                   .latency = path->latency,
+                                   .busy_time = path->busy_time,
+                                   .slack = path->slack};
+  otel->emit_critical_path_span(backend, &exported);
+}
+
+/**
+ * @brief Update a moving average and variance with a new value.
+ *
+ * @param weight Weight of the value: 1/(n+1) for the n-th value, so that the first ones are
+ *        averaged evenly, then 1/OUTLIER_EWMA_SPAN
+ * @param trusted Whether the average covers enough values to flag outliers
+ * @return Whether the value exceeds the previous average by more than k standard deviations
+ */
+static inline int update_moving_average(double* mean, double* variance, double value, double weight, int trusted) {
+  double difference = value - *mean;
+  int outlier =
+      trusted && difference > OUTLIER_MIN_DEVIATION && difference * difference > outlier_threshold * *variance;
+  double increment = weight * difference;
+  *mean += increment;
+  *variance = (1.0 - weight) * (*variance + difference * increment);
+  return outlier;
+}
+
+/**
+ * @brief Read the summary of a reaction's executions since its last summary.
+ *
+ * @return The reaction number
+ */
+static int32_t read_reaction_summary(const reaction_stats_t* stats, otel_reaction_summary_t* summary) {
+  *summary = (otel_reaction_summary_t){.start_time = stats->opened,
+                                       .end_time = stats->closed,
+                                       .executions = stats->executions,
+                                       .outliers = stats->outliers,
+                                       .total_duration = stats->total_duration,
+                                       .max_duration = stats->max_duration,
+                                       .duration_mean = (int64_t)stats->duration_mean,
+                                       .duration_stddev = (int64_t)sqrt(stats->duration_variance),
+                                       .lag_mean = (int64_t)stats->lag_mean,
+                                       .lag_stddev = (int64_t)sqrt(stats->lag_variance)};
+  return stats->reaction_number;
+}
+
+/** @brief Start a new summary. Only the worker running the reaction may call this. */
+static void reset_reaction_summary(reaction_stats_t* stats) {
+  stats->executions = 0;
+  stats->outliers = 0;
+  stats->total_duration = 0;
+  stats->max_duration = 0;
+}
+
+/** @brief Export a summary read by read_reaction_summary(). */
+static void emit_reaction_summary(otel_backend_t* backend, int reaction, int32_t reaction_number,
+                                  const otel_reaction_summary_t* summary) {
+  int description = __atomic_load_n(&reaction_reactors[reaction]->entry, __ATOMIC_ACQUIRE) - 1;
+  otel->emit_reaction_summary_span(backend, reaction, reaction_fqns[reaction], reaction_number,
+                                   description >= 0 ? trace._lf_trace_object_descriptions[description].description
+                                                    : NULL,
+                                   summary);
+}
+
+/**
+ * @brief Export the summaries that are due, including those of reactions that have not run since.
+ *
+ * Runs on the summary thread. An entry that a worker is updating, or updates before it is marked
+ * taken, is left to that worker, which exports the summary itself when it is due.
+ */
+static void sweep_reaction_summaries(otel_backend_t* backend, int64_t now) {
+  int32_t count = __atomic_load_n(&reaction_count, __ATOMIC_ACQUIRE);
+  for (int32_t reaction = 0; reaction < count; reaction++) {
+    reaction_stats_t* stats = &reaction_stats[reaction];
+    uint64_t state = __atomic_load_n(&stats->state, __ATOMIC_ACQUIRE);
+    if ((state & (STATS_TAKEN | STATS_UPDATING)) || stats->executions == 0 ||
+        now - stats->opened < outlier_summary_interval) {
+      continue;
+    }
+    otel_reaction_summary_t summary;
+    int32_t reaction_number = read_reaction_summary(stats, &summary);
+    // Fails if a worker started an update since the load, in which case the copy may be torn.
+    if (__atomic_compare_exchange_n(&stats->state, &state, state | STATS_TAKEN, 0, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_RELAXED)) {
+      emit_reaction_summary(backend, reaction, reaction_number, &summary);
+    }
+  }
+}
+
+static void* summary_main(void* arg) {
+  (void)arg;
+  for (;;) {
+    pthread_mutex_lock(&summary_mutex);
+    if (!summary_stopping) {
+      struct timespec deadline;
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      deadline.tv_sec += outlier_summary_interval / 1000000000LL;
+      deadline.tv_nsec += outlier_summary_interval % 1000000000LL;
+      if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&summary_wake, &summary_mutex, &deadline);
+    }
+    int stop = summary_stopping;
+    pthread_mutex_unlock(&summary_mutex);
+    if (stop) {
+      break;
+    }
+    // Trace records carry LF physical times, which are CLOCK_REALTIME.
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    otel_backend_t* backend = load_config()->backend;
+    if (backend) {
+      sweep_reaction_summaries(backend, (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec);
+    }
+  }
+  return NULL;
+}
+
+/** @brief Start the summary thread. @return 0 on success */
+static int summary_thread_start(void) {
+  pthread_condattr_t attributes;
+  pthread_condattr_init(&attributes);
+  pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+  pthread_cond_init(&summary_wake, &attributes);
+  pthread_condattr_destroy(&attributes);
+  summary_stopping = 0;
+  if (pthread_create(&summary_thread, NULL, summary_main, NULL) != 0) {
+    pthread_cond_destroy(&summary_wake);
+    return -1;
+  }
+  summary_running = 1;
+  return 0;
+}
+
+static void summary_thread_stop(void) {
+  if (summary_running) {
+    pthread_mutex_lock(&summary_mutex);
+    summary_stopping = 1;
+    pthread_cond_signal(&summary_wake);
+    pthread_mutex_unlock(&summary_mutex);
+    pthread_join(summary_thread, NULL);
+    pthread_cond_destroy(&summary_wake);
+    summary_running = 0;
+  }
+}
+
+/**
+ * @brief Feed a reaction execution to the outlier detector of its reaction.
+ *
+ * An execution whose execution time or lag exceeds the moving average by more than k standard
+ * deviations is exported as a span, as if recorded by the flight recorder. The others only count
+ * toward the reaction's summary, exported once per LF_TRACE_OUTLIERS_SUMMARY.
+ */
+static void observe_reaction(otel_backend_t* backend, int worker, int reaction, const trace_record_nodeps_t* end,
+                             int64_t start_time) {
+  reaction_stats_t* stats = &reaction_stats[reaction];
+  int64_t duration = end->physical_time - start_time;
+  // Never waits: the summary thread only marks the entry, and fails to if this update has started.
+  uint64_t state = __atomic_fetch_add(&stats->state, STATS_UPDATING, __ATOMIC_ACQ_REL);
+  if (state & STATS_TAKEN) {
+    reset_reaction_summary(stats);
+  }
+  double weight = stats->samples < OUTLIER_EWMA_SPAN ? 1.0 / (stats->samples + 1) : 1.0 / OUTLIER_EWMA_SPAN;
+  int trusted = stats->samples >= OUTLIER_WARMUP;
+  // Both averages are updated, whichever flags the execution.
+  int outlier =
+      update_moving_average(&stats->duration_mean, &stats->duration_variance, (double)duration, weight, trusted);
+  outlier |= update_moving_average(&stats->lag_mean, &stats->lag_variance, (double)(start_time - end->logical_time),
+                                   weight, trusted);
+  if (stats->samples < OUTLIER_EWMA_SPAN) {
+    stats->samples++;
+  }
+
+  if (stats->executions == 0) {
+    stats->opened = start_time;
+    stats->reaction_number = end->dst_id;
+  }
+  stats->executions++;
+  stats->closed = end->physical_time;
+  stats->total_duration += duration;
+  if (duration > stats->max_duration) {
+    stats->max_duration = duration;
+  }
+  if (outlier) {
+    stats->outliers++;
+  }
+  otel_reaction_summary_t summary;
+  int32_t reaction_number = -1;
+  if (end->physical_time - stats->opened >= outlier_summary_interval) {
+    reaction_number = read_reaction_summary(stats, &summary);
+    reset_reaction_summary(stats);
+  }
+  __atomic_store_n(&stats->state, (state & ~(uint64_t)STATS_TAKEN) + 2 * STATS_UPDATING, __ATOMIC_RELEASE);
+
+  if (outlier) {
+    // The reaction_starts record differs from the reaction_ends record only in these fields.
+    trace_record_nodeps_t start = *end;
+    start.event_type = reaction_starts;
+    start.physical_time = start_time;
+    emit_recorded_reaction(backend, worker, &start, end->physical_time);
+  }
+  if (reaction_number >= 0) {
+    emit_reaction_summary(backend, reaction, reaction_number, &summary);
+  }
+}
+
+/** @brief Parse a signal given as a number or as USR1/USR2 (with or without the SIG prefix). */
+static int parse_signal(const char* text) {
+  if (strncmp(text, "SIG", 3) == 0) {
+    text += 3;
+  }
+  if (strcmp(text, "USR1") == 0) {
+    return SIGUSR1;
+  }
+  if (strcmp(text, "USR2") == 0) {
+    return SIGUSR2;
+  }
+  char* end;
+  long value = strtol(text, &end, 10);
+  return (end != text && *end == '\0' && value > 0 && value < 65) ? (int)value : -1;
+}
+
+/**
+ * @brief Start the flight recorder (LF_TRACE_FLIGHT_RECORDER and related variables).
+ *
+ * @param before_env The pre-trigger window
+ */
+static void start_flight_recorder(const char* before_env, const char* process_name, int fedid) {
+  int64_t before;
+  int64_t after;
+  const char* after_env = getenv("LF_TRACE_FLIGHT_RECORDER_AFTER");
+  if (!after_env || after_env[0] == '\0') {
+    after_env = FLIGHT_RECORDER_AFTER_DEFAULT;
+  }
+  if (trace_config_parse_duration(before_env, &before) != 0 || trace_config_parse_duration(after_env, &after) != 0) {
+    fprintf(stderr, "WARNING: Invalid flight recorder window '%s' / '%s'. The flight recorder is disabled.\n",
+            before_env, after_env);
+    return;
+  }
+  const char* lag_env = getenv("LF_TRACE_FLIGHT_RECORDER_LAG");
+  if (lag_env && lag_env[0] != '\0' && trace_config_parse_duration(lag_env, &flight_lag_threshold) != 0) {
+    fprintf(stderr, "WARNING: Ignoring LF_TRACE_FLIGHT_RECORDER_LAG: expected a duration, got '%s'\n", lag_env);
+    flight_lag_threshold = 0;
+  }
+  int signal_number = 0;
+  const char* signal_env = getenv("LF_TRACE_FLIGHT_RECORDER_SIGNAL");
+  if (signal_env && signal_env[0] != '\0' && (signal_number = parse_signal(signal_env)) < 0) {
+    fprintf(stderr, "WARNING: Ignoring LF_TRACE_FLIGHT_RECORDER_SIGNAL: unknown signal '%s'\n", signal_env);
+    signal_number = 0;
+  }
+  const char* file_env = getenv("LF_TRACE_FLIGHT_RECORDER_FILE");
+  if (file_env && file_env[0] != '\0') {
+    snprintf(flight_file_prefix, sizeof(flight_file_prefix), "%s", file_env);
+  } else {
+    snprintf(flight_file_prefix, sizeof(flight_file_prefix), "%s_%d_flight", process_name ? process_name : "trace",
+             fedid);
+  }
+  const char* records_env = getenv("LF_TRACE_FLIGHT_RECORDER_RECORDS");
+  long long records = records_env ? atoll(records_env) : 0;
+  flight_enabled = (flight_recorder_open((int)trace._lf_number_of_trace_buffers,
+                                         records > 0 ? (uint64_t)records : FLIGHT_RECORDER_RECORDS_DEFAULT, before,
+                                         after, signal_number, handle_flight_capture) == 0);
+}
+
 // IMPLEMENTATION OF VERSION API *********************************************
 
 const version_t* lf_version_tracing() { return &version; }
@@ -273,21 +1139,181 @@ const version_t* lf_version_tracing() { return &version; }
  * @param description The object description to register
  */
 void lf_tracing_register_trace_event(object_description_t description) {
+  LF_TRACE_PROBE_REGISTER(description);
   lf_platform_mutex_lock(trace_mutex);
   
   // Store the description in the table
   if (trace._lf_trace_object_descriptions_size < TRACE_OBJECT_TABLE_SIZE) {
+    // The table holds its own copy of the name, so that it outlives the caller's string and every
+    // use knows its length. Objects of the same name share the copy.
+    if (description.description) {
+      const char* interned = string_arena_intern(description.description);
+      if (!interned) {
+        fprintf(stderr, "WARNING: Out of memory for the name of trace object %s.\n", description.description);
+      }
+      description.description = (char*)interned;
+    }
     trace._lf_trace_object_descriptions[trace._lf_trace_object_descriptions_size] = description;
-    trace._lf_trace_object_descriptions_size++;
+    // The reactor filters are matched here, once per object, rather than on every tracepoint.
+    trace_config_update_keep(current_config, trace._lf_trace_object_descriptions_size, &description);
+    index_object_description(trace._lf_trace_object_descriptions_size);
+    // Published for the flight recorder thread, which writes the table without the mutex.
+    __atomic_store_n(&trace._lf_trace_object_descriptions_size, trace._lf_trace_object_descriptions_size + 1,
+                     __ATOMIC_RELEASE);
+    if (shm_enabled) {
+      shm_ring_register(&description);
+    }
   }
   
   lf_platform_mutex_unlock(trace_mutex);
 }
 
-void lf_tracing_tracepoint(int worker, trace_record_nodeps_t* tr) {
-  (void)worker;
-  // Worker argument determines which buffer to write to.
-  int tid = lf_thread_id();
+/**
+ * @brief Allocate and register the state of the calling thread.
+ *
+ * The state is never freed: the thread may still hold it after shutdown.
+ *
+ * @return The state, or NULL if out of memory (the events of the thread are then dropped)
+ */
+static thread_state_t* register_thread(void) {
+  // On cache lines of its own, since the busy flag is written on every tracepoint.
+  size_t size = (sizeof(thread_state_t) + 63) & ~(size_t)63;
+  void* memory = NULL;
+  if (posix_memalign(&memory, 64, size) != 0) {
+    return NULL;
+  }
+  thread_state_t* self = (thread_state_t*)memory;
+  memset(self, 0, size);
+  self->thread_id = lf_thread_id();
+  lf_platform_mutex_lock(trace_mutex);
+  self->next = all_threads;
+  __atomic_store_n(&all_threads, self, __ATOMIC_RELEASE);
+  lf_platform_mutex_unlock(trace_mutex);
+  this_thread = self;
+  return self;
+}
+
+/** @brief Monotonic clock, for the shutdown deadline. */
+static int64_t monotonic_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/** @brief Let tracepoints skip the full fence before checking ingest_stopped, if the kernel allows. */
+static void register_membarrier(void) {
+#if defined(__linux__) && defined(SYS_membarrier)
+  if (syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0) {
+    tracepoint_fence = 0;
+  }
+#endif
+}
+
+/**
+ * @brief Stop ingest and wait for the threads inside a tracepoint to leave it.
+ *
+ * @param deadline Monotonic time at which to stop waiting
+ * @return Number of threads still inside a tracepoint at the deadline
+ */
+static int stop_ingest(int64_t deadline) {
+  __atomic_store_n(&ingest_stopped, 1, __ATOMIC_SEQ_CST);
+#if defined(__linux__) && defined(SYS_membarrier)
+  if (!tracepoint_fence) {
+    // Every running thread now sees the flag, or has published its busy flag.
+    syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+  }
+#endif
+  for (;;) {
+    int busy = 0;
+    for (thread_state_t* t = __atomic_load_n(&all_threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+      busy += __atomic_load_n(&t->busy, __ATOMIC_ACQUIRE);
+    }
+    if (busy == 0 || monotonic_time() >= deadline) {
+      return busy;
+    }
+    struct timespec pause = {.tv_sec = 0, .tv_nsec = 100000};
+    nanosleep(&pause, NULL);
+  }
+}
+
+/**
+ * @brief End the spans left open by every thread that is not inside a tracepoint.
+ *
+ * Those are reactions that were running when ingest stopped, or whose thread exited (or lost
+ * their reaction_ends) since. They are ended with the `xronos.incomplete` marker.
+ *
+ * @param lost Incremented by the number of open spans of threads still inside a tracepoint
+ * @return Number of spans ended
+ */
+static uint64_t end_open_spans(otel_backend_t* backend, uint64_t* lost) {
+  uint64_t ended = 0;
+  for (thread_state_t* t = __atomic_load_n(&all_threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+    int busy = __atomic_load_n(&t->busy, __ATOMIC_ACQUIRE);
+    for (int i = t->depth - 1; i >= 0; i--) {
+      if (!t->frames[i].span) {
+        continue;
+      }
+      if (busy) {
+        (*lost)++;
+      } else {
+        otel->end_incomplete_span(backend, t->frames[i].span);
+        ended++;
+      }
+    }
+    if (!busy) {
+      t->depth = 0;
+      t->overflow = 0;
+    }
+  }
+  return ended;
+}
+
+/**
+ * @brief Record an event in every enabled sink.
+ *
+ * @param self The state of the calling thread
+ * @param tr The trace record
+ */
+static inline void trace_event(thread_state_t* self, trace_record_nodeps_t* tr) {
+  const trace_config_t* config = load_config();
+
+  // Events outside the logical time window (LF_TRACE_WINDOW) end here, before any other work.
+  // Then events of reactors dropped by LF_TRACE_INCLUDE/LF_TRACE_EXCLUDE, after one index lookup.
+  // The exception to both is a reaction_ends that must close a span opened before the window
+  // closed or the filters changed.
+  if (config->windowed && !trace_config_in_window(config, tr->logical_time - start_time) &&
+      !(tr->event_type == reaction_ends && span_stack_find(self, tr) >= 0)) {
+    return;
+  }
+  // A starting reaction is resolved to its ID once, which also finds its reactor. The ID is
+  // assigned on first sight, before the mutex of the fallback buffer is taken.
+  int reaction = -1;
+  int description = -1;
+  if (otel && tr->event_type == reaction_starts) {
+    if ((reaction = find_reaction(tr)) < 0) {
+      reaction = register_reaction(tr);
+    }
+    if (reaction >= 0) {
+      description = reaction_reactors[reaction]->entry - 1;
+    }
+  }
+  if (config->include || config->exclude) {
+    if (description < 0) {
+      description = find_object_description(tr->pointer);
+    }
+    if (description >= 0 && !trace_config_keeps(config, (size_t)description) &&
+        !(tr->event_type == reaction_ends && span_stack_find(self, tr) >= 0)) {
+      return;
+    }
+  }
+
+  // The LF thread ID determines which buffer to write to.
+  int tid = self->thread_id;
+  if ((lft_enabled || shm_enabled || ctf_enabled || flight_enabled || critical_path_enabled || worker_spans) &&
+      tid >= (int)trace._lf_number_of_trace_buffers) {
+    // Out of range of the per-thread buffers; share the fallback buffer like a user thread.
+    tid = -1;
+  }
   if (tid < 0) {
     // The current thread was created by the user. It is not managed by LF, its ID is not known,
     // and most importantly it does not count toward the limit on the total number of threads.
@@ -295,23 +1321,27 @@ void lf_tracing_tracepoint(int worker, trace_record_nodeps_t* tr) {
     lf_platform_mutex_lock(trace_mutex);
   }
 
-  // Use the stored tracer (should be initialized in lf_tracing_global_init)
-  if (!tracer) {
-    tracer = otelc_get_tracer();
+  // The binary trace file records every event, independent of what is exported as spans.
+  if (lft_enabled) {
+    lft_writer_record(&trace, tid, tr);
   }
-  
-  if (!tr) {
-    if (tid < 0) {
-      lf_platform_mutex_unlock(trace_mutex);
+  if (shm_enabled) {
+    shm_ring_record(tid, tr);
+  }
+  if (ctf_enabled) {
+    ctf_writer_record(tid, tr);
+  }
+  if (flight_enabled) {
+    flight_recorder_record(tid, tr);
+    if (tr->event_type == reaction_deadline_missed) {
+      flight_recorder_trigger(tr->physical_time, "deadline miss");
+    } else if (flight_lag_threshold > 0 && tr->event_type == reaction_starts &&
+               tr->physical_time - tr->logical_time > flight_lag_threshold) {
+      flight_recorder_trigger(tr->physical_time, "lag spike");
     }
-    return;
   }
-  
-  // Check if this is a reaction event (reaction_starts or reaction_ends)
-  int is_reaction_event = (tr->event_type == reaction_starts || tr->event_type == reaction_ends);
-  
-  // If trace_only_reactions is enabled, skip non-reaction events
-  if (trace_only_reactions && !is_reaction_event) {
+
+  if (!otel) {
     if (tid < 0) {
       lf_platform_mutex_unlock(trace_mutex);
     }
@@ -319,51 +1349,98 @@ void lf_tracing_tracepoint(int worker, trace_record_nodeps_t* tr) {
   }
 
   // Fast-path: reaction_ends ends the span that was started on reaction_starts.
-  // Do this before any name/attribute computation to avoid unnecessary work.
+  // Do this before any name/attribute computation to avoid unnecessary work, and
+  // independent of the event mask, which may have changed since the span started.
+  if (worker_spans) {
+    update_worker_span(config->backend, tid, tr->physical_time);
+  }
   if (tr->event_type == reaction_ends) {
-    if (active_reaction_span) {
-      // Even if mismatched, end to avoid leaking spans.
-      otelc_end_span(active_reaction_span);
+    int64_t reaction_start;
+    int depth = span_stack_pop(self, config->backend, tr, &reaction_start);
+    if (critical_path_enabled && depth == 0 && self->frames[0].reaction >= 0) {
+      critical_path_record(tid, self->frames[0].reaction, tr, reaction_start);
+    }
+    if (reaction_stats && depth >= 0 && self->frames[depth].reaction >= 0) {
+      observe_reaction(config->backend, tid, self->frames[depth].reaction, tr, reaction_start);
+    }
+    if (worker_spans && depth >= 0) {
+      worker_span_state_t* state = &worker_spans[tid + 1];
+      state->reactions++;
+      if (depth == 0) {
+        state->busy += tr->physical_time - reaction_start;
+      }
     }
-    active_reaction_span = NULL;
-    active_reaction_pointer = NULL;
-    active_reaction_dst_id = -1;
-
     if (tid < 0) {
       lf_platform_mutex_unlock(trace_mutex);
     }
     return;
   }
   
+  // Causality: a schedule_called becomes the outstanding schedule of its trigger, whether or not
+  // it is exported, and a reaction of a reactor with outstanding schedules looks for the trigger
+  // that fired at its tag. Reactors without outstanding schedules cost one index lookup.
+  trigger_schedule_t cause;
+  int trigger = -1;
+  description_index_slot_t* reactor_slot = NULL;
+  if (tr->event_type == schedule_called) {
+    trigger = record_schedule(self, tr, &cause);
+  } else if (tr->event_type == reaction_starts) {
+    reactor_slot = reaction >= 0 ? reaction_reactors[reaction] : find_index_slot(description_index, tr->pointer);
+    if (reactor_slot && __atomic_load_n(&reactor_slot->schedules, __ATOMIC_RELAXED) > 0) {
+      trigger = resolve_trigger(reactor_slot, tr, &cause);
+    }
+  }
+
+  // Only the event types in the mask are exported (by default reaction_starts and reaction_ends).
+  // A reaction that is not exported still gets a frame, so that its end finds its start.
+  if (tr->event_type < 0 || tr->event_type >= 64 || !((config->event_mask >> tr->event_type) & 1)) {
+    if (tr->event_type == reaction_starts) {
+      span_stack_push(self, NULL, reaction, tr);
+    }
+    if (tid < 0) {
+      lf_platform_mutex_unlock(trace_mutex);
+    }
+    return;
+  }
+
   if (tr->event_type == reaction_starts) {
-    // Reaction span start: name it "<reactor_fqn>.<reaction_number>" when possible.
-    object_description_t* reactor_desc = find_object_description(tr->pointer);
-    char* reaction_fqn = build_reaction_fqn(reactor_desc, tr->dst_id);
-    const char* span_name =
-        (reaction_fqn != NULL) ? reaction_fqn :
-        (reactor_desc && reactor_desc->description && reactor_desc->description[0] != '\0')
-            ? reactor_desc->description
-            : "reaction";
-
-    void* span = otelc_start_span(tracer, span_name, OTELC_SPAN_KIND_INTERNAL, "");
-    set_reaction_low_cardinality_attributes(span,
-                                           reaction_fqn,
-                                           tr->dst_id,
-                                           (reactor_desc ? reactor_desc->description : NULL));
-    set_common_high_cardinality_attributes(span, tr);
-
-    // Stash span to be ended by reaction_ends. End any previous active span to avoid leaks.
-    if (active_reaction_span) {
-      otelc_end_span(active_reaction_span);
-    }
-    active_reaction_span = span;
-    active_reaction_pointer = tr->pointer;
-    active_reaction_dst_id = tr->dst_id;
-
-    if (reaction_fqn) {
-      free(reaction_fqn);
+    if (description < 0 && reactor_slot) {
+      description = __atomic_load_n(&reactor_slot->entry, __ATOMIC_ACQUIRE) - 1;
+    }
+    const object_description_t* reactor_desc =
+        (description >= 0) ? &trace._lf_trace_object_descriptions[description] : NULL;
+    // With the outlier detector, reactions are exported when they end, and only if they are outliers.
+    // Reactions without an ID have no detector, so their spans are exported as without it.
+    if ((reaction_stats && reaction >= 0) ||
+        (config->sample_period > 1 && (self->sample_counter++ % config->sample_period) != 0) ||
+        self->depth == REACTION_SPAN_STACK_DEPTH) {
+      span_stack_push(self, NULL, reaction, tr);
+      if (tid < 0) {
+        lf_platform_mutex_unlock(trace_mutex);
+      }
+      return;
     }
 
+    // Reaction span start: name it "<reactor_fqn>.<reaction_number>" when possible. Reactions
+    // without an ID build the name for every span.
+    char* built_fqn = NULL;
+    const char* reaction_fqn =
+        reaction >= 0 ? reaction_fqns[reaction] : (built_fqn = build_reaction_fqn(reactor_desc, tr->dst_id));
+    const char* span_name = reaction_span_name(reactor_desc, reaction_fqn);
+
+    otel_trigger_info_t trigger_info;
+    if (trigger >= 0) {
+      describe_trigger(trigger, &cause, tr->physical_time - cause.physical_time, &trigger_info);
+    }
+
+    void* span = otel->start_reaction_span(config->backend, self->thread_id, reaction, span_name, reaction_fqn,
+                                           tr->dst_id, (reactor_desc ? reactor_desc->description : NULL), tr,
+                                           (trigger >= 0) ? &trigger_info : NULL);
+    free(built_fqn);
+
+    // Stash span to be ended by the matching reaction_ends.
+    span_stack_push(self, span, reaction, tr);
+
     if (tid < 0) {
       lf_platform_mutex_unlock(trace_mutex);
     }
@@ -371,17 +1448,49 @@ void lf_tracing_tracepoint(int worker, trace_record_nodeps_t* tr) {
   }
 
   // Non-reaction event (only emitted if LF_TRACE_VERBOSE=1).
-  const char* event_type_name = get_event_type_name(tr->event_type);
-  void* span = otelc_start_span(tracer, event_type_name, OTELC_SPAN_KIND_INTERNAL, "");
-  set_event_low_cardinality_attributes(span);
-  set_common_high_cardinality_attributes(span, tr);
-  otelc_end_span(span);
+  otel_trigger_info_t trigger_info;
+  if (trigger >= 0) {
+    describe_trigger(trigger, &cause, -1, &trigger_info);
+  }
+  otel->emit_event_span(config->backend, self->thread_id, get_event_type_name(tr->event_type), tr,
+                        (trigger >= 0) ? &trigger_info : NULL);
 
   if (tid < 0) {
     lf_platform_mutex_unlock(trace_mutex);
   }
 }
 
+void lf_tracing_tracepoint(int worker, trace_record_nodeps_t* tr) {
+  if (!tr) {
+    return;
+  }
+  // Ahead of every sink and filter, so that external tools see all events even with the exporter disabled.
+  LF_TRACE_PROBE_TRACEPOINT(worker, tr);
+  thread_state_t* self = this_thread;
+  if (!self) {
+    if (__atomic_load_n(&ingest_stopped, __ATOMIC_RELAXED)) {
+      __atomic_fetch_add(&dropped_after_stop, 1, __ATOMIC_RELAXED);
+      return;
+    }
+    if (!(self = register_thread())) {
+      return;
+    }
+  }
+  // The busy flag is published before ingest_stopped is read; see stop_ingest().
+  __atomic_store_n(&self->busy, 1, __ATOMIC_RELAXED);
+  if (tracepoint_fence) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  } else {
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  }
+  if (__atomic_load_n(&ingest_stopped, __ATOMIC_RELAXED)) {
+    __atomic_fetch_add(&dropped_after_stop, 1, __ATOMIC_RELAXED);
+  } else {
+    trace_event(self, tr);
+  }
+  __atomic_store_n(&self->busy, 0, __ATOMIC_RELEASE);
+}
+
 void lf_tracing_global_init(char* process_name, char* process_names, int fedid, int max_num_local_threads) {
   (void)process_names;
   trace_mutex = lf_platform_mutex_new();
@@ -390,45 +1499,303 @@ void lf_tracing_global_init(char* process_name, char* process_names, int fedid,
     exit(1);
   }
 
-  // Check environment variable to control verbose tracing
-  // Default: trace only reaction events (trace_only_reactions = 1)
-  // Set LF_TRACE_VERBOSE=1 to trace all events (including non-reaction events)
-  const char* verbose_env = getenv("LF_TRACE_VERBOSE");
-  if (verbose_env && strcmp(verbose_env, "1") == 0) {
-    trace_only_reactions = 0;  // Enable verbose mode: trace all events
+  // Event mask (LF_TRACE_VERBOSE, LF_TRACE_EVENTS) and sampling (LF_TRACE_SAMPLE).
+  current_config = trace_config_from_env();
+  if (!current_config) {
+    fprintf(stderr, "WARNING: Failed to allocate the trace configuration.\n");
+    exit(1);
+  }
+
+  trace._lf_number_of_trace_buffers = (size_t)(max_num_local_threads > 0 ? max_num_local_threads : 0);
+  ingest_stopped = 0;
+  register_membarrier();
+
+  // How long shutdown may wait for tracepoints to finish and for the sinks to drain.
+  const char* timeout_env = getenv("LF_TRACE_SHUTDOWN_TIMEOUT");
+  if (!timeout_env || trace_config_parse_duration(timeout_env, &shutdown_timeout) != 0 || shutdown_timeout < 0) {
+    if (timeout_env) {
+      fprintf(stderr, "WARNING: Ignoring LF_TRACE_SHUTDOWN_TIMEOUT: expected a duration, got '%s'\n", timeout_env);
+    }
+    trace_config_parse_duration(SHUTDOWN_TIMEOUT_DEFAULT, &shutdown_timeout);
+  }
+
+  // Huge pages for the rings of the shared-memory sink and the flight recorder.
+  const char* huge_pages_env = getenv("LF_TRACE_HUGE_PAGES");
+  if (trace_alloc_configure(huge_pages_env) != 0) {
+    fprintf(stderr, "WARNING: Ignoring LF_TRACE_HUGE_PAGES: expected 0, 1 or thp, got '%s'\n", huge_pages_env);
+  }
+
+  // Optionally keep the latest records of each worker in shared memory for external readers.
+  const char* shm_env = getenv("LF_TRACE_SHM");
+  if (shm_env && shm_env[0] != '\0') {
+    const char* records_env = getenv("LF_TRACE_SHM_RECORDS");
+    long long records = records_env ? atoll(records_env) : 0;
+    shm_enabled = (shm_ring_open(shm_env, (int)trace._lf_number_of_trace_buffers,
+                                 records > 0 ? (uint64_t)records : SHM_RING_RECORDS_DEFAULT) == 0);
+  }
+
+  // Optionally write a CTF trace for Trace Compass and babeltrace.
+  // LF_TRACE_CTF=1 names its directory after the process; any other value is the directory.
+  const char* ctf_env = getenv("LF_TRACE_CTF");
+  if (ctf_env && ctf_env[0] != '\0' && strcmp(ctf_env, "0") != 0) {
+    char directory[TRACE_MAX_FILENAME_LENGTH];
+    if (strcmp(ctf_env, "1") != 0) {
+      snprintf(directory, sizeof(directory), "%s", ctf_env);
+    } else {
+      snprintf(directory, sizeof(directory), "%s_%d_ctf", process_name ? process_name : "trace", fedid);
+    }
+    ctf_enabled = (ctf_writer_open(directory, (int)trace._lf_number_of_trace_buffers, process_name) == 0);
+  }
+
+  // Optionally write the LF binary trace (.lft) alongside the OpenTelemetry export.
+  // LF_TRACE_FILE=1 uses the same file name as the default LF trace plugin; any other value is a file name.
+  const char* file_env = getenv("LF_TRACE_FILE");
+  const char* exporter_env = getenv("LF_TRACE_EXPORTER");
+  int builtin_exporter = exporter_env && strcmp(exporter_env, "otlp-http") == 0;
+  if (exporter_env && !builtin_exporter && strcmp(exporter_env, "sdk") != 0) {
+    fprintf(stderr, "WARNING: Ignoring LF_TRACE_EXPORTER: expected sdk or otlp-http, got '%s'\n", exporter_env);
+  }
+#ifdef LF_TRACE_NO_OTEL
+  // Without an exporter, the trace file is the default sink.
+  if (!file_env && !shm_enabled && !ctf_enabled && !builtin_exporter) {
+    file_env = "1";
+  }
+#endif
+  if (file_env && file_env[0] != '\0' && strcmp(file_env, "0") != 0) {
+    char filename[TRACE_MAX_FILENAME_LENGTH];
+    if (strcmp(file_env, "1") != 0) {
+      snprintf(filename, sizeof(filename), "%s", file_env);
+    } else if (process_name && strcmp(process_name, "rti") == 0) {
+      snprintf(filename, sizeof(filename), "%s.lft", process_name);
+    } else {
+      snprintf(filename, sizeof(filename), "%s_%d.lft", process_name ? process_name : "trace", fedid);
+    }
+    lft_enabled = (lft_writer_open(&trace, filename, max_num_local_threads) == 0);
+  }
+
+  // Optionally keep the latest records of each worker in memory and capture them around anomalies.
+  const char* flight_env = getenv("LF_TRACE_FLIGHT_RECORDER");
+  if (flight_env && flight_env[0] != '\0' && strcmp(flight_env, "0") != 0) {
+    start_flight_recorder(flight_env, process_name, fedid);
+  }
+
+  // Settings can be changed at runtime through a control socket.
+  const char* control_env = getenv("LF_TRACE_CONTROL_SOCKET");
+  if (control_env && control_env[0] != '\0') {
+    trace_control_start(control_env, handle_control_command);
+  }
+
+  // The exporter is on by default. With LF_TRACE_OTEL=0 it is never loaded, which in the
+  // shared-exporter build also means that its library is never opened.
+  const char* otel_env = getenv("LF_TRACE_OTEL");
+  if (otel_env && strcmp(otel_env, "0") == 0) {
+    return;
+  }
+  // The built-in exporter encodes spans itself and needs neither the SDK nor its library.
+  otel = builtin_exporter ? &otlp_exporter_ops : otel_backend_load();
+  if (!otel) {
+#ifndef LF_TRACE_NO_OTEL
+    fprintf(stderr, "WARNING: OpenTelemetry exporter is not available. No spans will be exported.\n");
+#endif
+    return;
   }
 
   // Create backend
   const char* otel_endpoint = getenv("TRACE_PLUGIN_ENDPOINT");
   if (!otel_endpoint || otel_endpoint[0] == '\0') {
-    otel_endpoint = OTEL_ENDPOINT_DEFAULT;
+    otel_endpoint = builtin_exporter ? OTLP_EXPORTER_ENDPOINT_DEFAULT : OTEL_ENDPOINT_DEFAULT;
   }
-  backend = otel_backend_create(
+  otel_backend_t* backend = otel->create(
     otel_endpoint,
     "LF",
     "lf-lang.org",
     getpid()
   );
 
-  // Initialize (configures exporter and tracer provider)
-  if (otel_backend_initialize(backend) != 0) {
-    // Handle error
+  // Initialize (configures exporter and tracer provider, and gets the tracer)
+  if (!backend || otel->initialize(backend) != 0) {
+    fprintf(stderr, "WARNING: Failed to initialize the OpenTelemetry exporter. No spans will be exported.\n");
+    if (backend) {
+      otel->destroy(backend);
+    }
+    otel = NULL;
+    return;
+  }
+  current_config->backend = backend;
+
+  // Optionally give every worker a timeline span that rolls over every interval.
+  const char* worker_spans_env = getenv("LF_TRACE_WORKER_SPANS");
+  if (worker_spans_env && worker_spans_env[0] != '\0' && strcmp(worker_spans_env, "0") != 0) {
+    void* memory = NULL;
+    if (trace_config_parse_duration(worker_spans_env, &worker_span_interval) != 0 || worker_span_interval <= 0) {
+      fprintf(stderr, "WARNING: Ignoring LF_TRACE_WORKER_SPANS: expected an interval, got '%s'\n", worker_spans_env);
+    } else if (posix_memalign(&memory, 64, (trace._lf_number_of_trace_buffers + 1) * sizeof(worker_span_state_t)) ==
+               0) {
+      memset(memory, 0, (trace._lf_number_of_trace_buffers + 1) * sizeof(worker_span_state_t));
+      worker_spans = (worker_span_state_t*)memory;
+    }
+  }
+
+  // Optionally export only the reaction executions that are outliers, and summaries of the others.
+  const char* outliers_env = getenv("LF_TRACE_OUTLIERS");
+  if (outliers_env && outliers_env[0] != '\0' && strcmp(outliers_env, "0") != 0) {
+    char* end;
+    double sigmas = strtod(outliers_env, &end);
+    const char* summary_env = getenv("LF_TRACE_OUTLIERS_SUMMARY");
+    if (!summary_env || summary_env[0] == '\0') {
+      summary_env = OUTLIER_SUMMARY_DEFAULT;
+    }
+    void* memory = NULL;
+    if (end == outliers_env || *end != '\0' || !(sigmas > 0)) {
+      fprintf(stderr, "WARNING: Ignoring LF_TRACE_OUTLIERS: expected a number of standard deviations, got '%s'\n",
+              outliers_env);
+    } else if (trace_config_parse_duration(summary_env, &outlier_summary_interval) != 0 ||
+               outlier_summary_interval <= 0) {
+      fprintf(stderr, "WARNING: Ignoring LF_TRACE_OUTLIERS: LF_TRACE_OUTLIERS_SUMMARY is not an interval: '%s'\n",
+              summary_env);
+    } else if (posix_memalign(&memory, 64, REACTION_TABLE_SIZE * sizeof(reaction_stats_t)) == 0) {
+      memset(memory, 0, REACTION_TABLE_SIZE * sizeof(reaction_stats_t));
+      outlier_threshold = sigmas * sigmas;
+      reaction_stats = (reaction_stats_t*)memory;
+      if (summary_thread_start() != 0) {
+        fprintf(stderr, "WARNING: Failed to start the summary thread; the summaries of reactions that stop "
+                        "running are exported at shutdown.\n");
+      }
+    }
   }
 
-  // Get tracer once and store it for reuse
-  tracer = otelc_get_tracer();
+  // Optionally analyze the critical path of every tag and export it. LF_TRACE_CRITICAL_PATH=1
+  // exports every tag; an interval exports the tag with the largest latency in each interval.
+  const char* critical_path_env = getenv("LF_TRACE_CRITICAL_PATH");
+  if (critical_path_env && critical_path_env[0] != '\0' && strcmp(critical_path_env, "0") != 0) {
+    int64_t interval = 0;
+    if (strcmp(critical_path_env, "1") != 0 &&
+        (trace_config_parse_duration(critical_path_env, &interval) != 0 || interval <= 0)) {
+      fprintf(stderr, "WARNING: Ignoring LF_TRACE_CRITICAL_PATH: expected 1 or an interval, got '%s'\n",
+              critical_path_env);
+    } else {
+      critical_path_enabled =
+          (critical_path_open((int)trace._lf_number_of_trace_buffers, interval, handle_critical_path) == 0);
+    }
+  }
 }
 
-void lf_tracing_set_start_time(int64_t time) { start_time = time; }
+void lf_tracing_set_start_time(int64_t time) {
+  start_time = time;
+  lft_writer_set_start_time(time);
+  shm_ring_set_start_time(time);
+  ctf_writer_set_start_time(time);
+}
 
 void lf_tracing_global_shutdown() {
-  // Destroy tracer if it was created
-  if (tracer) {
-    otelc_destroy_tracer(tracer);
-    tracer = NULL;
+  // Everything below shares one deadline (LF_TRACE_SHUTDOWN_TIMEOUT): waiting for tracepoints
+  // in progress, draining the sinks and flushing the exporter.
+  int64_t deadline = monotonic_time() + shutdown_timeout;
+  trace_control_stop();
+  int busy_threads = stop_ingest(deadline);
+  if (unmatched_starts || unmatched_ends || overflowed_starts) {
+    fprintf(stderr,
+            "WARNING: Reaction spans: %llu ended without their reaction_ends, %llu reaction_ends without a start, "
+            "%llu reactions nested deeper than %d not exported.\n",
+            (unsigned long long)unmatched_starts, (unsigned long long)unmatched_ends,
+            (unsigned long long)overflowed_starts, REACTION_SPAN_STACK_DEPTH);
   }
-  
-  // Cleanup backend
-  otel_backend_destroy(backend);
+  if (busy_threads) {
+    // Those threads may still record into every sink and use the exporter and the configuration,
+    // and the deadline has passed, so leave all of them in place without draining them.
+    fprintf(stderr,
+            "WARNING: Trace shutdown: %d threads still in a tracepoint at the deadline; the trace sinks and the "
+            "exporter were left open without draining them.\n",
+            busy_threads);
+    return;
+  }
+  // A pending capture is taken now, while the exporter is still available.
+  if (flight_enabled) {
+    flight_enabled = 0;
+    flight_recorder_close();
+  }
+  if (lft_enabled) {
+    lft_writer_close(&trace);
+    lft_enabled = 0;
+  }
+  if (shm_enabled) {
+    shm_ring_close();
+    shm_enabled = 0;
+  }
+  if (ctf_enabled) {
+    ctf_writer_close(trace._lf_trace_object_descriptions, trace._lf_trace_object_descriptions_size);
+    ctf_enabled = 0;
+  }
+
+  uint64_t incomplete = 0;
+  uint64_t lost_spans = 0;
+  int flushed = 1;
+  if (otel) {
+    // The tags still pending are analyzed and exported before the flush.
+    if (critical_path_enabled) {
+      critical_path_enabled = 0;
+      critical_path_close();
+    }
+    incomplete = end_open_spans(current_config->backend, &lost_spans);
+    if (reaction_stats) {
+      // The workers are out of the tracepoints, so the last summaries are read as they are.
+      summary_thread_stop();
+      for (int32_t reaction = 0; reaction < reaction_count; reaction++) {
+        const reaction_stats_t* stats = &reaction_stats[reaction];
+        if (stats->executions > 0 && !(stats->state & STATS_TAKEN)) {
+          otel_reaction_summary_t summary;
+          int32_t reaction_number = read_reaction_summary(stats, &summary);
+          emit_reaction_summary(current_config->backend, reaction, reaction_number, &summary);
+        }
+      }
+    }
+    if (worker_spans) {
+      for (size_t i = 0; i <= trace._lf_number_of_trace_buffers; i++) {
+        if (worker_spans[i].span) {
+          otel->end_worker_span(current_config->backend, worker_spans[i].span, worker_spans[i].reactions,
+                                worker_spans[i].busy);
+          worker_spans[i].span = NULL;
+        }
+      }
+    }
+    // Export what the batch processor still holds, within what is left of the deadline.
+    int64_t remaining = deadline - monotonic_time();
+    flushed = remaining > 0 && otel->flush(current_config->backend, remaining) == 0;
+  }
+
+  uint64_t dropped = __atomic_load_n(&dropped_after_stop, __ATOMIC_RELAXED);
+  if (incomplete) {
+    fprintf(stderr, "WARNING: Trace shutdown: %llu reaction spans still open were ended as incomplete.\n",
+            (unsigned long long)incomplete);
+  }
+  if (dropped || lost_spans || !flushed) {
+    fprintf(stderr,
+            "WARNING: Trace shutdown: %llu events after shutdown dropped, %llu open spans lost%s.\n",
+            (unsigned long long)dropped, (unsigned long long)lost_spans,
+            flushed ? "" : ", and the exporter did not flush within LF_TRACE_SHUTDOWN_TIMEOUT");
+  }
+
+  // Cleanup the exporters (also destroys the tracers). Consecutive configurations share an
+  // exporter unless the batch settings changed in between.
+  free(worker_spans);
+  worker_spans = NULL;
+  free(reaction_stats);
+  reaction_stats = NULL;
+  if (otel) {
+    otel_backend_t* destroyed = NULL;
+    for (trace_config_t* config = current_config; config; config = config->retired) {
+      if (config->backend && config->backend != destroyed) {
+        destroyed = config->backend;
+        otel->destroy(destroyed);
+      }
+    }
+    otel = NULL;
+  }
+  trace_config_free(current_config);
+  current_config = NULL;
+  // The reaction FQNs are interned in the arena.
+  memset(reaction_index, 0, sizeof(reaction_index));
+  reaction_count = 0;
+  string_arena_free();
   lf_platform_mutex_free(trace_mutex);
 }
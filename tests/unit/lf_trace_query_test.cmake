@@ -0,0 +1,69 @@
+# SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+# SPDX-License-Identifier: BSD-3-Clause
+
+# Runs lf-trace-query on the trace written by lft-fixture and checks its output.
+#
+# Invoked by ctest as
+#   cmake -DFIXTURE=<lft-fixture> -DQUERY=<lf-trace-query> -DWORK_DIR=<dir> -P lf_trace_query_test.cmake
+
+set(TRACE "${WORK_DIR}/fixture.lft")
+file(REMOVE "${TRACE}" "${TRACE}.idx")
+execute_process(COMMAND "${FIXTURE}" "${TRACE}" RESULT_VARIABLE result)
+if(NOT result EQUAL 0 OR NOT EXISTS "${TRACE}" OR NOT EXISTS "${TRACE}.idx")
+  message(FATAL_ERROR "lft-fixture did not write ${TRACE} and its index (${result})")
+endif()
+
+# Run lf-trace-query with the given arguments; the output goes to `out`.
+function(query out)
+  execute_process(COMMAND "${QUERY}" ${ARGN} "${TRACE}" RESULT_VARIABLE result OUTPUT_VARIABLE output
+                  ERROR_VARIABLE errors)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "lf-trace-query ${ARGN} failed (${result}): ${errors}")
+  endif()
+  set(${out} "${output}" PARENT_SCOPE)
+endfunction()
+
+# Fail unless `text` matches `regex`.
+function(expect name text regex)
+  if(NOT text MATCHES "${regex}")
+    message(FATAL_ERROR "${name}: expected a match for '${regex}' in:\n${text}")
+  endif()
+endfunction()
+
+# Statistics, with the index and, by scanning the blocks, without it; with one and several threads.
+set(stats_a "Main\\.a\\.0 +3000 +3000000 +1000 +0 +1000 +1000\n")
+set(stats_b "Main\\.b\\.1 +3000 +9000000 +3000 +0 +3000 +3000\n")
+foreach(threads 1 4)
+  query(output --stats --threads ${threads})
+  expect("stats (${threads} threads)" "${output}" "${stats_a}")
+  expect("stats (${threads} threads)" "${output}" "${stats_b}")
+endforeach()
+file(RENAME "${TRACE}.idx" "${TRACE}.idx.saved")
+query(output --stats)
+file(RENAME "${TRACE}.idx.saved" "${TRACE}.idx")
+expect("stats without index" "${output}" "${stats_a}")
+expect("stats without index" "${output}" "${stats_b}")
+
+# A window of logical time and a reactor filter.
+query(output --stats --from 1s --to 2s)
+expect("window" "${output}" "Main\\.a\\.0 +1000 +1000000 ")
+expect("window" "${output}" "Main\\.b\\.1 +1000 +3000000 ")
+query(output --stats --reactor Main.b)
+if(output MATCHES "Main\\.a")
+  message(FATAL_ERROR "reactor filter: Main.a is not filtered out:\n${output}")
+endif()
+expect("reactor filter" "${output}" "${stats_b}")
+
+# Listing: the header, then one CSV line per matching record.
+query(output --list --reactor Main.a --event "Reaction starts" --from 10ms --to 13ms)
+string(REGEX MATCHALL "[^\n]+" lines "${output}")
+list(LENGTH lines count)
+if(NOT count EQUAL 4)
+  message(FATAL_ERROR "list: expected a header and 3 records, got ${count} lines:\n${output}")
+endif()
+list(GET lines 0 header)
+expect("list header" "${header}" "^Event,Reactor,Source,Destination,Elapsed Logical Time,")
+list(GET lines 1 first)
+expect("list record" "${first}" "^Reaction starts,Main\\.a,0,0,10000000,0,10010000,0$")
+query(output --list --event "Schedule called")
+expect("list schedule" "${output}" "\nSchedule called,Main\\.a,0,0,0,0,0,0\n")
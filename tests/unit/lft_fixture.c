@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file lft_fixture.c
+ * @brief Write a small trace file with known contents through the plugin
+ *
+ * Usage: lft-fixture <trace.lft>
+ *
+ * Two workers execute FIXTURE_EXECUTIONS reactions each, one per millisecond of logical
+ * time: Main.a's reaction 0 takes 1000 ns and Main.b's reaction 1 takes 3000 ns. Worker 0
+ * starts with a single schedule_called record, so that its reaction_starts and
+ * reaction_ends records straddle the boundaries of the file's blocks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trace.h"
+#include "trace_types.h"
+#include "bench_platform.h"
+
+/** Reaction executions per worker; several blocks of TRACE_BUFFER_CAPACITY records each. */
+#define FIXTURE_EXECUTIONS 3000
+
+static char reactor_a;
+static char reactor_b;
+static char trigger_a;
+
+static void record(int event_type, void* pointer, int reaction, int64_t logical_time, int64_t physical_time) {
+  trace_record_nodeps_t tr = {.event_type = event_type,
+                              .pointer = pointer,
+                              .src_id = 0,
+                              .dst_id = reaction,
+                              .logical_time = logical_time,
+                              .microstep = 0,
+                              .physical_time = physical_time,
+                              .trigger = NULL,
+                              .extra_delay = 0};
+  lf_tracing_tracepoint(0, &tr);
+}
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <trace.lft>\n", argv[0]);
+    return 1;
+  }
+  setenv("LF_TRACE_OTEL", "0", 1);
+  setenv("LF_TRACE_FILE", argv[1], 1);
+  lf_tracing_global_init("fixture", NULL, 0, 2);
+  lf_tracing_register_trace_event(
+      (object_description_t){.pointer = &reactor_a, .trigger = NULL, .type = trace_reactor, .description = "Main.a"});
+  lf_tracing_register_trace_event(
+      (object_description_t){.pointer = &reactor_b, .trigger = NULL, .type = trace_reactor, .description = "Main.b"});
+  lf_tracing_register_trace_event((object_description_t){
+      .pointer = &reactor_a, .trigger = &trigger_a, .type = trace_trigger, .description = "Main.a.t"});
+  lf_tracing_set_start_time(0);
+
+  bench_set_thread_id(0);
+  record(schedule_called, &reactor_a, 0, 0, 0);
+  for (int worker = 0; worker < 2; worker++) {
+    bench_set_thread_id(worker);
+    for (int i = 0; i < FIXTURE_EXECUTIONS; i++) {
+      int64_t logical_time = (int64_t)i * 1000000;
+      int64_t start = logical_time + 10000;
+      if (worker == 0) {
+        record(reaction_starts, &reactor_a, 0, logical_time, start);
+        record(reaction_ends, &reactor_a, 0, logical_time, start + 1000);
+      } else {
+        record(reaction_starts, &reactor_b, 1, logical_time, start);
+        record(reaction_ends, &reactor_b, 1, logical_time, start + 3000);
+      }
+    }
+  }
+  lf_tracing_global_shutdown();
+  return 0;
+}
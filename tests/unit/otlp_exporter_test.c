@@ -0,0 +1,545 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file otlp_exporter_test.c
+ * @brief Tests of the built-in OTLP/HTTP exporter
+ *
+ * Usage: otlp-exporter-test
+ *
+ * - parse_endpoint() and read_response() are checked against tables of inputs.
+ * - Spans are exported through otlp_exporter_ops to a collector stub on a loopback port,
+ *   and the ExportTraceServiceRequest it receives is decoded by hand: every field must
+ *   have the field number and wire type of the OTLP protos, and every length must match
+ *   the bytes that follow.
+ *
+ * The exporter is included rather than linked, so that its private helpers can be called.
+ */
+
+#include "../../src/otlp_exporter.c"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "trace_types.h"
+
+static int failures = 0;
+
+#define CHECK(condition, ...)                                                                                          \
+  do {                                                                                                                 \
+    if (!(condition)) {                                                                                                \
+      fprintf(stderr, "FAIL %s:%d: ", __func__, __LINE__);                                                             \
+      fprintf(stderr, __VA_ARGS__);                                                                                    \
+      fputc('\n', stderr);                                                                                             \
+      failures++;                                                                                                      \
+    }                                                                                                                  \
+  } while (0)
+
+// ENDPOINTS *****************************************************************
+
+static void test_parse_endpoint(void) {
+  static const struct {
+    const char* endpoint;
+    const char* host; ///< NULL if the endpoint must be rejected
+    const char* port;
+    const char* path;
+  } cases[] = {
+      {"http://localhost:4318", "localhost", "4318", "/v1/traces"},
+      {"http://collector", "collector", "80", "/v1/traces"},
+      {"http://collector/", "collector", "80", "/v1/traces"},
+      {"http://10.0.0.1:4318/custom/traces", "10.0.0.1", "4318", "/custom/traces"},
+      {"http://[::1]:4318", "::1", "4318", "/v1/traces"},
+      {"http://[fe80::1]/v1/traces", "fe80::1", "80", "/v1/traces"},
+      {"https://collector:4318", NULL, NULL, NULL},
+      {"collector:4318", NULL, NULL, NULL},
+      {"http://", NULL, NULL, NULL},
+      {"http://:4318", NULL, NULL, NULL},
+      {"http://collector:/v1/traces", NULL, NULL, NULL},
+      {"http://[::1:4318", NULL, NULL, NULL},
+      {"http://[::1]x:4318", NULL, NULL, NULL},
+      {"http://[]:4318", NULL, NULL, NULL},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    otlp_exporter_t exporter;
+    memset(&exporter, 0, sizeof(exporter));
+    int result = parse_endpoint(&exporter, cases[i].endpoint);
+    if (!cases[i].host) {
+      CHECK(result != 0, "'%s' was accepted", cases[i].endpoint);
+    } else if (result != 0) {
+      CHECK(0, "'%s' was rejected", cases[i].endpoint);
+    } else {
+      CHECK(strcmp(exporter.host, cases[i].host) == 0 && strcmp(exporter.port, cases[i].port) == 0 &&
+                strcmp(exporter.path, cases[i].path) == 0,
+            "'%s' gave host '%s', port '%s', path '%s'", cases[i].endpoint, exporter.host, exporter.port,
+            exporter.path);
+    }
+    free(exporter.host);
+    free(exporter.port);
+    free(exporter.path);
+  }
+}
+
+// RESPONSES *****************************************************************
+
+static void test_read_response(void) {
+  static char long_header[6000];
+  snprintf(long_header, sizeof(long_header), "HTTP/1.1 200 OK\r\nX-Padding: %05000d\r\nContent-Length: 0\r\n\r\n", 0);
+  static char long_body[20000];
+  int prefix = snprintf(long_body, sizeof(long_body), "HTTP/1.1 200 OK\r\nContent-Length: 10000\r\n\r\n");
+  memset(long_body + prefix, 'x', 10000);
+  long_body[prefix + 10000] = '\0';
+
+  static const struct {
+    const char* name;
+    const char* response; ///< Sent before the connection is shut down
+    int status;           ///< Expected status, or -1
+    int keep_alive;       ///< Expected keep_alive (unused if status is -1)
+  } cases[] = {
+      {"ok", "HTTP/1.1 200 OK\r\nContent-Type: application/x-protobuf\r\nContent-Length: 2\r\n\r\n{}", 200, 1},
+      {"lowercase header", "HTTP/1.1 200 OK\r\ncontent-length: 3\r\n\r\nabc", 200, 1},
+      {"no body", "HTTP/1.0 204 No Content\r\nContent-Length: 0\r\n\r\n", 204, 1},
+      {"close", "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", 400, 0},
+      {"chunked", "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n", 200, 0},
+      {"truncated body", "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 10\r\n\r\nabc", 503, 0},
+      {"long body", long_body, 200, 1},
+      {"long header", long_header, -1, 0},
+      {"no status line", "garbage\r\n\r\n", -1, 0},
+      {"no end of header", "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n", -1, 0},
+      {"empty", "", -1, 0},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+      CHECK(0, "socketpair failed");
+      return;
+    }
+    struct iovec iov = {(void*)cases[i].response, strlen(cases[i].response)};
+    CHECK(send_all(fds[1], &iov, 1) == 0, "%s: could not send the response", cases[i].name);
+    shutdown(fds[1], SHUT_WR);
+    int keep_alive = 1;
+    int status = read_response(fds[0], &keep_alive);
+    CHECK(status == cases[i].status, "%s: status %d, expected %d", cases[i].name, status, cases[i].status);
+    CHECK(status < 0 || keep_alive == cases[i].keep_alive, "%s: keep_alive %d, expected %d", cases[i].name,
+          keep_alive, cases[i].keep_alive);
+    close(fds[0]);
+    close(fds[1]);
+  }
+}
+
+// PROTOBUF DECODER **********************************************************
+
+// Wire types and field numbers, from the OTLP protos rather than from otlp_encoder.c.
+#define PB_WIRE_VARINT 0
+#define PB_WIRE_FIXED64 1
+#define PB_WIRE_LEN 2
+#define PB_REQUEST_RESOURCE_SPANS 1     // ExportTraceServiceRequest.resource_spans
+#define PB_RESOURCE_SPANS_RESOURCE 1    // ResourceSpans.resource
+#define PB_RESOURCE_SPANS_SCOPE_SPANS 2 // ResourceSpans.scope_spans
+#define PB_RESOURCE_ATTRIBUTES 1        // Resource.attributes
+#define PB_SCOPE_SPANS_SCOPE 1          // ScopeSpans.scope
+#define PB_SCOPE_SPANS_SPANS 2          // ScopeSpans.spans
+#define PB_SCOPE_NAME 1                 // InstrumentationScope.name
+#define PB_SPAN_TRACE_ID 1
+#define PB_SPAN_SPAN_ID 2
+#define PB_SPAN_NAME 5
+#define PB_SPAN_KIND 6
+#define PB_SPAN_START_TIME 7
+#define PB_SPAN_END_TIME 8
+#define PB_SPAN_ATTRIBUTES 9
+#define PB_KEY_VALUE_KEY 1
+#define PB_KEY_VALUE_VALUE 2
+#define PB_ANY_VALUE_STRING 1
+#define PB_ANY_VALUE_INT 3
+#define PB_ANY_VALUE_ARRAY 5
+#define PB_ARRAY_VALUE_VALUES 1
+#define PB_SPAN_KIND_INTERNAL 1
+
+/** @brief A field of a protobuf message. */
+typedef struct field {
+  int number;
+  int wire_type;
+  uint64_t value;      ///< Varint and fixed64 fields
+  const uint8_t* data; ///< Length-delimited fields
+  size_t length;
+} field_t;
+
+/** @brief A message being decoded. */
+typedef struct message {
+  const uint8_t* p;
+  const uint8_t* end;
+  int malformed;
+} message_t;
+
+static message_t message_of(const uint8_t* data, size_t length) { return (message_t){data, data + length, 0}; }
+
+static int read_varint(message_t* m, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (m->p == m->end) {
+      return -1;
+    }
+    uint8_t byte = *m->p++;
+    *value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return 0;
+    }
+  }
+  return -1;
+}
+
+/** @brief Read the next field; return 0 at the end of the message, or if it is malformed. */
+static int next_field(message_t* m, field_t* f) {
+  uint64_t tag;
+  if (m->malformed || m->p == m->end) {
+    return 0;
+  }
+  memset(f, 0, sizeof(*f));
+  if (read_varint(m, &tag) != 0) {
+    m->malformed = 1;
+    return 0;
+  }
+  f->number = (int)(tag >> 3);
+  f->wire_type = (int)(tag & 7);
+  if (f->wire_type == PB_WIRE_VARINT) {
+    m->malformed = read_varint(m, &f->value) != 0;
+  } else if (f->wire_type == PB_WIRE_FIXED64 && m->end - m->p >= 8) {
+    memcpy(&f->value, m->p, 8); // Little-endian, as on the hosts this runs on
+    m->p += 8;
+  } else if (f->wire_type == PB_WIRE_LEN && read_varint(m, &f->value) == 0 &&
+             f->value <= (uint64_t)(m->end - m->p)) {
+    f->data = m->p;
+    f->length = (size_t)f->value;
+    m->p += f->length;
+  } else {
+    m->malformed = 1;
+  }
+  return !m->malformed;
+}
+
+/** @brief Whether a field has the given number and wire type; report it otherwise. */
+static int expect_field(const char* message, const field_t* f, int number, int wire_type) {
+  CHECK(f->number == number && f->wire_type == wire_type, "%s: field %d with wire type %d, expected %d/%d", message,
+        f->number, f->wire_type, number, wire_type);
+  return f->number == number && f->wire_type == wire_type;
+}
+
+/** @brief Whether a length-delimited field holds the given string. */
+static int field_equals(const field_t* f, const char* text) {
+  return f->length == strlen(text) && memcmp(f->data, text, f->length) == 0;
+}
+
+/** @brief A decoded attribute (KeyValue). */
+typedef struct attribute {
+  field_t key;
+  int kind;     ///< PB_ANY_VALUE_STRING, PB_ANY_VALUE_INT or PB_ANY_VALUE_ARRAY
+  field_t value;
+  int elements; ///< Strings in an array value
+} attribute_t;
+
+static void decode_attribute(const field_t* f, attribute_t* attribute) {
+  memset(attribute, 0, sizeof(*attribute));
+  message_t m = message_of(f->data, f->length);
+  field_t field;
+  while (next_field(&m, &field)) {
+    if (field.number == PB_KEY_VALUE_KEY && expect_field("KeyValue", &field, PB_KEY_VALUE_KEY, PB_WIRE_LEN)) {
+      attribute->key = field;
+    } else if (expect_field("KeyValue", &field, PB_KEY_VALUE_VALUE, PB_WIRE_LEN)) {
+      message_t any = message_of(field.data, field.length);
+      field_t value;
+      while (next_field(&any, &value)) {
+        attribute->kind = value.number;
+        attribute->value = value;
+        if (value.number == PB_ANY_VALUE_INT) {
+          expect_field("AnyValue", &value, PB_ANY_VALUE_INT, PB_WIRE_VARINT);
+        } else if (value.number == PB_ANY_VALUE_ARRAY &&
+                   expect_field("AnyValue", &value, PB_ANY_VALUE_ARRAY, PB_WIRE_LEN)) {
+          message_t array = message_of(value.data, value.length);
+          field_t element;
+          while (next_field(&array, &element)) {
+            expect_field("ArrayValue", &element, PB_ARRAY_VALUE_VALUES, PB_WIRE_LEN);
+            attribute->elements++;
+          }
+          CHECK(!array.malformed, "malformed ArrayValue");
+        } else {
+          expect_field("AnyValue", &value, PB_ANY_VALUE_STRING, PB_WIRE_LEN);
+        }
+      }
+      CHECK(!any.malformed, "malformed AnyValue");
+    }
+  }
+  CHECK(!m.malformed, "malformed KeyValue");
+  CHECK(attribute->key.data && attribute->kind, "KeyValue without a key or a value");
+}
+
+/** @brief The attribute with the given key among the encoded attributes, or NULL. */
+static const attribute_t* find_attribute(const attribute_t* attributes, int count, const char* key) {
+  for (int i = 0; i < count; i++) {
+    if (field_equals(&attributes[i].key, key)) {
+      return &attributes[i];
+    }
+  }
+  return NULL;
+}
+
+static void expect_string_attribute(const attribute_t* attributes, int count, const char* key, const char* value) {
+  const attribute_t* attribute = find_attribute(attributes, count, key);
+  CHECK(attribute && attribute->kind == PB_ANY_VALUE_STRING && field_equals(&attribute->value, value),
+        "attribute %s is not '%s'", key, value);
+}
+
+static void expect_int_attribute(const attribute_t* attributes, int count, const char* key, int64_t value) {
+  const attribute_t* attribute = find_attribute(attributes, count, key);
+  CHECK(attribute && attribute->kind == PB_ANY_VALUE_INT && (int64_t)attribute->value.value == value,
+        "attribute %s is not %lld", key, (long long)value);
+}
+
+// EXPORT ********************************************************************
+
+#define TEST_MAX_ATTRIBUTES 32
+#define TEST_START_TIME INT64_C(1700000000000000000)
+
+/** @brief What the collector stub received. */
+typedef struct collector {
+  int listener;
+  char header[4096];
+  uint8_t* body;
+  size_t body_size;
+  int requests;
+} collector_t;
+
+/** @brief Receive requests on one connection and answer each with 200 until it closes. */
+static void* collector_thread(void* arg) {
+  collector_t* collector = (collector_t*)arg;
+  int fd = accept(collector->listener, NULL, NULL);
+  if (fd < 0) {
+    return NULL;
+  }
+  for (;;) {
+    char buffer[65536];
+    size_t size = 0;
+    char* body = NULL;
+    while (!body && size < sizeof(buffer) - 1) {
+      ssize_t received = recv(fd, buffer + size, sizeof(buffer) - 1 - size, 0);
+      if (received <= 0) {
+        close(fd);
+        return NULL;
+      }
+      size += (size_t)received;
+      buffer[size] = '\0';
+      body = strstr(buffer, "\r\n\r\n");
+    }
+    if (!body) {
+      break;
+    }
+    body += 4;
+    const char* length_header = strstr(buffer, "Content-Length: ");
+    size_t length = length_header ? strtoul(length_header + 16, NULL, 10) : 0;
+    uint8_t* data = malloc(length ? length : 1);
+    size_t have = size - (size_t)(body - buffer);
+    memcpy(data, body, have < length ? have : length);
+    while (have < length) {
+      ssize_t received = recv(fd, data + have, length - have, 0);
+      if (received <= 0) {
+        break;
+      }
+      have += (size_t)received;
+    }
+    if (collector->requests++ == 0) {
+      snprintf(collector->header, sizeof(collector->header), "%.*s", (int)(body - buffer), buffer);
+      collector->body = data;
+      collector->body_size = have;
+    } else {
+      free(data);
+    }
+    static const char response[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+    struct iovec iov = {(void*)response, sizeof(response) - 1};
+    send_all(fd, &iov, 1);
+  }
+  close(fd);
+  return NULL;
+}
+
+static void check_span(const field_t* span_field, int* reaction_spans, int* anonymous_spans) {
+  message_t m = message_of(span_field->data, span_field->length);
+  field_t f;
+  field_t name = {0};
+  uint64_t kind = 0, start = 0, end = 0;
+  size_t trace_id = 0, span_id = 0;
+  attribute_t attributes[TEST_MAX_ATTRIBUTES];
+  int count = 0;
+  while (next_field(&m, &f)) {
+    switch (f.number) {
+    case PB_SPAN_TRACE_ID:
+      trace_id = expect_field("Span", &f, PB_SPAN_TRACE_ID, PB_WIRE_LEN) ? f.length : 0;
+      break;
+    case PB_SPAN_SPAN_ID:
+      span_id = expect_field("Span", &f, PB_SPAN_SPAN_ID, PB_WIRE_LEN) ? f.length : 0;
+      break;
+    case PB_SPAN_NAME:
+      expect_field("Span", &f, PB_SPAN_NAME, PB_WIRE_LEN);
+      name = f;
+      break;
+    case PB_SPAN_KIND:
+      kind = expect_field("Span", &f, PB_SPAN_KIND, PB_WIRE_VARINT) ? f.value : 0;
+      break;
+    case PB_SPAN_START_TIME:
+      start = expect_field("Span", &f, PB_SPAN_START_TIME, PB_WIRE_FIXED64) ? f.value : 0;
+      break;
+    case PB_SPAN_END_TIME:
+      end = expect_field("Span", &f, PB_SPAN_END_TIME, PB_WIRE_FIXED64) ? f.value : 0;
+      break;
+    case PB_SPAN_ATTRIBUTES:
+      if (expect_field("Span", &f, PB_SPAN_ATTRIBUTES, PB_WIRE_LEN) && count < TEST_MAX_ATTRIBUTES) {
+        decode_attribute(&f, &attributes[count++]);
+      }
+      break;
+    default:
+      CHECK(0, "unexpected span field %d", f.number);
+    }
+  }
+  CHECK(!m.malformed, "malformed Span");
+  CHECK(trace_id == 16 && span_id == 8, "trace and span IDs of %zu and %zu bytes", trace_id, span_id);
+  CHECK(kind == PB_SPAN_KIND_INTERNAL, "span kind %llu", (unsigned long long)kind);
+  CHECK(start == (uint64_t)TEST_START_TIME && end >= start, "span from %llu to %llu", (unsigned long long)start,
+        (unsigned long long)end);
+  expect_string_attribute(attributes, count, "xronos.element_type", "reaction");
+  expect_int_attribute(attributes, count, "xronos.worker", 1);
+  expect_int_attribute(attributes, count, "xronos.microstep", 2);
+  // A negative lag is a ten-byte varint.
+  expect_int_attribute(attributes, count, "xronos.lag", -5);
+  expect_int_attribute(attributes, count, "xronos.timestamp", TEST_START_TIME + 5);
+  const attribute_t* schema = find_attribute(attributes, count, "xronos.schema.low_cardinality_attributes");
+  if (field_equals(&name, "Main.r.0")) {
+    (*reaction_spans)++;
+    expect_string_attribute(attributes, count, "xronos.fqn", "Main.r.0");
+    expect_string_attribute(attributes, count, "xronos.name", "0");
+    expect_string_attribute(attributes, count, "xronos.container_fqn", "Main.r");
+    expect_string_attribute(attributes, count, "xronos.trigger_fqn", "Main.r.t");
+    expect_int_attribute(attributes, count, "xronos.trigger.latency", 42);
+    CHECK(schema && schema->kind == PB_ANY_VALUE_ARRAY && schema->elements == 4, "schema of the reaction span");
+  } else if (field_equals(&name, "reaction")) {
+    (*anonymous_spans)++;
+    CHECK(!find_attribute(attributes, count, "xronos.fqn"), "span of a reaction without FQN has xronos.fqn");
+    CHECK(schema && schema->kind == PB_ANY_VALUE_ARRAY && schema->elements == 1, "schema of the anonymous span");
+  } else {
+    CHECK(0, "unexpected span name '%.*s'", (int)name.length, (const char*)name.data);
+  }
+}
+
+static void check_request(const uint8_t* body, size_t size, int expected_spans) {
+  message_t request = message_of(body, size);
+  field_t resource_spans;
+  CHECK(next_field(&request, &resource_spans) &&
+            expect_field("ExportTraceServiceRequest", &resource_spans, PB_REQUEST_RESOURCE_SPANS, PB_WIRE_LEN),
+        "no resource_spans");
+  CHECK(request.p == request.end && !request.malformed, "bytes after resource_spans");
+
+  int resources = 0, scopes = 0, reaction_spans = 0, anonymous_spans = 0;
+  message_t m = message_of(resource_spans.data, resource_spans.length);
+  field_t f;
+  while (next_field(&m, &f)) {
+    if (f.number == PB_RESOURCE_SPANS_RESOURCE &&
+        expect_field("ResourceSpans", &f, PB_RESOURCE_SPANS_RESOURCE, PB_WIRE_LEN)) {
+      resources++;
+      attribute_t attributes[2];
+      int count = 0;
+      message_t resource = message_of(f.data, f.length);
+      field_t attribute;
+      while (next_field(&resource, &attribute) && count < 2) {
+        if (expect_field("Resource", &attribute, PB_RESOURCE_ATTRIBUTES, PB_WIRE_LEN)) {
+          decode_attribute(&attribute, &attributes[count++]);
+        }
+      }
+      CHECK(!resource.malformed && count == 2, "resource with %d attributes", count);
+      expect_string_attribute(attributes, count, "service.name", "LF");
+      expect_string_attribute(attributes, count, "service.instance.id", "lf-lang.org");
+    } else if (expect_field("ResourceSpans", &f, PB_RESOURCE_SPANS_SCOPE_SPANS, PB_WIRE_LEN)) {
+      scopes++;
+      message_t scope_spans = message_of(f.data, f.length);
+      field_t g;
+      while (next_field(&scope_spans, &g)) {
+        if (g.number == PB_SCOPE_SPANS_SCOPE && expect_field("ScopeSpans", &g, PB_SCOPE_SPANS_SCOPE, PB_WIRE_LEN)) {
+          message_t scope = message_of(g.data, g.length);
+          field_t scope_name;
+          CHECK(next_field(&scope, &scope_name) && expect_field("InstrumentationScope", &scope_name, PB_SCOPE_NAME,
+                                                                PB_WIRE_LEN) &&
+                    field_equals(&scope_name, "lf-trace-xronos") && scope.p == scope.end,
+                "unexpected instrumentation scope");
+        } else if (expect_field("ScopeSpans", &g, PB_SCOPE_SPANS_SPANS, PB_WIRE_LEN)) {
+          check_span(&g, &reaction_spans, &anonymous_spans);
+        }
+      }
+      CHECK(!scope_spans.malformed, "malformed ScopeSpans");
+    }
+  }
+  CHECK(!m.malformed, "malformed ResourceSpans");
+  CHECK(resources == 1 && scopes == 1, "%d resources and %d scope spans", resources, scopes);
+  CHECK(reaction_spans == expected_spans - 1 && anonymous_spans == 1, "%d reaction spans and %d anonymous ones",
+        reaction_spans, anonymous_spans);
+}
+
+static void test_export(void) {
+  collector_t collector = {.listener = socket(AF_INET, SOCK_STREAM, 0)};
+  struct sockaddr_in address = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  socklen_t address_size = sizeof(address);
+  if (collector.listener < 0 || bind(collector.listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+      listen(collector.listener, 1) != 0 ||
+      getsockname(collector.listener, (struct sockaddr*)&address, &address_size) != 0) {
+    CHECK(0, "cannot listen on a loopback port");
+    return;
+  }
+  pthread_t thread;
+  pthread_create(&thread, NULL, collector_thread, &collector);
+
+  char endpoint[64];
+  snprintf(endpoint, sizeof(endpoint), "http://127.0.0.1:%d", ntohs(address.sin_port));
+  otel_backend_t* backend = otlp_exporter_ops.create(endpoint, "LF", "lf-lang.org", 1);
+  CHECK(backend && otlp_exporter_ops.initialize(backend) == 0, "cannot create the exporter");
+  if (backend && backend->initialized) {
+    // Spans of the same reaction share an encoded template; the last one has no reaction ID.
+    trace_record_nodeps_t record = {.event_type = reaction_starts,
+                                    .dst_id = 0,
+                                    .logical_time = TEST_START_TIME + 5,
+                                    .microstep = 2,
+                                    .physical_time = TEST_START_TIME};
+    otel_trigger_info_t trigger = {.trigger_fqn = "Main.r.t", .timestamp = TEST_START_TIME, .latency = 42};
+    for (int i = 0; i < 3; i++) {
+      void* span = otlp_exporter_ops.start_reaction_span(backend, 1, 7, "Main.r.0", "Main.r.0", 0, "Main.r", &record,
+                                                         &trigger);
+      otlp_exporter_ops.end_span(backend, span);
+    }
+    otlp_exporter_ops.end_span(backend, otlp_exporter_ops.start_reaction_span(backend, 1, -1, "reaction", NULL, 0,
+                                                                              NULL, &record, NULL));
+    CHECK(otlp_exporter_ops.flush(backend, INT64_C(5000000000)) == 0, "the flush failed");
+  }
+  if (backend) {
+    otlp_exporter_ops.destroy(backend);
+  }
+  shutdown(collector.listener, SHUT_RDWR);
+  pthread_join(thread, NULL);
+  close(collector.listener);
+
+  CHECK(collector.requests == 1, "%d requests", collector.requests);
+  if (collector.body) {
+    CHECK(strncmp(collector.header, "POST /v1/traces HTTP/1.1\r\n", 26) == 0, "request line of '%s'", collector.header);
+    CHECK(strstr(collector.header, "\r\nContent-Type: application/x-protobuf\r\n") != NULL, "no protobuf content type");
+    char length[64];
+    snprintf(length, sizeof(length), "\r\nContent-Length: %zu\r\n", collector.body_size);
+    CHECK(strstr(collector.header, length) != NULL, "content length does not match the %zu bytes received",
+          collector.body_size);
+    check_request(collector.body, collector.body_size, 4);
+    free(collector.body);
+  }
+}
+
+int main(void) {
+  test_parse_endpoint();
+  test_read_response();
+  test_export();
+  if (failures > 0) {
+    fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  printf("All OTLP exporter tests passed\n");
+  return 0;
+}
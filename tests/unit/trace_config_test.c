@@ -0,0 +1,186 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file trace_config_test.c
+ * @brief Table-driven tests of the control commands of trace_config.c
+ *
+ * Usage: trace-config-test
+ *
+ * The commands of each table are applied in order to one configuration created from an
+ * empty environment. A valid command must return the expected TRACE_CONFIG_CHANGED_*
+ * flags and leave the expected setting in trace_config_format()'s description. An
+ * invalid command must return -1 with a message and leave the configuration unchanged.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace_config.h"
+
+/** A command and what it is expected to do. */
+typedef struct config_case {
+  const char* command;
+  int result;           ///< Expected return value: TRACE_CONFIG_CHANGED_* flags, or -1
+  const char* expected; ///< Substring of the formatted configuration afterwards (unused if result is -1)
+} config_case_t;
+
+static const config_case_t events_cases[] = {
+    {"events all", 0, "events=0xffffffffffffffff"},
+    {"events reactions", 0, "events=0x0000000000000003"},
+    {"verbose 1", 0, "events=0xffffffffffffffff"},
+    {"verbose 0", 0, "events=0x0000000000000003"},
+    {"events reaction_starts", 0, "events=0x0000000000000001"},
+    {"events Schedule called,REACTION_ENDS", 0, "events=0x000000000000000a"},
+    {"events reaction_starts,,worker_wait_starts", 0, "events=0x0000000000000041"},
+    {"events 0x5", 0, "events=0x0000000000000005"},
+    {"events 0xDeadBeef", 0, "events=0x00000000deadbeef"},
+    {"events 0x", -1, NULL},
+    {"events 0x12g", -1, NULL},
+    {"events 0x 1", -1, NULL},
+    {"events 0x-1", -1, NULL},
+    {"events reaction_starts,bogus", -1, NULL},
+    {"events reaction", -1, NULL},
+    {"verbose 2", -1, NULL},
+    {"verbose", -1, NULL},
+};
+
+static const config_case_t window_cases[] = {
+    {"window 30s-35s", 0, "window=30s-35s "},
+    {"window 0s-1s every 60s", 0, "window=0s-1s every 60s "},
+    {"window 10ms-", 0, "window=10ms- "},
+    {"window 1.5s-2500ms", 0, "window=1500ms-2500ms "},
+    {"window 100-200us", 0, "window=100ns-200us "},
+    {"window 0s-1s every 1s", 0, "window=0s-1s every 1s "},
+    {"window -", 0, "window=- "},
+    {"window 5s-5s", -1, NULL},
+    {"window 2s-1s", -1, NULL},
+    {"window 0s-2s every 1s", -1, NULL},
+    {"window 1s- every 5s", -1, NULL},
+    {"window 1s", -1, NULL},
+    {"window 1s-2s each 5s", -1, NULL},
+    {"window 1s-2s every", -1, NULL},
+    {"window 1s-2s every 5s 6s", -1, NULL},
+    {"window 1x-2s", -1, NULL},
+    {"window 1s-2s every -5s", -1, NULL},
+    {"window 99999999999s-", -1, NULL},
+};
+
+static const config_case_t batch_cases[] = {
+    {"batch delay=100", TRACE_CONFIG_CHANGED_BATCH, "batch delay=100 queue=0 size=0"},
+    {"batch delay=100", 0, "batch delay=100 queue=0 size=0"},
+    {"batch queue=4096 size=256", TRACE_CONFIG_CHANGED_BATCH, "batch delay=100 queue=4096 size=256"},
+    {"batch", 0, "batch delay=100 queue=4096 size=256"},
+    {"batch delay=0", -1, NULL},
+    {"batch queue=-1", -1, NULL},
+    {"batch size=abc", -1, NULL},
+    {"batch size=", -1, NULL},
+    {"batch delay", -1, NULL},
+    {"batch timeout=5", -1, NULL},
+    {"batch delay=50 bogus=1", -1, NULL},
+};
+
+static const config_case_t other_cases[] = {
+    {"sample 10", 0, "sample=10 "},
+    {"  sample \t 3  ", 0, "sample=3 "},
+    {"sample 4294967295", 0, "sample=4294967295 "},
+    {"sample 0", -1, NULL},
+    {"sample -1", -1, NULL},
+    {"sample 4294967296", -1, NULL},
+    {"sample 3x", -1, NULL},
+    {"include Main.a*,Main.b", TRACE_CONFIG_CHANGED_FILTERS, "include=Main.a*,Main.b "},
+    {"exclude Main.b", TRACE_CONFIG_CHANGED_FILTERS, "exclude=Main.b "},
+    {"include -", TRACE_CONFIG_CHANGED_FILTERS, "include=- exclude=Main.b "},
+    {"exclude", TRACE_CONFIG_CHANGED_FILTERS, "exclude=- "},
+    {"", -1, NULL},
+    {"show", -1, NULL},
+    {"samples 3", -1, NULL},
+};
+
+/** @brief Apply the commands of a table in order; return the number of failures. */
+static int run_cases(const char* table, const config_case_t* cases, size_t count) {
+  trace_config_t* config = trace_config_from_env();
+  if (!config) {
+    fprintf(stderr, "FAIL %s: out of memory\n", table);
+    return 1;
+  }
+  int failures = 0;
+  for (size_t i = 0; i < count; i++) {
+    char before[256], after[256];
+    char error[TRACE_CONFIG_ERROR_SIZE] = "";
+    trace_config_format(config, before, sizeof(before));
+    int result = trace_config_apply_command(config, cases[i].command, error);
+    trace_config_format(config, after, sizeof(after));
+    if (result != cases[i].result) {
+      fprintf(stderr, "FAIL %s: '%s' returned %d, expected %d (%s)\n", table, cases[i].command, result,
+              cases[i].result, error);
+      failures++;
+    } else if (result < 0 && (error[0] == '\0' || strcmp(before, after) != 0)) {
+      fprintf(stderr, "FAIL %s: '%s' was rejected with '%s' but changed '%s' to '%s'\n", table, cases[i].command,
+              error, before, after);
+      failures++;
+    } else if (result >= 0 && !strstr(after, cases[i].expected)) {
+      fprintf(stderr, "FAIL %s: '%s' gave '%s', expected '%s'\n", table, cases[i].command, after, cases[i].expected);
+      failures++;
+    }
+  }
+  trace_config_free(config);
+  return failures;
+}
+
+/** @brief Check the reactor filters and the window of a configuration built by commands. */
+static int check_filters_and_window(void) {
+  trace_config_t* config = trace_config_from_env();
+  char error[TRACE_CONFIG_ERROR_SIZE];
+  if (!config || trace_config_apply_command(config, "include Main.a*,Main.b", error) < 0 ||
+      trace_config_apply_command(config, "exclude Main.a2", error) < 0 ||
+      trace_config_apply_command(config, "window 1s-2s every 10s", error) < 0) {
+    fprintf(stderr, "FAIL filters: could not set up the configuration\n");
+    trace_config_free(config);
+    return 1;
+  }
+  static const struct {
+    const char* fqn;
+    int matches;
+  } reactors[] = {{"Main.a", 1}, {"Main.a1", 1}, {"Main.a2", 0}, {"Main.b", 1}, {"Main.b1", 0}, {"Main", 0}, {NULL, 0}};
+  static const struct {
+    int64_t elapsed;
+    int inside;
+  } times[] = {{0, 0}, {1000000000, 1}, {1999999999, 1}, {2000000000, 0}, {11500000000, 1}, {12000000000, 0}};
+  int failures = 0;
+  for (size_t i = 0; i < sizeof(reactors) / sizeof(reactors[0]); i++) {
+    if (trace_config_reactor_matches(config, reactors[i].fqn) != reactors[i].matches) {
+      fprintf(stderr, "FAIL filters: '%s' should %smatch\n", reactors[i].fqn ? reactors[i].fqn : "(null)",
+              reactors[i].matches ? "" : "not ");
+      failures++;
+    }
+  }
+  for (size_t i = 0; i < sizeof(times) / sizeof(times[0]); i++) {
+    if (trace_config_in_window(config, times[i].elapsed) != times[i].inside) {
+      fprintf(stderr, "FAIL window: %lld ns should be %s the window\n", (long long)times[i].elapsed,
+              times[i].inside ? "inside" : "outside");
+      failures++;
+    }
+  }
+  trace_config_free(config);
+  return failures;
+}
+
+#define RUN_CASES(cases) run_cases(#cases, cases, sizeof(cases) / sizeof(cases[0]))
+
+int main(void) {
+  static const char* variables[] = {"LF_TRACE_VERBOSE", "LF_TRACE_EVENTS", "LF_TRACE_SAMPLE",
+                                    "LF_TRACE_INCLUDE", "LF_TRACE_EXCLUDE", "LF_TRACE_WINDOW"};
+  for (size_t i = 0; i < sizeof(variables) / sizeof(variables[0]); i++) {
+    unsetenv(variables[i]);
+  }
+  int failures = RUN_CASES(events_cases) + RUN_CASES(window_cases) + RUN_CASES(batch_cases) +
+                 RUN_CASES(other_cases) + check_filters_and_window();
+  if (failures > 0) {
+    fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  printf("All trace configuration tests passed\n");
+  return 0;
+}
@@ -0,0 +1,817 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 Xronos Inc.
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file lf_trace_query.c
+ * @brief Command-line tool for slicing LF binary trace files (.lft)
+ *
+ * The trace file is memory-mapped and decoded block by block on several threads.
+ * Blocks are processed in bounded batches whose pages are released afterwards,
+ * so files larger than RAM are streamed rather than loaded. When the block index
+ * written by the plugin (`<trace>.idx`) is present, blocks outside the requested
+ * time window are skipped without being read.
+ *
+ * Usage: lf-trace-query [options] <trace.lft>
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trace.h"
+#include "trace_types.h"
+#include "lft_writer.h"
+
+/** Bytes of trace data decoded per batch before its pages are released. */
+#define BATCH_BYTES ((size_t)256 << 20)
+
+/** Maximum number of reactor patterns and event types accepted on the command line. */
+#define MAX_PATTERNS 64
+
+// PRIVATE DATA STRUCTURES ***************************************************
+
+typedef struct {
+  void* pointer;
+  void* trigger;
+  int type;
+  const char* description;
+  int matches; ///< Whether the description passes the reactor filter
+} description_t;
+
+typedef struct {
+  uint64_t offset; ///< Offset of the first record
+  int32_t count;
+  int64_t min_time;
+  int64_t max_time;
+} block_t;
+
+/** Reaction statistics, keyed by (pointer, reaction number). */
+typedef struct {
+  void* pointer;
+  int reaction;
+  uint64_t count;
+  int64_t total;
+  int64_t min;
+  int64_t max;
+  double sum_squares;
+} reaction_stats_t;
+
+typedef struct {
+  reaction_stats_t* entries;
+  size_t capacity;
+  size_t size;
+} stats_table_t;
+
+/** A reaction start or end that could not be matched inside its block. */
+typedef struct {
+  int worker;
+  void* pointer;
+  int reaction;
+  int64_t time;
+} open_event_t;
+
+/** Output of decoding one block. */
+typedef struct {
+  char* text; ///< Matching records (list mode)
+  size_t text_size;
+  open_event_t* orphan_ends; ///< Ends without a start in this block, in order
+  size_t num_orphan_ends;
+  open_event_t* open_starts; ///< Starts without an end in this block
+  size_t num_open_starts;
+  uint64_t matched;
+} block_result_t;
+
+typedef struct {
+  // Options.
+  const char* patterns[MAX_PATTERNS];
+  int num_patterns;
+  int events[MAX_PATTERNS];
+  int num_events;
+  int64_t from;
+  int64_t to;
+  int physical;
+  int list;
+  int threads;
+
+  // Trace.
+  const uint8_t* data;
+  size_t size;
+  int64_t start_time;
+  description_t* descriptions;
+  int num_descriptions;
+  const description_t** reactor_index; ///< Open-addressing table from pointer to reactor description
+  size_t reactor_index_mask;
+  block_t* blocks;
+  size_t num_blocks;
+} query_t;
+
+typedef struct {
+  query_t* query;
+  size_t first;
+  size_t last;
+  block_result_t* results;
+  atomic_size_t next;
+  stats_table_t* stats; ///< One table per thread
+} batch_t;
+
+typedef struct {
+  batch_t* batch;
+  int index;
+} worker_arg_t;
+
+// PRIVATE HELPERS ***********************************************************
+
+static void usage(FILE* out) {
+  fprintf(out, "Usage: lf-trace-query [options] <trace.lft>\n"
+               "\n"
+               "Options:\n"
+               "  -r, --reactor GLOB  Keep events of reactors whose FQN matches GLOB (repeatable).\n"
+               "  -e, --event TYPE    Keep events of TYPE, given as a number or name, e.g.\n"
+               "                      \"Reaction starts\" (repeatable; list mode only).\n"
+               "      --from TIME     Start of the time window, relative to the start time\n"
+               "                      (e.g. 30s, 250ms, 10us, 100ns).\n"
+               "      --to TIME       End of the time window (exclusive).\n"
+               "      --physical      Apply the window to physical instead of logical time.\n"
+               "  -s, --stats         Print per-reaction execution time statistics (default).\n"
+               "  -l, --list          Print the matching records as CSV.\n"
+               "  -j, --threads N     Number of decoding threads (default: number of CPUs).\n"
+               "  -h, --help          Show this help.\n");
+}
+
+/**
+ * @brief Parse a duration such as "1.5s", "250ms", "10us", "100ns" or "2m" into nanoseconds.
+ */
+static int parse_duration(const char* text, int64_t* result) {
+  char* end;
+  errno = 0;
+  double value = strtod(text, &end);
+  if (errno != 0 || end == text) {
+    return -1;
+  }
+  double scale = 1.0;
+  if (*end == '\0' || strcmp(end, "ns") == 0) {
+    scale = 1.0;
+  } else if (strcmp(end, "us") == 0) {
+    scale = 1e3;
+  } else if (strcmp(end, "ms") == 0) {
+    scale = 1e6;
+  } else if (strcmp(end, "s") == 0) {
+    scale = 1e9;
+  } else if (strcmp(end, "m") == 0 || strcmp(end, "min") == 0) {
+    scale = 60e9;
+  } else {
+    return -1;
+  }
+  *result = (int64_t)(value * scale);
+  return 0;
+}
+
+static int parse_event_type(const char* text) {
+  char* end;
+  long value = strtol(text, &end, 10);
+  if (end != text && *end == '\0') {
+    return (value >= 0 && value < NUM_EVENT_TYPES) ? (int)value : -1;
+  }
+  for (int i = 0; i < NUM_EVENT_TYPES; i++) {
+    if (strcasecmp(text, trace_event_names[i]) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static int read_bytes(const query_t* q, size_t* pos, void* out, size_t n) {
+  if (*pos + n > q->size) {
+    return -1;
+  }
+  memcpy(out, q->data + *pos, n);
+  *pos += n;
+  return 0;
+}
+
+/**
+ * @brief Decode the header (start time and description table).
+ *
+ * @return Offset of the first block, or 0 on failure
+ */
+static size_t parse_header(query_t* q) {
+  size_t pos = 0;
+  int table_size;
+  if (read_bytes(q, &pos, &q->start_time, sizeof(int64_t)) != 0 || read_bytes(q, &pos, &table_size, sizeof(int)) != 0 ||
+      table_size < 0) {
+    return 0;
+  }
+  q->descriptions = (description_t*)calloc((size_t)table_size + 1, sizeof(description_t));
+  if (!q->descriptions) {
+    return 0;
+  }
+  for (int i = 0; i < table_size; i++) {
+    description_t* d = &q->descriptions[i];
+    _lf_trace_object_t type;
+    if (read_bytes(q, &pos, &d->pointer, sizeof(void*)) != 0 || read_bytes(q, &pos, &d->trigger, sizeof(void*)) != 0 ||
+        read_bytes(q, &pos, &type, sizeof(_lf_trace_object_t)) != 0) {
+      return 0;
+    }
+    d->type = (int)type;
+    const char* start = (const char*)q->data + pos;
+    const char* nul = memchr(start, '\0', q->size - pos);
+    if (!nul) {
+      return 0;
+    }
+    d->description = start;
+    pos += (size_t)(nul - start) + 1;
+
+    d->matches = (q->num_patterns == 0);
+    for (int p = 0; p < q->num_patterns && !d->matches; p++) {
+      d->matches = (fnmatch(q->patterns[p], d->description, 0) == 0);
+    }
+  }
+  q->num_descriptions = table_size;
+  return pos;
+}
+
+static size_t hash_pointer(const void* pointer) {
+  uint64_t h = (uint64_t)(uintptr_t)pointer;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return (size_t)h;
+}
+
+/**
+ * @brief Index the description table by pointer, preferring trace_reactor entries over triggers with the same pointer.
+ */
+static int build_reactor_index(query_t* q) {
+  size_t capacity = 16;
+  while (capacity < (size_t)q->num_descriptions * 2) {
+    capacity *= 2;
+  }
+  q->reactor_index = (const description_t**)calloc(capacity, sizeof(description_t*));
+  if (!q->reactor_index) {
+    return -1;
+  }
+  q->reactor_index_mask = capacity - 1;
+  for (int i = 0; i < q->num_descriptions; i++) {
+    const description_t* d = &q->descriptions[i];
+    size_t h = hash_pointer(d->pointer) & q->reactor_index_mask;
+    while (q->reactor_index[h] && q->reactor_index[h]->pointer != d->pointer) {
+      h = (h + 1) & q->reactor_index_mask;
+    }
+    if (!q->reactor_index[h] || (q->reactor_index[h]->type != trace_reactor && d->type == trace_reactor)) {
+      q->reactor_index[h] = d;
+    }
+  }
+  return 0;
+}
+
+static const description_t* find_reactor(const query_t* q, void* pointer) {
+  size_t h = hash_pointer(pointer) & q->reactor_index_mask;
+  while (q->reactor_index[h]) {
+    if (q->reactor_index[h]->pointer == pointer) {
+      return q->reactor_index[h];
+    }
+    h = (h + 1) & q->reactor_index_mask;
+  }
+  return NULL;
+}
+
+static int append_block(query_t* q, size_t* capacity, uint64_t offset, int32_t count, int64_t min_time,
+                        int64_t max_time) {
+  if (q->num_blocks == *capacity) {
+    *capacity = *capacity ? *capacity * 2 : 1024;
+    block_t* blocks = (block_t*)realloc(q->blocks, *capacity * sizeof(block_t));
+    if (!blocks) {
+      return -1;
+    }
+    q->blocks = blocks;
+  }
+  q->blocks[q->num_blocks++] = (block_t){.offset = offset, .count = count, .min_time = min_time, .max_time = max_time};
+  return 0;
+}
+
+/**
+ * @brief Build the block list from the block index next to the trace file.
+ *
+ * @return 0 on success, -1 if there is no usable index
+ */
+static int load_index(query_t* q, const char* path, size_t first_block) {
+  char index_path[4096];
+  snprintf(index_path, sizeof(index_path), "%s.idx", path);
+  FILE* f = fopen(index_path, "rb");
+  if (!f) {
+    return -1;
+  }
+  uint32_t header[2];
+  if (fread(header, sizeof(header), 1, f) != 1 || header[0] != LFT_INDEX_MAGIC || header[1] != LFT_INDEX_VERSION) {
+    fclose(f);
+    return -1;
+  }
+  size_t capacity = 0;
+  int result = 0;
+  lft_index_entry_t entry;
+  while (result == 0 && fread(&entry, sizeof(entry), 1, f) == 1) {
+    uint64_t end = entry.offset + sizeof(int) + (uint64_t)entry.count * sizeof(trace_record_nodeps_t);
+    int64_t min_time = q->physical ? entry.min_physical_time : entry.min_logical_time;
+    int64_t max_time = q->physical ? entry.max_physical_time : entry.max_logical_time;
+    if (entry.offset < first_block || entry.count < 0 || end > q->size) {
+      // The index does not belong to this trace file (or the trace is truncated).
+      result = -1;
+    } else {
+      result = append_block(q, &capacity, entry.offset + sizeof(int), entry.count, min_time, max_time);
+    }
+  }
+  fclose(f);
+  if (result != 0) {
+    // The caller falls back to scan_blocks(), which must not append to the blocks loaded so far.
+    free(q->blocks);
+    q->blocks = NULL;
+    q->num_blocks = 0;
+  }
+  return result;
+}
+
+/**
+ * @brief Build the block list by walking the block headers. Only the record counts are read.
+ */
+static int scan_blocks(query_t* q, size_t pos) {
+  size_t capacity = 0;
+  while (pos + sizeof(int) <= q->size) {
+    int count;
+    memcpy(&count, q->data + pos, sizeof(int));
+    size_t bytes = (size_t)count * sizeof(trace_record_nodeps_t);
+    if (count < 0 || pos + sizeof(int) + bytes > q->size) {
+      fprintf(stderr, "lf-trace-query: trace truncated at offset %zu; ignoring the rest.\n", pos);
+      break;
+    }
+    if (append_block(q, &capacity, pos + sizeof(int), count, INT64_MIN, INT64_MAX) != 0) {
+      return -1;
+    }
+    pos += sizeof(int) + bytes;
+  }
+  return 0;
+}
+
+static int event_selected(const query_t* q, int event_type) {
+  if (q->num_events == 0) {
+    return 1;
+  }
+  for (int i = 0; i < q->num_events; i++) {
+    if (q->events[i] == event_type) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int in_window(const query_t* q, const trace_record_nodeps_t* r) {
+  int64_t elapsed = (q->physical ? r->physical_time : r->logical_time) - q->start_time;
+  return elapsed >= q->from && elapsed < q->to;
+}
+
+static int reactor_selected(const query_t* q, void* pointer) {
+  if (q->num_patterns == 0) {
+    return 1;
+  }
+  const description_t* d = find_reactor(q, pointer);
+  return d != NULL && d->matches;
+}
+
+static reaction_stats_t* stats_lookup(stats_table_t* t, void* pointer, int reaction) {
+  if (t->size * 2 >= t->capacity) {
+    size_t capacity = t->capacity ? t->capacity * 2 : 256;
+    reaction_stats_t* entries = (reaction_stats_t*)calloc(capacity, sizeof(reaction_stats_t));
+    if (!entries) {
+      return NULL;
+    }
+    for (size_t i = 0; i < t->capacity; i++) {
+      if (t->entries[i].count == 0) {
+        continue;
+      }
+      size_t h = ((uintptr_t)t->entries[i].pointer * 31u + (unsigned)t->entries[i].reaction) & (capacity - 1);
+      while (entries[h].count != 0) {
+        h = (h + 1) & (capacity - 1);
+      }
+      entries[h] = t->entries[i];
+    }
+    free(t->entries);
+    t->entries = entries;
+    t->capacity = capacity;
+  }
+  size_t h = ((uintptr_t)pointer * 31u + (unsigned)reaction) & (t->capacity - 1);
+  while (t->entries[h].count != 0 && (t->entries[h].pointer != pointer || t->entries[h].reaction != reaction)) {
+    h = (h + 1) & (t->capacity - 1);
+  }
+  return &t->entries[h];
+}
+
+static void stats_add(stats_table_t* t, void* pointer, int reaction, int64_t duration, uint64_t count,
+                      double sum_squares, int64_t min, int64_t max) {
+  reaction_stats_t* s = stats_lookup(t, pointer, reaction);
+  if (!s) {
+    return;
+  }
+  if (s->count == 0) {
+    t->size++;
+    s->pointer = pointer;
+    s->reaction = reaction;
+    s->min = min;
+    s->max = max;
+  } else {
+    if (min < s->min)
+      s->min = min;
+    if (max > s->max)
+      s->max = max;
+  }
+  s->count += count;
+  s->total += duration;
+  s->sum_squares += sum_squares;
+}
+
+static void stats_add_one(stats_table_t* t, void* pointer, int reaction, int64_t duration) {
+  stats_add(t, pointer, reaction, duration, 1, (double)duration * (double)duration, duration, duration);
+}
+
+static void append_text(block_result_t* r, size_t* capacity, const char* line, size_t n) {
+  if (r->text_size + n > *capacity) {
+    size_t new_capacity = (*capacity ? *capacity * 2 : 4096);
+    while (new_capacity < r->text_size + n) {
+      new_capacity *= 2;
+    }
+    char* text = (char*)realloc(r->text, new_capacity);
+    if (!text) {
+      return;
+    }
+    r->text = text;
+    *capacity = new_capacity;
+  }
+  memcpy(r->text + r->text_size, line, n);
+  r->text_size += n;
+}
+
+static void push_event(open_event_t** events, size_t* size, const trace_record_nodeps_t* rec) {
+  open_event_t* grown = (open_event_t*)realloc(*events, (*size + 1) * sizeof(open_event_t));
+  if (!grown) {
+    return;
+  }
+  *events = grown;
+  grown[(*size)++] =
+      (open_event_t){.worker = rec->src_id, .pointer = rec->pointer, .reaction = rec->dst_id, .time = rec->physical_time};
+}
+
+/**
+ * @brief Decode one block, either formatting matching records or pairing reaction starts and ends.
+ */
+static void decode_block(const query_t* q, const block_t* b, block_result_t* r, stats_table_t* stats) {
+  const trace_record_nodeps_t* records = (const trace_record_nodeps_t*)(q->data + b->offset);
+  size_t capacity = 0;
+  char line[512];
+
+  for (int32_t i = 0; i < b->count; i++) {
+    trace_record_nodeps_t rec;
+    memcpy(&rec, &records[i], sizeof(rec)); // The block is not necessarily aligned.
+    if (!in_window(q, &rec) || !reactor_selected(q, rec.pointer)) {
+      continue;
+    }
+
+    if (q->list) {
+      if (!event_selected(q, rec.event_type)) {
+        continue;
+      }
+      const description_t* d = find_reactor(q, rec.pointer);
+      const char* name = (rec.event_type >= 0 && rec.event_type < NUM_EVENT_TYPES) ? trace_event_names[rec.event_type]
+                                                                                     : "Unknown event";
+      int n = snprintf(line, sizeof(line), "%s,%s,%d,%d,%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 "\n", name,
+                       d ? d->description : "", rec.src_id, rec.dst_id, rec.logical_time - q->start_time,
+                       rec.microstep, rec.physical_time - q->start_time, rec.extra_delay);
+      if (n > 0) {
+        append_text(r, &capacity, line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);
+      }
+      r->matched++;
+      continue;
+    }
+
+    if (rec.event_type == reaction_starts) {
+      // A start replaces any unmatched start of the same worker.
+      size_t j = 0;
+      while (j < r->num_open_starts && r->open_starts[j].worker != rec.src_id) {
+        j++;
+      }
+      if (j == r->num_open_starts) {
+        push_event(&r->open_starts, &r->num_open_starts, &rec);
+      } else {
+        r->open_starts[j] = (open_event_t){
+            .worker = rec.src_id, .pointer = rec.pointer, .reaction = rec.dst_id, .time = rec.physical_time};
+      }
+    } else if (rec.event_type == reaction_ends) {
+      size_t j = 0;
+      while (j < r->num_open_starts && r->open_starts[j].worker != rec.src_id) {
+        j++;
+      }
+      if (j < r->num_open_starts && r->open_starts[j].pointer == rec.pointer &&
+          r->open_starts[j].reaction == rec.dst_id) {
+        stats_add_one(stats, rec.pointer, rec.dst_id, rec.physical_time - r->open_starts[j].time);
+        r->open_starts[j] = r->open_starts[--r->num_open_starts];
+        r->matched++;
+      } else if (j == r->num_open_starts) {
+        // The start may be in an earlier block of the same worker.
+        push_event(&r->orphan_ends, &r->num_orphan_ends, &rec);
+      }
+    }
+  }
+}
+
+static void* decode_worker(void* arg) {
+  worker_arg_t* w = (worker_arg_t*)arg;
+  batch_t* batch = w->batch;
+  for (;;) {
+    size_t i = atomic_fetch_add(&batch->next, 1) + batch->first;
+    if (i >= batch->last) {
+      break;
+    }
+    decode_block(batch->query, &batch->query->blocks[i], &batch->results[i - batch->first], &batch->stats[w->index]);
+  }
+  return NULL;
+}
+
+static int compare_total(const void* a, const void* b) {
+  const reaction_stats_t* x = (const reaction_stats_t*)a;
+  const reaction_stats_t* y = (const reaction_stats_t*)b;
+  return (x->total < y->total) - (x->total > y->total);
+}
+
+/**
+ * @brief Carries reaction starts that are still open at the end of a block over to later blocks.
+ */
+typedef struct {
+  open_event_t* starts;
+  size_t size;
+} pending_t;
+
+static void merge_block(pending_t* pending, block_result_t* r, stats_table_t* stats) {
+  for (size_t i = 0; i < r->num_orphan_ends; i++) {
+    open_event_t* end = &r->orphan_ends[i];
+    for (size_t j = 0; j < pending->size; j++) {
+      open_event_t* start = &pending->starts[j];
+      if (start->worker == end->worker) {
+        if (start->pointer == end->pointer && start->reaction == end->reaction) {
+          stats_add_one(stats, end->pointer, end->reaction, end->time - start->time);
+        }
+        pending->starts[j] = pending->starts[--pending->size];
+        break;
+      }
+    }
+  }
+  for (size_t i = 0; i < r->num_open_starts; i++) {
+    size_t j = 0;
+    while (j < pending->size && pending->starts[j].worker != r->open_starts[i].worker) {
+      j++;
+    }
+    if (j == pending->size) {
+      open_event_t* grown = (open_event_t*)realloc(pending->starts, (pending->size + 1) * sizeof(open_event_t));
+      if (!grown) {
+        continue;
+      }
+      pending->starts = grown;
+      pending->size++;
+    }
+    pending->starts[j] = r->open_starts[i];
+  }
+}
+
+static void print_stats(const query_t* q, stats_table_t* total) {
+  size_t n = 0;
+  for (size_t i = 0; i < total->capacity; i++) {
+    if (total->entries[i].count != 0) {
+      total->entries[n++] = total->entries[i];
+    }
+  }
+  qsort(total->entries, n, sizeof(reaction_stats_t), compare_total);
+  printf("%-48s %10s %14s %12s %12s %12s %12s\n", "reaction", "count", "total_ns", "mean_ns", "stddev_ns", "min_ns",
+         "max_ns");
+  for (size_t i = 0; i < n; i++) {
+    const reaction_stats_t* s = &total->entries[i];
+    const description_t* d = find_reactor(q, s->pointer);
+    char name[256];
+    snprintf(name, sizeof(name), "%s.%d", d ? d->description : "?", s->reaction);
+    double mean = (double)s->total / (double)s->count;
+    double variance = s->sum_squares / (double)s->count - mean * mean;
+    double stddev = variance > 0 ? sqrt(variance) : 0.0;
+    printf("%-48s %10" PRIu64 " %14" PRId64 " %12.0f %12.0f %12" PRId64 " %12" PRId64 "\n", name, s->count, s->total,
+           mean, stddev, s->min, s->max);
+  }
+}
+
+// MAIN **********************************************************************
+
+int main(int argc, char** argv) {
+  query_t q = {.from = INT64_MIN, .to = INT64_MAX};
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  q.threads = cpus > 0 ? (int)cpus : 1;
+
+  static const struct option options[] = {
+      {"reactor", required_argument, NULL, 'r'}, {"event", required_argument, NULL, 'e'},
+      {"from", required_argument, NULL, 'F'},    {"to", required_argument, NULL, 'T'},
+      {"physical", no_argument, NULL, 'P'},      {"stats", no_argument, NULL, 's'},
+      {"list", no_argument, NULL, 'l'},          {"threads", required_argument, NULL, 'j'},
+      {"help", no_argument, NULL, 'h'},          {NULL, 0, NULL, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "r:e:slj:h", options, NULL)) != -1) {
+    switch (opt) {
+    case 'r':
+      if (q.num_patterns == MAX_PATTERNS) {
+        fprintf(stderr, "lf-trace-query: too many reactor patterns.\n");
+        return 2;
+      }
+      q.patterns[q.num_patterns++] = optarg;
+      break;
+    case 'e': {
+      int type = parse_event_type(optarg);
+      if (type < 0 || q.num_events == MAX_PATTERNS) {
+        fprintf(stderr, "lf-trace-query: invalid event type: %s\n", optarg);
+        return 2;
+      }
+      q.events[q.num_events++] = type;
+      break;
+    }
+    case 'F':
+    case 'T':
+      if (parse_duration(optarg, opt == 'F' ? &q.from : &q.to) != 0) {
+        fprintf(stderr, "lf-trace-query: invalid time: %s\n", optarg);
+        return 2;
+      }
+      break;
+    case 'P':
+      q.physical = 1;
+      break;
+    case 's':
+      q.list = 0;
+      break;
+    case 'l':
+      q.list = 1;
+      break;
+    case 'j':
+      q.threads = atoi(optarg);
+      if (q.threads < 1) {
+        q.threads = 1;
+      }
+      break;
+    case 'h':
+      usage(stdout);
+      return 0;
+    default:
+      usage(stderr);
+      return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(stderr);
+    return 2;
+  }
+  const char* path = argv[optind];
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "lf-trace-query: cannot open %s: %s\n", path, strerror(errno));
+    return 1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    fprintf(stderr, "lf-trace-query: %s is empty or unreadable.\n", path);
+    close(fd);
+    return 1;
+  }
+  q.size = (size_t)st.st_size;
+  void* mapping = mmap(NULL, q.size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    fprintf(stderr, "lf-trace-query: cannot map %s: %s\n", path, strerror(errno));
+    return 1;
+  }
+  q.data = (const uint8_t*)mapping;
+  madvise(mapping, q.size, MADV_SEQUENTIAL);
+
+  size_t first_block = parse_header(&q);
+  if (first_block == 0 || build_reactor_index(&q) != 0) {
+    fprintf(stderr, "lf-trace-query: %s is not a valid LF trace file.\n", path);
+    return 1;
+  }
+  if (load_index(&q, path, first_block) != 0 && scan_blocks(&q, first_block) != 0) {
+    fprintf(stderr, "lf-trace-query: out of memory.\n");
+    return 1;
+  }
+
+  if (q.list) {
+    printf("Event,Reactor,Source,Destination,Elapsed Logical Time,Microstep,Elapsed Physical Time,Extra Delay\n");
+  }
+
+  stats_table_t total = {0};
+  pending_t pending = {0};
+  stats_table_t* thread_stats = (stats_table_t*)calloc((size_t)q.threads, sizeof(stats_table_t));
+  pthread_t* threads = (pthread_t*)calloc((size_t)q.threads, sizeof(pthread_t));
+  worker_arg_t* args = (worker_arg_t*)calloc((size_t)q.threads, sizeof(worker_arg_t));
+  if (!thread_stats || !threads || !args) {
+    fprintf(stderr, "lf-trace-query: out of memory.\n");
+    return 1;
+  }
+  uint64_t matched = 0;
+
+  size_t first = 0;
+  while (first < q.num_blocks) {
+    // Collect a batch of blocks that overlap the time window, bounded in size.
+    size_t last = first;
+    size_t bytes = 0;
+    while (last < q.num_blocks && bytes < BATCH_BYTES) {
+      bytes += (size_t)q.blocks[last].count * sizeof(trace_record_nodeps_t);
+      last++;
+    }
+
+    batch_t batch = {.query = &q, .first = first, .last = last, .stats = thread_stats};
+    atomic_init(&batch.next, 0);
+    batch.results = (block_result_t*)calloc(last - first, sizeof(block_result_t));
+    if (!batch.results) {
+      fprintf(stderr, "lf-trace-query: out of memory.\n");
+      return 1;
+    }
+    // Blocks entirely outside the window are skipped; they are left without results.
+    for (size_t i = first; i < last; i++) {
+      const block_t* b = &q.blocks[i];
+      if (b->max_time != INT64_MAX &&
+          (b->max_time - q.start_time < q.from || b->min_time - q.start_time >= q.to)) {
+        q.blocks[i].count = 0;
+      }
+    }
+
+    int num_threads = q.threads;
+    if ((size_t)num_threads > last - first) {
+      num_threads = (int)(last - first);
+    }
+    for (int t = 0; t < num_threads; t++) {
+      args[t] = (worker_arg_t){.batch = &batch, .index = t};
+      if (pthread_create(&threads[t], NULL, decode_worker, &args[t]) != 0) {
+        decode_worker(&args[t]);
+        threads[t] = 0;
+      }
+    }
+    for (int t = 0; t < num_threads; t++) {
+      if (threads[t]) {
+        pthread_join(threads[t], NULL);
+      }
+    }
+
+    // Emit in file order and carry open reactions over to the next blocks.
+    for (size_t i = first; i < last; i++) {
+      block_result_t* r = &batch.results[i - first];
+      if (r->text_size) {
+        fwrite(r->text, 1, r->text_size, stdout);
+      }
+      if (!q.list) {
+        merge_block(&pending, r, &total);
+      }
+      matched += r->matched;
+      free(r->text);
+      free(r->orphan_ends);
+      free(r->open_starts);
+    }
+    free(batch.results);
+
+    // Release the pages of the batch so that files larger than RAM can be processed.
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t begin = ((uintptr_t)q.data + q.blocks[first].offset) & ~(page - 1);
+    uintptr_t end = (uintptr_t)q.data + q.blocks[last - 1].offset +
+                    (uintptr_t)q.blocks[last - 1].count * sizeof(trace_record_nodeps_t);
+    madvise((void*)begin, end - begin, MADV_DONTNEED);
+    first = last;
+  }
+
+  if (!q.list) {
+    for (int t = 0; t < q.threads; t++) {
+      for (size_t i = 0; i < thread_stats[t].capacity; i++) {
+        const reaction_stats_t* s = &thread_stats[t].entries[i];
+        if (s->count) {
+          stats_add(&total, s->pointer, s->reaction, s->total, s->count, s->sum_squares, s->min, s->max);
+        }
+      }
+    }
+    print_stats(&q, &total);
+  }
+  fprintf(stderr, "lf-trace-query: %zu blocks, %" PRIu64 " matching %s.\n", q.num_blocks, matched,
+          q.list ? "records" : "reaction executions");
+
+  free(pending.starts);
+  free(total.entries);
+  munmap(mapping, q.size);
+  return 0;
+}